@@ -3,6 +3,10 @@ setlocal
 
 set SRC=main.c
 set OUT=undeadwest.exe
+if "%3%"=="headless" (
+  set SRC=headless.c
+  set OUT=undeadwest_headless.exe
+)
 
 @REM --- CONFIGURE ------------------------------------------------------------------
 
@@ -17,11 +17,21 @@ if [[ $TARGET != "darwin_amd64" && $TARGET != "darwin_arm64" && $TARGET != "linu
   exit 1
 fi
 
+PROGRAM="game"
+if [[ $3 != "" ]]; then PROGRAM=$3; fi
+if [[ $PROGRAM != "game" && $PROGRAM != "headless" ]]; then
+  echo "Failed to build. '$PROGRAM' is not a valid program."
+  exit 1
+fi
+
 CFLAGS="-std=gnu17 -Iext -ftrapv"
 if [[ $MODE == "dev"     ]]; then CFLAGS="$CFLAGS -O0 -DDEBUG"; fi
 if [[ $MODE == "debug"   ]]; then CFLAGS="$CFLAGS -Og -g -DDEBUG"; fi
 if [[ $MODE == "release" ]]; then CFLAGS="$CFLAGS -O2 -fno-strict-aliasing"; fi
 
+# Profiler zones default to on in dev and debug. PROFILE=0 or PROFILE=1 overrides that.
+if [[ $PROFILE != "" ]]; then CFLAGS="$CFLAGS -DPROFILE=$PROFILE"; fi
+
 WFLAGS=""
 if [[ $MODE == "debug"   ]]; then WFLAGS="-Wall -Wno-missing-braces"; fi
 
@@ -29,8 +39,13 @@ LFLAGS="-Lext/sokol/lib"
 if [[ $TARGET == "darwin_amd64" ]]; then LFLAGS="$LFLAGS -lsokol_darwin -framework OpenGL -framework Cocoa"; fi
 if [[ $TARGET == "linux_amd64"  ]]; then LFLAGS="$LFLAGS -lsokol_linux -lX11 -lXi -lXcursor -lEGL -lGL -ldl -lpthread -lm"; fi
 
+if [[ $PROGRAM == "headless" ]]; then
+  LFLAGS="-ldl -lpthread -lm"
+fi
+
 echo "[target:$TARGET]"
 echo "[mode:$MODE]"
+echo "[program:$PROGRAM]"
 
 # --- PREPROCESS --------------------------------------------------------------------
 
@@ -44,5 +59,10 @@ echo "[preprocess]"
 echo "[build]"
 
 if [[ ! -d "out" ]]; then mkdir out; fi
-cc src/main.c -o out/undeadwest $CFLAGS $WFLAGS $LFLAGS
-if [[ $MODE == "dev" ]]; then out/undeadwest; fi
+if [[ $PROGRAM == "headless" ]]; then
+  cc src/headless.c -o out/undeadwest_headless $CFLAGS $WFLAGS $LFLAGS
+  if [[ $MODE == "dev" ]]; then out/undeadwest_headless; fi
+else
+  cc src/main.c -o out/undeadwest $CFLAGS $WFLAGS $LFLAGS
+  if [[ $MODE == "dev" ]]; then out/undeadwest; fi
+fi
@@ -4,3 +4,4 @@
 #include "base_string.h"
 #include "base_random.h"
 #include "base_logger.h"
+#include "base_job.h"
@@ -62,6 +62,7 @@ typedef const char *cstr;
 
 #define size_of(T) sizeof(T)
 #define align_of(T) _Alignof(T)
+#define arr_len(a) (size_of(a) / size_of((a)[0]))
 
 // @Math /////////////////////////////////////////////////////////////////////////////////
 
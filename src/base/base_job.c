@@ -0,0 +1,281 @@
+#include "base_job.h"
+
+// @Job //////////////////////////////////////////////////////////////////////////////////
+
+static JobSystem _jobs;
+thread_local JobDeque *_job_deque;
+
+static void job_worker_main(void *arg);
+
+// Gives the calling thread its deque the first time it needs one. Threads past
+// JOB_MAX_THREADS get none and run everything they submit themselves.
+static
+JobDeque *job_get_deque(void)
+{
+  if (_job_deque == NULL)
+  {
+    u32 index = os_atomic_add_u32(&_jobs.thread_count, 1);
+    if (index >= JOB_MAX_THREADS) return NULL;
+
+    _job_deque = &_jobs.deques[index];
+    _job_deque->index = index;
+  }
+
+  return _job_deque;
+}
+
+static
+void job_lock(JobDeque *deque)
+{
+  while (os_atomic_exchange_u32(&deque->lock, 1) != 0)
+  {
+    while (os_atomic_load_u32(&deque->lock) != 0)
+    {
+      os_pause();
+    }
+  }
+}
+
+static
+void job_unlock(JobDeque *deque)
+{
+  os_atomic_store_u32(&deque->lock, 0);
+}
+
+static
+bool job_deque_push(JobDeque *deque, Job job)
+{
+  bool pushed = FALSE;
+
+  job_lock(deque);
+  u32 top = os_atomic_load_u32(&deque->top);
+  u32 bottom = os_atomic_load_u32(&deque->bottom);
+  if (bottom - top < JOB_DEQUE_SIZE)
+  {
+    deque->jobs[bottom % JOB_DEQUE_SIZE] = job;
+    os_atomic_store_u32(&deque->bottom, bottom + 1);
+    pushed = TRUE;
+  }
+  job_unlock(deque);
+
+  return pushed;
+}
+
+// Takes the newest job, for the owner, or the oldest, for a thief. An empty deque is
+// seen without taking the lock, so idle threads looking for work don't contend.
+static
+bool job_deque_take(JobDeque *deque, Job *job, bool steal)
+{
+  bool taken = FALSE;
+  if (os_atomic_load_u32(&deque->bottom) == os_atomic_load_u32(&deque->top)) return taken;
+
+  job_lock(deque);
+  u32 top = os_atomic_load_u32(&deque->top);
+  u32 bottom = os_atomic_load_u32(&deque->bottom);
+  if (bottom != top)
+  {
+    if (steal)
+    {
+      *job = deque->jobs[top % JOB_DEQUE_SIZE];
+      os_atomic_store_u32(&deque->top, top + 1);
+    }
+    else
+    {
+      *job = deque->jobs[(bottom - 1) % JOB_DEQUE_SIZE];
+      os_atomic_store_u32(&deque->bottom, bottom - 1);
+    }
+
+    taken = TRUE;
+  }
+  job_unlock(deque);
+
+  return taken;
+}
+
+static
+void job_run(Job job)
+{
+  job.func(job.data, job.first, job.count);
+  os_atomic_add_u32(&job.counter->pending, (u32) -1);
+}
+
+// Runs one job from the thread's own deque, or else one stolen from the others.
+// Returns false if there was none anywhere.
+static
+bool job_run_next(JobDeque *deque)
+{
+  Job job;
+  if (job_deque_take(deque, &job, FALSE))
+  {
+    job_run(job);
+    return TRUE;
+  }
+
+  u32 thread_count = min(os_atomic_load_u32(&_jobs.thread_count), JOB_MAX_THREADS);
+  for (u32 i = 1; i < thread_count; i++)
+  {
+    JobDeque *victim = &_jobs.deques[(deque->index + i) % thread_count];
+    if (job_deque_take(victim, &job, TRUE))
+    {
+      job_run(job);
+      return TRUE;
+    }
+  }
+
+  return FALSE;
+}
+
+// Starts the workers. With none, every job runs on the thread that submits it.
+void job_init(u32 worker_count)
+{
+  _jobs.worker_count = min(worker_count, JOB_MAX_WORKERS);
+  _jobs.wake = os_create_semaphore();
+
+  for (u32 i = 0; i < _jobs.worker_count; i++)
+  {
+    os_start_thread(&_jobs.workers[i], job_worker_main, NULL);
+  }
+}
+
+void job_shutdown(void)
+{
+  os_atomic_store_u32(&_jobs.stop, TRUE);
+  os_signal_semaphore(_jobs.wake, _jobs.worker_count);
+
+  for (u32 i = 0; i < _jobs.worker_count; i++)
+  {
+    os_join_thread(&_jobs.workers[i]);
+  }
+
+  _jobs.worker_count = 0;
+}
+
+// NOTE(dg): A worker spins for a while after running out of jobs, since the next
+// parallel pass is usually only microseconds away, and then sleeps until more are
+// pushed.
+static
+void job_worker_main(void *arg)
+{
+  JobDeque *deque = job_get_deque();
+  if (deque == NULL) return;
+
+  init_scratch_arenas();
+
+  u32 idle_count = 0;
+  while (!os_atomic_load_u32(&_jobs.stop))
+  {
+    if (job_run_next(deque))
+    {
+      idle_count = 0;
+      continue;
+    }
+
+    idle_count += 1;
+    if (idle_count == JOB_SPIN_COUNT)
+    {
+      os_wait_semaphore(_jobs.wake);
+      idle_count = 0;
+    }
+    else
+    {
+      os_pause();
+    }
+  }
+}
+
+// Returns the index of the calling thread's deque, from 0 to JOB_MAX_THREADS - 1, or
+// JOB_MAX_THREADS if it has none. A thread's jobs never run at the same time as each
+// other, so this can pick out per-thread state for a job.
+u32 job_thread_index(void)
+{
+  JobDeque *deque = job_get_deque();
+  return deque != NULL ? deque->index : JOB_MAX_THREADS;
+}
+
+u32 job_worker_count(void)
+{
+  return _jobs.worker_count;
+}
+
+void job_push(JobFunc *func, void *data, u32 first, u32 count, JobCounter *counter)
+{
+  Job job = {func, data, first, count, counter};
+  os_atomic_add_u32(&counter->pending, 1);
+
+  JobDeque *deque = job_get_deque();
+  if (_jobs.worker_count == 0 || deque == NULL || !job_deque_push(deque, job))
+  {
+    job_run(job);
+    return;
+  }
+
+  os_signal_semaphore(_jobs.wake, 1);
+}
+
+// Runs jobs until every one counted by counter is done.
+// NOTE(dg): Once there is nothing left to steal the last chunks are running on other
+// threads. The waiting thread spins a while, as the workers do, and then yields its
+// core between checks instead of burning it until they finish.
+void job_wait(JobCounter *counter)
+{
+  JobDeque *deque = job_get_deque();
+
+  u32 idle_count = 0;
+  while (os_atomic_load_u32(&counter->pending) != 0)
+  {
+    if (deque != NULL && job_run_next(deque))
+    {
+      idle_count = 0;
+      continue;
+    }
+
+    idle_count += 1;
+    if (idle_count == JOB_SPIN_COUNT)
+    {
+      os_yield();
+      idle_count = 0;
+    }
+    else
+    {
+      os_pause();
+    }
+  }
+}
+
+// Runs func over 0 to count - 1 in chunks of grain items, which are pushed to the
+// calling thread's deque for the workers to steal. The calling thread runs the first
+// chunk and helps with the rest until all of them are done.
+void job_parallel_for(u32 count, u32 grain, JobFunc *func, void *data)
+{
+  if (count == 0) return;
+
+  grain = max(grain, 1);
+  u32 chunk_count = (count + grain - 1) / grain;
+
+  JobDeque *deque = job_get_deque();
+  if (chunk_count == 1 || _jobs.worker_count == 0 || deque == NULL)
+  {
+    func(data, 0, count);
+    return;
+  }
+
+  // NOTE(dg): Chunks are pushed last first, so the owner pops them in order while
+  // thieves start from the far end.
+  JobCounter counter = {0};
+  for (u32 chunk = chunk_count; chunk-- > 1;)
+  {
+    u32 first = chunk * grain;
+    Job job = {func, data, first, min(grain, count - first), &counter};
+    os_atomic_add_u32(&counter.pending, 1);
+
+    if (!job_deque_push(deque, job))
+    {
+      job_run(job);
+    }
+  }
+
+  os_signal_semaphore(_jobs.wake, min(chunk_count - 1, _jobs.worker_count));
+
+  func(data, 0, min(grain, count));
+  job_wait(&counter);
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include "base_common.h"
+#include "base_os.h"
+
+// @Job //////////////////////////////////////////////////////////////////////////////////
+
+#define JOB_MAX_WORKERS 8
+#define JOB_MAX_THREADS 16
+#define JOB_DEQUE_SIZE 256
+#define JOB_SPIN_COUNT 2048
+
+// Runs items first to first + count - 1 of whatever data points at.
+typedef void JobFunc(void *data, u32 first, u32 count);
+
+// NOTE(dg): A counter is the number of jobs still to finish. Waiting on one runs other
+// jobs until it reaches zero, so a waiting thread never sits idle while there is work.
+typedef struct JobCounter JobCounter;
+struct JobCounter
+{
+  u32 volatile pending;
+};
+
+typedef struct Job Job;
+struct Job
+{
+  JobFunc *func;
+  void *data;
+  u32 first;
+  u32 count;
+  JobCounter *counter;
+};
+
+// NOTE(dg): Every thread that runs jobs owns a deque. The owner pushes and pops at the
+// bottom and other threads steal from the top, so a thread works through its own jobs
+// newest first while thieves take the oldest and largest share. Jobs are coarse, so a
+// spin lock per deque is enough.
+typedef struct JobDeque JobDeque;
+struct JobDeque
+{
+  Job jobs[JOB_DEQUE_SIZE];
+  u32 volatile top;
+  u32 volatile bottom;
+  u32 volatile lock;
+  u32 index;
+};
+
+// NOTE(dg): Workers are the threads started here. Any other thread that submits or
+// waits is given a deque of its own on first use, up to JOB_MAX_THREADS in all.
+typedef struct JobSystem JobSystem;
+struct JobSystem
+{
+  JobDeque deques[JOB_MAX_THREADS];
+  u32 volatile thread_count;
+
+  OS_Thread workers[JOB_MAX_WORKERS];
+  u32 worker_count;
+  OS_Handle wake;
+  u32 volatile stop;
+};
+
+void job_init(u32 worker_count);
+void job_shutdown(void);
+u32 job_thread_index(void);
+u32 job_worker_count(void);
+void job_push(JobFunc *func, void *data, u32 first, u32 count, JobCounter *counter);
+void job_wait(JobCounter *counter);
+void job_parallel_for(u32 count, u32 grain, JobFunc *func, void *data);
@@ -7,6 +7,8 @@
 
 #ifdef PLATFORM_UNIX
 #include <unistd.h>
+#include <pthread.h>
+#include <sched.h>
 #include <sys/fcntl.h>
 #include <sys/mman.h>
 #include <sys/param.h>
@@ -135,17 +137,21 @@ OS_Handle os_open_file(String path, OS_Flag flag)
 {
   OS_Handle result = {0};
 
+  // NOTE(dg): OS_FILE_CREATE creates the file, or truncates it if it exists.
+  OS_Flag mode = flag & ~OS_FILE_CREATE;
+  bool create = (flag & OS_FILE_CREATE) != 0;
+
   #ifdef PLATFORM_WINDOWS
   b32 access;
-  if (flag == OS_FILE_READ)
+  if (mode == OS_FILE_READ)
   {
     access = GENERIC_READ;
   }
-  else if (flag == OS_FILE_WRITE)
+  else if (mode == OS_FILE_WRITE)
   {
     access = GENERIC_WRITE;
   }
-  else if (flag == (OS_FILE_READ | OS_FILE_WRITE))
+  else if (mode == (OS_FILE_READ | OS_FILE_WRITE))
   {
     access = GENERIC_READ | GENERIC_WRITE;
   }
@@ -157,7 +163,7 @@ OS_Handle os_open_file(String path, OS_Flag flag)
   HANDLE handle = CreateFileA(path.data, 
                               access, 
                               FILE_SHARE_READ | FILE_SHARE_WRITE, 
-                              NULL, OPEN_EXISTING, 
+                              NULL, create ? CREATE_ALWAYS : OPEN_EXISTING, 
                               FILE_ATTRIBUTE_NORMAL, 
                               NULL);
   result.id = (u64) handle;
@@ -165,15 +171,15 @@ OS_Handle os_open_file(String path, OS_Flag flag)
 
   #ifdef PLATFORM_UNIX
   b32 access;
-  if (flag == OS_FILE_READ)
+  if (mode == OS_FILE_READ)
   {
     access = O_RDONLY;
   }
-  else if (flag == OS_FILE_WRITE)
+  else if (mode == OS_FILE_WRITE)
   {
     access = O_WRONLY;
   }
-  else if (flag == (OS_FILE_READ | OS_FILE_WRITE))
+  else if (mode == (OS_FILE_READ | OS_FILE_WRITE))
   {
     access = O_RDWR;
   }
@@ -182,7 +188,12 @@ OS_Handle os_open_file(String path, OS_Flag flag)
     return (OS_Handle) {0};
   }
 
-  result.id = open(path.data, access);
+  if (create)
+  {
+    access |= O_CREAT | O_TRUNC;
+  }
+
+  result.id = open(path.data, access, 0644);
   #endif
 
   return result;
@@ -321,3 +332,231 @@ void os_windows_output_debug(const char *cstr)
   OutputDebugStringA(cstr);
 }
 #endif
+
+// @Thread ///////////////////////////////////////////////////////////////////////////////
+
+#ifdef PLATFORM_WINDOWS
+static
+DWORD WINAPI os_thread_entry(void *arg)
+{
+  OS_Thread *thread = (OS_Thread *) arg;
+  thread->func(thread->arg);
+  return 0;
+}
+#endif
+
+#ifdef PLATFORM_UNIX
+static
+void *os_thread_entry(void *arg)
+{
+  OS_Thread *thread = (OS_Thread *) arg;
+  thread->func(thread->arg);
+  return NULL;
+}
+#endif
+
+// Runs func(arg) on a new thread. The thread reads from *thread, so it has to stay
+// alive until os_join_thread.
+void os_start_thread(OS_Thread *thread, OS_ThreadFunc *func, void *arg)
+{
+  thread->func = func;
+  thread->arg = arg;
+
+  #ifdef PLATFORM_WINDOWS
+  thread->id = (i64) CreateThread(NULL, 0, os_thread_entry, thread, 0, NULL);
+  #endif
+
+  #ifdef PLATFORM_UNIX
+  pthread_t handle;
+  pthread_create(&handle, NULL, os_thread_entry, thread);
+  thread->id = (i64) handle;
+  #endif
+}
+
+void os_join_thread(OS_Thread *thread)
+{
+  #ifdef PLATFORM_WINDOWS
+  HANDLE handle = (HANDLE) thread->id;
+  WaitForSingleObject(handle, INFINITE);
+  CloseHandle(handle);
+  #endif
+
+  #ifdef PLATFORM_UNIX
+  pthread_join((pthread_t) thread->id, NULL);
+  #endif
+}
+
+u32 os_get_processor_count(void)
+{
+  u32 result = 1;
+
+  #ifdef PLATFORM_WINDOWS
+  SYSTEM_INFO info = {0};
+  GetSystemInfo(&info);
+  result = info.dwNumberOfProcessors;
+  #endif
+
+  #ifdef PLATFORM_UNIX
+  result = (u32) max(sysconf(_SC_NPROCESSORS_ONLN), 1);
+  #endif
+
+  return result;
+}
+
+void os_sleep_ms(u32 ms)
+{
+  #ifdef PLATFORM_WINDOWS
+  Sleep(ms);
+  #endif
+
+  #ifdef PLATFORM_UNIX
+  usleep(ms * 1000);
+  #endif
+}
+
+// Gives the rest of the calling thread's time slice to any other thread that can run.
+void os_yield(void)
+{
+  #ifdef PLATFORM_WINDOWS
+  SwitchToThread();
+  #endif
+
+  #ifdef PLATFORM_UNIX
+  sched_yield();
+  #endif
+}
+
+// Hints to the core that the thread is spinning on a value, so it backs off the cache
+// line and leaves its resources to the other hardware thread for a few cycles.
+inline
+void os_pause(void)
+{
+  #ifdef PLATFORM_WINDOWS
+  YieldProcessor();
+  #endif
+
+  #ifdef PLATFORM_UNIX
+  #if defined(__x86_64__) || defined(__i386__)
+  __builtin_ia32_pause();
+  #elif defined(__aarch64__)
+  __asm__ volatile("yield");
+  #endif
+  #endif
+}
+
+#ifdef PLATFORM_UNIX
+typedef struct OS_UnixSemaphore OS_UnixSemaphore;
+struct OS_UnixSemaphore
+{
+  pthread_mutex_t mutex;
+  pthread_cond_t cond;
+  u32 count;
+};
+#endif
+
+// A counting semaphore that starts at zero. Semaphores live as long as the process.
+OS_Handle os_create_semaphore(void)
+{
+  OS_Handle result = {0};
+
+  #ifdef PLATFORM_WINDOWS
+  result.id = (i64) CreateSemaphoreA(NULL, 0, INT32_MAX, NULL);
+  #endif
+
+  #ifdef PLATFORM_UNIX
+  OS_UnixSemaphore *sem = os_reserve_vm(NULL, size_of(OS_UnixSemaphore));
+  os_commit_vm(sem, size_of(OS_UnixSemaphore));
+  pthread_mutex_init(&sem->mutex, NULL);
+  pthread_cond_init(&sem->cond, NULL);
+  sem->count = 0;
+  result.id = (i64) sem;
+  #endif
+
+  return result;
+}
+
+// Lets up to count waiting threads through.
+void os_signal_semaphore(OS_Handle sem, u32 count)
+{
+  #ifdef PLATFORM_WINDOWS
+  ReleaseSemaphore((HANDLE) sem.id, (LONG) count, NULL);
+  #endif
+
+  #ifdef PLATFORM_UNIX
+  OS_UnixSemaphore *unix_sem = (OS_UnixSemaphore *) sem.id;
+  pthread_mutex_lock(&unix_sem->mutex);
+  unix_sem->count += count;
+  pthread_cond_broadcast(&unix_sem->cond);
+  pthread_mutex_unlock(&unix_sem->mutex);
+  #endif
+}
+
+void os_wait_semaphore(OS_Handle sem)
+{
+  #ifdef PLATFORM_WINDOWS
+  WaitForSingleObject((HANDLE) sem.id, INFINITE);
+  #endif
+
+  #ifdef PLATFORM_UNIX
+  OS_UnixSemaphore *unix_sem = (OS_UnixSemaphore *) sem.id;
+  pthread_mutex_lock(&unix_sem->mutex);
+  while (unix_sem->count == 0)
+  {
+    pthread_cond_wait(&unix_sem->cond, &unix_sem->mutex);
+  }
+
+  unix_sem->count -= 1;
+  pthread_mutex_unlock(&unix_sem->mutex);
+  #endif
+}
+
+// NOTE(dg): Loads acquire and stores release, so whatever a thread wrote before storing
+// a value is visible to a thread that loads it. Exchanges do both.
+inline
+u32 os_atomic_load_u32(u32 volatile *src)
+{
+  #ifdef PLATFORM_WINDOWS
+  return (u32) InterlockedCompareExchange((LONG volatile *) src, 0, 0);
+  #endif
+
+  #ifdef PLATFORM_UNIX
+  return __atomic_load_n(src, __ATOMIC_ACQUIRE);
+  #endif
+}
+
+inline
+void os_atomic_store_u32(u32 volatile *dst, u32 val)
+{
+  #ifdef PLATFORM_WINDOWS
+  InterlockedExchange((LONG volatile *) dst, (LONG) val);
+  #endif
+
+  #ifdef PLATFORM_UNIX
+  __atomic_store_n(dst, val, __ATOMIC_RELEASE);
+  #endif
+}
+
+inline
+u32 os_atomic_exchange_u32(u32 volatile *dst, u32 val)
+{
+  #ifdef PLATFORM_WINDOWS
+  return (u32) InterlockedExchange((LONG volatile *) dst, (LONG) val);
+  #endif
+
+  #ifdef PLATFORM_UNIX
+  return __atomic_exchange_n(dst, val, __ATOMIC_ACQ_REL);
+  #endif
+}
+
+// Returns the value from before the add.
+inline
+u32 os_atomic_add_u32(u32 volatile *dst, u32 val)
+{
+  #ifdef PLATFORM_WINDOWS
+  return (u32) InterlockedExchangeAdd((LONG volatile *) dst, (LONG) val);
+  #endif
+
+  #ifdef PLATFORM_UNIX
+  return __atomic_fetch_add(dst, val, __ATOMIC_ACQ_REL);
+  #endif
+}
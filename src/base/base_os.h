@@ -38,6 +38,34 @@ OS_Handle os_handle_to_stdin(void);
 OS_Handle os_handle_to_stdout(void);
 OS_Handle os_handle_to_stderr(void);
 
+// @Thread ///////////////////////////////////////////////////////////////////////////////
+
+typedef void OS_ThreadFunc(void *arg);
+
+typedef struct OS_Thread OS_Thread;
+struct OS_Thread
+{
+  i64 id;
+  OS_ThreadFunc *func;
+  void *arg;
+};
+
+void os_start_thread(OS_Thread *thread, OS_ThreadFunc *func, void *arg);
+void os_join_thread(OS_Thread *thread);
+u32 os_get_processor_count(void);
+void os_sleep_ms(u32 ms);
+void os_yield(void);
+void os_pause(void);
+
+OS_Handle os_create_semaphore(void);
+void os_signal_semaphore(OS_Handle sem, u32 count);
+void os_wait_semaphore(OS_Handle sem);
+
+u32 os_atomic_load_u32(u32 volatile *src);
+void os_atomic_store_u32(u32 volatile *dst, u32 val);
+u32 os_atomic_exchange_u32(u32 volatile *dst, u32 val);
+u32 os_atomic_add_u32(u32 volatile *dst, u32 val);
+
 #ifdef PLATFORM_WINDOWS
 void os_windows_output_debug(const char *cstr);
 #endif
@@ -0,0 +1,135 @@
+#include "stb/stb_sprintf.h"
+
+#include "base/base.h"
+#include "vecmath/vecmath.h"
+#include "ui/ui.h"
+#include "counters.h"
+
+static CounterRegistry _counters;
+
+// Returns the id the counter is read and written by. Everything has to be registered
+// before a CSV file is opened, so every row lines up with the header.
+u32 counter_register(char const *name, CounterKind kind)
+{
+  assert(_counters.count < COUNTER_MAX);
+  assert(!_counters.streaming);
+
+  u32 id = _counters.count++;
+  _counters.names[id] = name;
+  _counters.kinds[id] = kind;
+
+  return id;
+}
+
+inline
+void counter_add(u32 id, u64 amount)
+{
+  _counters.values[id] += amount;
+}
+
+inline
+void counter_set(u32 id, u64 value)
+{
+  _counters.values[id] = value;
+}
+
+// Keeps the tick's values for the overlay, appends them to the CSV file if one is open
+// and starts the sums over.
+void counters_end_tick(void)
+{
+  for (u32 i = 0; i < _counters.count; i++)
+  {
+    _counters.last[i] = _counters.values[i];
+    if (_counters.kinds[i] == CounterKind_Sum)
+    {
+      _counters.values[i] = 0;
+    }
+  }
+
+  if (_counters.streaming)
+  {
+    Arena scratch = get_scratch_arena(NULL);
+
+    u64 field_size = 24;
+    char *buf = arena_push(&scratch, char, (_counters.count + 1) * field_size);
+    u64 len = stbsp_sprintf(buf, "%llu", _counters.tick);
+    for (u32 i = 0; i < _counters.count; i++)
+    {
+      len += stbsp_sprintf(buf + len, ",%llu", _counters.last[i]);
+    }
+
+    len += stbsp_sprintf(buf + len, "\n");
+    os_write_file(_counters.csv, (String) {buf, len});
+  }
+
+  _counters.tick += 1;
+}
+
+// Lists the last tick's values top down, wrapping into another column whenever one
+// fills up.
+void counters_draw_overlay(Vec2F pos, Vec2F dim)
+{
+  f32 row_height = 11.0f;
+  f32 column_width = 165.0f;
+  u32 rows = max((u32) (dim.height / row_height), 1);
+
+  ui_rect(v2f(pos.x, pos.y - dim.y), dim, v4f(0, 0, 0, 0.5f));
+  ui_text(str("tick: %llu%s"), v2f(pos.x, pos.y + 5), 10, 999,
+          _counters.tick,
+          _counters.streaming ? " (streaming)" : "");
+
+  for (u32 i = 0; i < _counters.count; i++)
+  {
+    f32 x = pos.x + 2.0f + (i / rows) * column_width;
+    f32 y = pos.y - (i % rows + 1) * row_height;
+    if (x + column_width > pos.x + dim.width) break;
+
+    ui_text(str("%s: %llu"), v2f(x, y + 1.0f), 10, 999, _counters.names[i], _counters.last[i]);
+  }
+}
+
+// Starts streaming a row per tick to the file at path, headed by the counter names.
+// Returns false if the file couldn't be opened.
+bool counters_open_csv(String path)
+{
+  counters_close_csv();
+
+  OS_Handle file = os_open_file(path, OS_FILE_WRITE | OS_FILE_CREATE);
+  if (!os_is_handle_valid(file)) return FALSE;
+
+  Arena scratch = get_scratch_arena(NULL);
+
+  u64 len = 0;
+  for (u32 i = 0; i < _counters.count; i++)
+  {
+    len += cstr_len((char *) _counters.names[i]);
+  }
+
+  char *buf = arena_push(&scratch, char, len + 8);
+  len = stbsp_sprintf(buf, "tick");
+  for (u32 i = 0; i < _counters.count; i++)
+  {
+    len += stbsp_sprintf(buf + len, ",%s", _counters.names[i]);
+  }
+
+  len += stbsp_sprintf(buf + len, "\n");
+  os_write_file(file, (String) {buf, len});
+
+  _counters.csv = file;
+  _counters.streaming = TRUE;
+
+  return TRUE;
+}
+
+void counters_close_csv(void)
+{
+  if (!_counters.streaming) return;
+
+  os_close_file(_counters.csv);
+  _counters.streaming = FALSE;
+}
+
+bool counters_are_streaming(void)
+{
+  return _counters.streaming;
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include "base/base.h"
+
+#define COUNTER_MAX 64
+
+// NOTE(dg): A sum counts up over a tick and starts from zero on the next. A gauge holds
+// whatever it was last set to, for values that are only measured now and then, like
+// the stats of the last frame drawn.
+typedef enum CounterKind
+{
+  CounterKind_Sum,
+  CounterKind_Gauge,
+} CounterKind;
+
+// NOTE(dg): Counters are registered once at startup and then only ever touched by the
+// thread that runs the simulation. Each tick closes a row, which the overlay shows and
+// an open CSV file gets appended to.
+typedef struct CounterRegistry CounterRegistry;
+struct CounterRegistry
+{
+  char const *names[COUNTER_MAX];
+  CounterKind kinds[COUNTER_MAX];
+  u64 values[COUNTER_MAX];
+  u64 last[COUNTER_MAX];
+  u32 count;
+  u64 tick;
+
+  OS_Handle csv;
+  bool streaming;
+};
+
+u32 counter_register(char const *name, CounterKind kind);
+void counter_add(u32 id, u64 amount);
+void counter_set(u32 id, u64 value);
+void counters_end_tick(void);
+void counters_draw_overlay(Vec2F pos, Vec2F dim);
+bool counters_open_csv(String path);
+void counters_close_csv(void);
+bool counters_are_streaming(void);
@@ -127,10 +127,65 @@ UI_Glyph get_glyph(char glyph)
 
 // @Assets ///////////////////////////////////////////////////////////////////////////////
 
+static SpriteUV sprite_uvs[SPRITE_UV_COUNT];
+static u32 sprite_uv_count = 1;
+
+static inline
+Vec2F atlas_uv(Vec2I texel, R_Texture *atlas)
+{
+  return (Vec2F) {
+    (f32) texel.x / atlas->width,
+    (f32) texel.y / atlas->height
+  };
+}
+
+// Finds the texel rect of a sprite's cells, measured from the bottom of the atlas, and
+// the UVs of its corners.
+static
+void resolve_sprite_uv(SpriteUV *entry, Resources *res)
+{
+  Vec2I region = res->regions != NULL ? res->regions[TEXTURE_SPRITE].pos : v2i(0, 0);
+
+  entry->cell_pos = (Vec2I) {
+    region.x + entry->coord.x * SPRITE_ATLAS_CELL,
+    region.y + ((SPRITE_ATLAS_HEIGHT/SPRITE_ATLAS_CELL) - entry->coord.y - entry->grid.y) * SPRITE_ATLAS_CELL
+  };
+
+  entry->cell_dim = (Vec2I) {
+    entry->grid.x * SPRITE_ATLAS_CELL,
+    entry->grid.y * SPRITE_ATLAS_CELL
+  };
+
+  if (res->atlas.width > 0)
+  {
+    entry->uv_min = atlas_uv(entry->cell_pos, &res->atlas);
+    entry->uv_max = atlas_uv(v2i(entry->cell_pos.x + entry->cell_dim.x, 
+                                       entry->cell_pos.y + entry->cell_dim.y), 
+                                   &res->atlas);
+  }
+}
+
+// Gives every sprite its own slot in the UV table, so drawing one is a lookup. Called
+// on the prefab sprites once they are set up, before any copies are taken.
+void bake_sprites(Sprite *sprites, u32 count)
+{
+  assert(sprite_uv_count + count <= SPRITE_UV_COUNT);
+
+  for (u32 i = 0; i < count; i++)
+  {
+    SpriteUV *entry = &sprite_uvs[sprite_uv_count];
+    entry->coord = sprites[i].coord;
+    entry->grid = sprites[i].grid;
+    resolve_sprite_uv(entry, &global.resources);
+
+    sprites[i].uv = sprite_uv_count++;
+  }
+}
+
 Resources load_resources(Arena *arena, String path)
 {
   Resources res = {0};
-  res.textures = arena_push(arena, R_Texture, TEXTURE_COUNT);
+  res.regions = arena_push(arena, R_TextureRegion, TEXTURE_COUNT);
   res.shaders = arena_push(arena, R_Shader, SHADER_COUNT);
 
   R_Shader primitive_shader = r_create_shader(PRIMITIVE_VERT_SRC, PRIMITIVE_FRAG_SRC);
@@ -139,25 +194,27 @@ Resources load_resources(Arena *arena, String path)
   R_Shader sprite_shader = r_create_shader(SPRITE_VERT_SRC, SPRITE_FRAG_SRC);
   res.shaders[1] = sprite_shader;
 
+  R_Shader sprite_instanced_shader = r_create_shader(SPRITE_INSTANCED_VERT_SRC, 
+                                                     SPRITE_INSTANCED_FRAG_SRC);
+  res.shaders[2] = sprite_instanced_shader;
+
   Arena scratch = get_scratch_arena(arena);
   {
-    String path_to_texture;
-    R_Texture texture;
-
-    path_to_texture = str_concat(path, str("/texture/sprites.png"), &scratch);
-    texture = r_create_texture(path_to_texture);
-    res.textures[0] = texture;
-
-    path_to_texture = str_concat(path, str("/texture/font.png"), &scratch);
-    texture = r_create_texture(path_to_texture);
-    res.textures[1] = texture;
-    
-    path_to_texture = str_concat(path, str("/texture/scene.png"), &scratch);
-    texture = r_create_texture(path_to_texture);
-    res.textures[2] = texture;
+    String paths[3];
+    paths[TEXTURE_SPRITE] = str_concat(path, str("/texture/sprites.png"), &scratch);
+    paths[TEXTURE_FONT] = str_concat(path, str("/texture/font.png"), &scratch);
+    paths[TEXTURE_SCENE] = str_concat(path, str("/texture/scene.png"), &scratch);
+
+    res.atlas = r_create_texture_atlas(paths, 3, res.regions, &scratch);
   }
   arena_clear(&scratch);
 
+  // NOTE(dg): Sprites baked before the atlas existed are placed now that it does.
+  for (u32 i = 1; i < sprite_uv_count; i++)
+  {
+    resolve_sprite_uv(&sprite_uvs[i], &res);
+  }
+
   return res;
 }
 
@@ -169,51 +226,43 @@ R_Shader *get_shader(u8 type)
 // Draw /////////////////////////////////////////////////////////////////////////////
 
 static inline
-Vec2F get_tl(Vec2I coords, f32 size, f32 w, f32 h)
+Vec2I glyph_cell_pos(Vec2I tex_coord)
 {
-  return (Vec2F) {
-    ((f32) coords.x * size) / w, 
-    ((f32) (coords.y+1) * size) / h
-  };
-}
+  Vec2I region = global.resources.regions[TEXTURE_FONT].pos;
 
-static inline
-Vec2F get_tr(Vec2I coords, f32 size, f32 w, f32 h)
-{
-  return (Vec2F) {
-    ((f32) (coords.x+1) * size) / w, 
-    ((f32) (coords.y+1) * size) / h
+  return (Vec2I) {
+    region.x + tex_coord.x * GLYPH_ATLAS_CELL,
+    region.y + ((GLYPH_ATLAS_HEIGHT/GLYPH_ATLAS_CELL) - tex_coord.y - 1) * GLYPH_ATLAS_CELL
   };
 }
 
-static inline
-Vec2F get_br(Vec2I coords, f32 size, f32 w, f32 h)
+// Pushes a quad spanning uv_min to uv_max, with p0 to p3 going clockwise from the top
+// left.
+static
+void push_atlas_quad(Vec3F p0, Vec3F p1, Vec3F p2, Vec3F p3, 
+                     Vec4F tint, 
+                     Vec4F color, 
+                     Vec2F uv_min, 
+                     Vec2F uv_max)
 {
-  return (Vec2F) {
-    ((f32) (coords.x+1) * size) / w, 
-    ((f32) coords.y * size) / h
-  };
-}
-
-static inline
-Vec2F get_bl(Vec2I coords, f32 size, f32 w, f32 h)
-{
-  return (Vec2F) {
-    ((f32) coords.x * size) / w, 
-    ((f32) coords.y * size) / h
-  };
+  R_Renderer *renderer = &global.renderer;
+  r_push_vertex(renderer, p0, tint, color, v2f(uv_min.x, uv_max.y));
+  r_push_vertex(renderer, p1, tint, color, uv_max);
+  r_push_vertex(renderer, p2, tint, color, v2f(uv_max.x, uv_min.y));
+  r_push_vertex(renderer, p3, tint, color, uv_min);
+  r_push_quad(renderer);
 }
 
 inline
 void clear_frame(Vec4F color)
 {
-  glClearColor(color.r, color.g, color.b, color.a);
-  glClear(GL_COLOR_BUFFER_BIT);
+  r_clear(color);
 }
 
 void draw_rect(Vec2F pos, Vec2F dim, f32 rot, Vec4F tint)
 {
   R_Renderer *renderer = &global.renderer;
+  r_use_texture(renderer, R_NIL_TEXTURE);
   r_use_shader(renderer, &global.resources.shaders[SHADER_PRIMITIVE]);
 
   Mat3x3F xform = m3x3f(1.0f);
@@ -229,24 +278,26 @@ void draw_rect(Vec2F pos, Vec2F dim, f32 rot, Vec4F tint)
   r_push_vertex(renderer, p1, tint, V4F_ZERO, V2F_ZERO);
   r_push_vertex(renderer, p2, tint, V4F_ZERO, V2F_ZERO);
   r_push_vertex(renderer, p3, tint, V4F_ZERO, V2F_ZERO);
-  r_push_quad_indices(renderer);
+  r_push_quad(renderer);
 }
 
 void draw_rect_v(Vec3F p0, Vec3F p1, Vec3F p2, Vec3F p3, Vec4F tint)
 {
   R_Renderer *renderer = &global.renderer;
+  r_use_texture(renderer, R_NIL_TEXTURE);
   r_use_shader(renderer, &global.resources.shaders[SHADER_PRIMITIVE]);
 
   r_push_vertex(renderer, p0, tint, V4F_ZERO, V2F_ZERO);
   r_push_vertex(renderer, p1, tint, V4F_ZERO, V2F_ZERO);
   r_push_vertex(renderer, p2, tint, V4F_ZERO, V2F_ZERO);
   r_push_vertex(renderer, p3, tint, V4F_ZERO, V2F_ZERO);
-  r_push_quad_indices(renderer);
+  r_push_quad(renderer);
 }
 
 void draw_rect_x(Mat3x3F xform, Vec4F tint)
 {
   R_Renderer *renderer = &global.renderer;
+  r_use_texture(renderer, R_NIL_TEXTURE);
   r_use_shader(renderer, &global.resources.shaders[SHADER_PRIMITIVE]);
 
   Vec3F p0 = transform_3f(v3f(-8.0f,  8.0f, 1.0f), xform); // tl
@@ -258,13 +309,35 @@ void draw_rect_x(Mat3x3F xform, Vec4F tint)
   r_push_vertex(renderer, p1, tint, V4F_ZERO, V2F_ZERO);
   r_push_vertex(renderer, p2, tint, V4F_ZERO, V2F_ZERO);
   r_push_vertex(renderer, p3, tint, V4F_ZERO, V2F_ZERO);
-  r_push_quad_indices(renderer);
+  r_push_quad(renderer);
 }
 
 void draw_sprite(Vec2F pos, Vec2F dim, f32 rot, Vec4F tint, Sprite sprite, bool flash)
 {
   R_Renderer *renderer = &global.renderer;
-  r_use_texture(renderer, &global.resources.textures[TEXTURE_SPRITE]);
+  r_use_texture(renderer, &global.resources.atlas);
+
+  if (renderer->instancing)
+  {
+    // NOTE(dg): The quad is anchored at its bottom left corner, so the centre is moved
+    // half the rotated dim away from pos.
+    f32 c = cos_1f(rot * RADIANS);
+    f32 s = sin_1f(rot * RADIANS);
+
+    Mat3x3F xform = m3x3f(1.0f);
+    xform.e[0][0] = c * dim.x;
+    xform.e[0][1] = -s * dim.y;
+    xform.e[0][2] = pos.x + (c * dim.x - s * dim.y) / 2;
+    xform.e[1][0] = s * dim.x;
+    xform.e[1][1] = c * dim.y;
+    xform.e[1][2] = pos.y + (s * dim.x + c * dim.y) / 2;
+
+    SpriteUV *uv = &sprite_uvs[sprite.uv];
+    r_use_shader(renderer, &global.resources.shaders[SHADER_SPRITE_INSTANCED]);
+    r_push_instance(renderer, xform, tint, uv->cell_pos, uv->cell_dim, flash ? 1.0f : 0.0f);
+    return;
+  }
+
   r_use_shader(renderer, &global.resources.shaders[SHADER_SPRITE]);
 
   Mat3x3F xform = m3x3f(1.0f);
@@ -277,78 +350,40 @@ void draw_sprite(Vec2F pos, Vec2F dim, f32 rot, Vec4F tint, Sprite sprite, bool
   Vec3F p2 = transform_3f(v3f(1.0f, 0.0f, 1.0f), xform); // br
   Vec3F p3 = transform_3f(v3f(0.0f, 0.0f, 1.0f), xform); // bl
 
-  sprite.coord.y = (SPRITE_ATLAS_HEIGHT/SPRITE_ATLAS_CELL) - sprite.coord.y - 1;
-
-  Vec2F top_left = get_tl(v2i(sprite.coord.x, sprite.coord.y), 
-                          SPRITE_ATLAS_CELL, 
-                          SPRITE_ATLAS_WIDTH, 
-                          SPRITE_ATLAS_HEIGHT);
-  
-  Vec2F top_right = get_tr(v2i(sprite.coord.x+sprite.grid.x-1, sprite.coord.y), 
-                           SPRITE_ATLAS_CELL, 
-                           SPRITE_ATLAS_WIDTH, 
-                           SPRITE_ATLAS_HEIGHT);
-
-  Vec2F bot_right = get_br(v2i(sprite.coord.x+sprite.grid.x-1, sprite.coord.y-(sprite.grid.y-1)), 
-                           SPRITE_ATLAS_CELL, 
-                           SPRITE_ATLAS_WIDTH, 
-                           SPRITE_ATLAS_HEIGHT);
-
-  Vec2F bot_left = get_bl(v2i(sprite.coord.x, sprite.coord.y-(sprite.grid.y-1)), 
-                          SPRITE_ATLAS_CELL, 
-                          SPRITE_ATLAS_WIDTH,
-                          SPRITE_ATLAS_HEIGHT);
-
+  SpriteUV *uv = &sprite_uvs[sprite.uv];
   Vec4F color = flash ? v4f(1, 1, 1, 0) : v4f(0, 0, 0, 0);
-
-  r_push_vertex(renderer, p0, tint, color, top_left);
-  r_push_vertex(renderer, p1, tint, color, top_right);
-  r_push_vertex(renderer, p2, tint, color, bot_right);
-  r_push_vertex(renderer, p3, tint, color, bot_left);
-  r_push_quad_indices(renderer);
+  push_atlas_quad(p0, p1, p2, p3, tint, color, uv->uv_min, uv->uv_max);
 }
 
 void draw_sprite_v(Vec3F p0, Vec3F p1, Vec3F p2, Vec3F p3, Vec4F tint, Sprite sprite, bool flash)
 {
   R_Renderer *renderer = &global.renderer;
-  r_use_texture(renderer, &global.resources.textures[TEXTURE_SPRITE]);
+  r_use_texture(renderer, &global.resources.atlas);
   r_use_shader(renderer, &global.resources.shaders[SHADER_SPRITE]);
 
-  sprite.coord.y = (SPRITE_ATLAS_HEIGHT/SPRITE_ATLAS_CELL) - sprite.coord.y - 1;
-  
-  Vec2F top_left = get_tl(v2i(sprite.coord.x, sprite.coord.y), 
-                          SPRITE_ATLAS_CELL, 
-                          SPRITE_ATLAS_WIDTH, 
-                          SPRITE_ATLAS_HEIGHT);
-  
-  Vec2F top_right = get_tr(v2i(sprite.coord.x+sprite.grid.x-1, sprite.coord.y), 
-                           SPRITE_ATLAS_CELL, 
-                           SPRITE_ATLAS_WIDTH, 
-                           SPRITE_ATLAS_HEIGHT);
-
-  Vec2F bot_right = get_br(v2i(sprite.coord.x+sprite.grid.x-1, sprite.coord.y-(sprite.grid.y-1)), 
-                           SPRITE_ATLAS_CELL, 
-                           SPRITE_ATLAS_WIDTH, 
-                           SPRITE_ATLAS_HEIGHT);
-
-  Vec2F bot_left = get_bl(v2i(sprite.coord.x, sprite.coord.y-(sprite.grid.y-1)), 
-                          SPRITE_ATLAS_CELL, 
-                          SPRITE_ATLAS_WIDTH,
-                          SPRITE_ATLAS_HEIGHT);
-
+  SpriteUV *uv = &sprite_uvs[sprite.uv];
   Vec4F color = flash ? v4f(1, 1, 1, 0) : v4f(0, 0, 0, 0);
-
-  r_push_vertex(renderer, p0, tint, color, top_left);
-  r_push_vertex(renderer, p1, tint, color, top_right);
-  r_push_vertex(renderer, p2, tint, color, bot_right);
-  r_push_vertex(renderer, p3, tint, color, bot_left);
-  r_push_quad_indices(renderer);
+  push_atlas_quad(p0, p1, p2, p3, tint, color, uv->uv_min, uv->uv_max);
 }
 
 void draw_sprite_x(Mat3x3F xform, Vec2F dim, Vec4F tint, Sprite sprite, bool flash)
 {
   R_Renderer *renderer = &global.renderer;
-  r_use_texture(renderer, &global.resources.textures[TEXTURE_SPRITE]);
+  r_use_texture(renderer, &global.resources.atlas);
+
+  if (renderer->instancing)
+  {
+    xform.e[0][0] *= dim.width;
+    xform.e[1][0] *= dim.width;
+    xform.e[0][1] *= dim.height;
+    xform.e[1][1] *= dim.height;
+
+    SpriteUV *uv = &sprite_uvs[sprite.uv];
+    r_use_shader(renderer, &global.resources.shaders[SHADER_SPRITE_INSTANCED]);
+    r_push_instance(renderer, xform, tint, uv->cell_pos, uv->cell_dim, flash ? 1.0f : 0.0f);
+    return;
+  }
+
   r_use_shader(renderer, &global.resources.shaders[SHADER_SPRITE]);
 
   Vec3F p0 = transform_3f(v3f(-dim.width/2,  dim.height/2, 1.0f), xform); // tl
@@ -356,79 +391,34 @@ void draw_sprite_x(Mat3x3F xform, Vec2F dim, Vec4F tint, Sprite sprite, bool fla
   Vec3F p2 = transform_3f(v3f( dim.width/2, -dim.height/2, 1.0f), xform); // br
   Vec3F p3 = transform_3f(v3f(-dim.width/2, -dim.height/2, 1.0f), xform); // bl
 
-  sprite.coord.y = (SPRITE_ATLAS_HEIGHT/SPRITE_ATLAS_CELL) - sprite.coord.y - 1;
-
-  Vec2F top_left = get_tl(v2i(sprite.coord.x, sprite.coord.y), 
-                          SPRITE_ATLAS_CELL, 
-                          SPRITE_ATLAS_WIDTH, 
-                          SPRITE_ATLAS_HEIGHT);
-  
-  Vec2F top_right = get_tr(v2i(sprite.coord.x+sprite.grid.x-1, sprite.coord.y), 
-                           SPRITE_ATLAS_CELL, 
-                           SPRITE_ATLAS_WIDTH, 
-                           SPRITE_ATLAS_HEIGHT);
-
-  Vec2F bot_right = get_br(v2i(sprite.coord.x+sprite.grid.x-1, sprite.coord.y-(sprite.grid.y-1)), 
-                           SPRITE_ATLAS_CELL, 
-                           SPRITE_ATLAS_WIDTH, 
-                           SPRITE_ATLAS_HEIGHT);
-
-  Vec2F bot_left = get_bl(v2i(sprite.coord.x, sprite.coord.y-(sprite.grid.y-1)), 
-                          SPRITE_ATLAS_CELL, 
-                          SPRITE_ATLAS_WIDTH,
-                          SPRITE_ATLAS_HEIGHT);
-
+  SpriteUV *uv = &sprite_uvs[sprite.uv];
   Vec4F color = flash ? v4f(1, 1, 1, 0) : v4f(0, 0, 0, 0);
-
-  r_push_vertex(renderer, p0, tint, color, top_left);
-  r_push_vertex(renderer, p1, tint, color, top_right);
-  r_push_vertex(renderer, p2, tint, color, bot_right);
-  r_push_vertex(renderer, p3, tint, color, bot_left);
-  r_push_quad_indices(renderer);
-}
-
-static inline
-
-Vec2F uv_tl(Vec2I coords, f32 size, f32 w, f32 h)
-{
-  return (Vec2F) {
-    (((coords.x  ) * size)) / w, 
-    (((coords.y+1) * size)) / h
-  };
-}
-
-static inline
-Vec2F uv_tr(Vec2I coords, f32 size, f32 w, f32 h)
-{
-  return (Vec2F) {
-    (((coords.x+1) * size)) / w, 
-    (((coords.y+1) * size)) / h
-  };
-}
-
-static inline
-
-Vec2F uv_br(Vec2I coords, f32 size, f32 w, f32 h)
-{
-  return (Vec2F) {
-    (((coords.x+1) * size)) / w, 
-    (((coords.y  ) * size)) / h
-  };
-}
-
-static inline
-Vec2F uv_bl(Vec2I coords, f32 size, f32 w, f32 h)
-{
-  return (Vec2F) {
-    (((coords.x  ) * size)) / w, 
-    (((coords.y  ) * size)) / h
-  };
+  push_atlas_quad(p0, p1, p2, p3, tint, color, uv->uv_min, uv->uv_max);
 }
 
 void draw_glyph(Vec2F pos, f32 size, Vec4F tint, Vec2I tex_coord)
 {
   R_Renderer *renderer = &global.renderer;
-  r_use_texture(renderer, &global.resources.textures[TEXTURE_FONT]);
+  r_use_texture(renderer, &global.resources.atlas);
+
+  if (renderer->instancing)
+  {
+    Mat3x3F xform = m3x3f(1.0f);
+    xform.e[0][0] = size;
+    xform.e[0][2] = pos.x + size / 2;
+    xform.e[1][1] = size;
+    xform.e[1][2] = pos.y + size / 2;
+
+    r_use_shader(renderer, &global.resources.shaders[SHADER_SPRITE_INSTANCED]);
+    r_push_instance(renderer, 
+                    xform, 
+                    tint, 
+                    glyph_cell_pos(tex_coord), 
+                    v2i(GLYPH_ATLAS_CELL, GLYPH_ATLAS_CELL), 
+                    0.0f);
+    return;
+  }
+
   r_use_shader(renderer, &global.resources.shaders[SHADER_SPRITE]);
 
   Mat3x3F xform = m3x3f(1.0f);
@@ -440,23 +430,38 @@ void draw_glyph(Vec2F pos, f32 size, Vec4F tint, Vec2I tex_coord)
   Vec3F p2 = transform_3f(v3f(1.0f, 0.0f, 1.0f), xform); // br
   Vec3F p3 = transform_3f(v3f(0.0f, 0.0f, 1.0f), xform); // bl
 
-  tex_coord.y = (GLYPH_ATLAS_HEIGHT/GLYPH_ATLAS_CELL) - tex_coord.y - 1;
-  Vec2F top_left = uv_tl(tex_coord, GLYPH_ATLAS_CELL, GLYPH_ATLAS_WIDTH, GLYPH_ATLAS_HEIGHT);
-  Vec2F top_right = uv_tr(tex_coord, GLYPH_ATLAS_CELL, GLYPH_ATLAS_WIDTH, GLYPH_ATLAS_HEIGHT);
-  Vec2F bot_right = uv_br(tex_coord, GLYPH_ATLAS_CELL, GLYPH_ATLAS_WIDTH, GLYPH_ATLAS_HEIGHT);
-  Vec2F bot_left = uv_bl(tex_coord, GLYPH_ATLAS_CELL, GLYPH_ATLAS_WIDTH, GLYPH_ATLAS_HEIGHT);
-
-  r_push_vertex(renderer, p0, tint, V4F_ZERO, top_left);
-  r_push_vertex(renderer, p1, tint, V4F_ZERO, top_right);
-  r_push_vertex(renderer, p2, tint, V4F_ZERO, bot_right);
-  r_push_vertex(renderer, p3, tint, V4F_ZERO, bot_left);
-  r_push_quad_indices(renderer);
+  R_Texture *atlas = &global.resources.atlas;
+  Vec2I cell_pos = glyph_cell_pos(tex_coord);
+  Vec2I cell_end = v2i(cell_pos.x + GLYPH_ATLAS_CELL, cell_pos.y + GLYPH_ATLAS_CELL);
+
+  push_atlas_quad(p0, p1, p2, p3, 
+                  tint, 
+                  V4F_ZERO, 
+                  atlas_uv(cell_pos, atlas), 
+                  atlas_uv(cell_end, atlas));
 }
 
 void draw_scene(Vec2F pos, Vec2F dim, Vec4F tint)
 {
   R_Renderer *renderer = &global.renderer;
-  r_use_texture(renderer, &global.resources.textures[TEXTURE_SCENE]);
+  R_TextureRegion *region = &global.resources.regions[TEXTURE_SCENE];
+  r_use_texture(renderer, &global.resources.atlas);
+
+  // NOTE(dg): The scene goes through the same instanced shader as sprites and glyphs,
+  // so with everything in the atlas a frame of them is drawn together.
+  if (renderer->instancing)
+  {
+    Mat3x3F xform = m3x3f(1.0f);
+    xform.e[0][0] = dim.x;
+    xform.e[0][2] = pos.x + dim.x / 2;
+    xform.e[1][1] = dim.y;
+    xform.e[1][2] = pos.y + dim.y / 2;
+
+    r_use_shader(renderer, &global.resources.shaders[SHADER_SPRITE_INSTANCED]);
+    r_push_instance(renderer, xform, tint, region->pos, region->dim, 0.0f);
+    return;
+  }
+
   r_use_shader(renderer, &global.resources.shaders[SHADER_SPRITE]);
 
   Mat3x3F xform = m3x3f(1.0f);
@@ -467,9 +472,175 @@ void draw_scene(Vec2F pos, Vec2F dim, Vec4F tint)
   Vec3F p2 = transform_3f(v3f(dim.x, 0.0f, 1.0f), xform); // br
   Vec3F p3 = transform_3f(v3f(0.0f, 0.0f, 1.0f), xform); // bl
 
-  r_push_vertex(renderer, p0, tint, V4F_ZERO, v2f(0, 1));
-  r_push_vertex(renderer, p1, tint, V4F_ZERO, v2f(1, 1));
-  r_push_vertex(renderer, p2, tint, V4F_ZERO, v2f(1, 0));
-  r_push_vertex(renderer, p3, tint, V4F_ZERO, v2f(0, 0));
-  r_push_quad_indices(renderer);
+  R_Texture *atlas = &global.resources.atlas;
+  Vec2I region_end = v2i(region->pos.x + region->dim.x, region->pos.y + region->dim.y);
+
+  push_atlas_quad(p0, p1, p2, p3, 
+                  tint, 
+                  V4F_ZERO, 
+                  atlas_uv(region->pos, atlas), 
+                  atlas_uv(region_end, atlas));
+}
+
+// @Cull /////////////////////////////////////////////////////////////////////////////////
+
+// Tests four bounding boxes against the view. Each is centred on x, y and reaches ext_x,
+// ext_y to either side. Bit i of the result is set when box i overlaps the view.
+u32 view_mask_f32x4(F32x4 x, F32x4 y, F32x4 ext_x, F32x4 ext_y)
+{
+  F32x4 zero = f32x4(0.0f);
+  F32x4 width = f32x4(global.renderer.width);
+  F32x4 height = f32x4(global.renderer.height);
+
+  F32x4 mask = ge_f32x4(add_f32x4(x, ext_x), zero);
+  mask = and_f32x4(mask, le_f32x4(sub_f32x4(x, ext_x), width));
+  mask = and_f32x4(mask, ge_f32x4(add_f32x4(y, ext_y), zero));
+  mask = and_f32x4(mask, le_f32x4(sub_f32x4(y, ext_y), height));
+
+  return mask_bits_f32x4(mask);
+}
+
+// @Text /////////////////////////////////////////////////////////////////////////////////
+
+static TextCache text_cache;
+
+static inline
+bool is_word_char(char c)
+{
+  return (c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z');
+}
+
+static inline
+u64 text_hash(String text)
+{
+  // NOTE(dg): FNV-1a. Zero marks an empty slot, so it is never handed out.
+  u64 hash = 14695981039346656037ULL;
+  for (u64 i = 0; i < text.len; i++)
+  {
+    hash ^= (u8) text.data[i];
+    hash *= 1099511628211ULL;
+  }
+
+  return hash != 0 ? hash : 1;
+}
+
+// Breaks text into words at anything that isn't a letter and places each glyph,
+// wrapping a word to the next line when it would cross width.
+static
+void layout_text(TextLayout *layout, String text)
+{
+  const f32 scale = (f32) layout->size / GLYPH_ATLAS_CELL;
+  f32 advance_pad = layout->spacing.x * scale;
+  f32 space_advance = layout->space_width * scale;
+
+  Vec2F offset = V2F_ZERO;
+  u32 word_start_pos = 0;
+  f32 word_len = 0;
+
+  for (u32 chr_idx = 0; chr_idx < text.len; chr_idx++)
+  {
+    char chr = text.data[chr_idx];
+    word_len += chr != ' ' ? get_glyph(chr).dim.width * scale + advance_pad : space_advance;
+
+    if (is_word_char(chr) && chr_idx != text.len-1) continue;
+
+    // - Move to next line ---
+    if (offset.x > 0 && offset.x + word_len > layout->width)
+    {
+      offset.x = 0;
+      offset.y -= layout->spacing.y * scale + layout->size;
+    }
+
+    // - Place the word ---
+    for (u32 i = word_start_pos; i <= chr_idx; i++)
+    {
+      chr = text.data[i];
+      if (chr == ' ')
+      {
+        offset.x += space_advance;
+        continue;
+      }
+
+      UI_Glyph glyph = get_glyph(chr);
+      text_cache.glyphs[layout->first + layout->count++] = (TextGlyph) {
+        .pos = add_2f(scale_2f(glyph.off, scale), offset),
+        .coords = glyph.coords,
+      };
+
+      offset.x += glyph.dim.width * scale + advance_pad;
+    }
+
+    word_start_pos = chr_idx + 1;
+    word_len = 0;
+  }
+}
+
+// Draws text from its cached layout, laying it out first if this is the first time
+// it has been drawn with these parameters.
+void draw_text(String text, Vec2F pos, u32 size, f32 width, Vec2F spacing, u32 space_width, Vec4F tint)
+{
+  u64 hash = text_hash(text);
+
+  // NOTE(dg): Layouts are never evicted one at a time. Once the table is three quarters
+  // full or the glyphs may not fit, the whole cache is dropped and refilled.
+  if (text_cache.layout_count >= TEXT_CACHE_LAYOUTS * 3 / 4 || 
+      text_cache.glyph_count + text.len > TEXT_CACHE_GLYPHS)
+  {
+    for (u32 i = 0; i < TEXT_CACHE_LAYOUTS; i++)
+    {
+      text_cache.layouts[i].hash = 0;
+    }
+
+    text_cache.layout_count = 0;
+    text_cache.glyph_count = 0;
+  }
+
+  TextLayout *layout = NULL;
+  for (u32 i = hash & (TEXT_CACHE_LAYOUTS-1);; i = (i+1) & (TEXT_CACHE_LAYOUTS-1))
+  {
+    TextLayout *slot = &text_cache.layouts[i];
+    if (slot->hash == 0)
+    {
+      *slot = (TextLayout) {
+        .hash = hash,
+        .size = size,
+        .width = width,
+        .spacing = spacing,
+        .space_width = space_width,
+        .first = text_cache.glyph_count,
+      };
+
+      layout_text(slot, text);
+      text_cache.glyph_count += slot->count;
+      text_cache.layout_count++;
+      text_cache.stats.layout_count++;
+
+      layout = slot;
+      break;
+    }
+
+    if (slot->hash == hash && 
+        slot->size == size && 
+        slot->width == width && 
+        slot->spacing.x == spacing.x && 
+        slot->spacing.y == spacing.y && 
+        slot->space_width == space_width)
+    {
+      text_cache.stats.hit_count++;
+      layout = slot;
+      break;
+    }
+  }
+
+  for (u32 i = layout->first; i < layout->first + layout->count; i++)
+  {
+    TextGlyph *glyph = &text_cache.glyphs[i];
+    draw_glyph(add_2f(pos, glyph->pos), size, tint, glyph->coords);
+  }
+}
+
+inline
+TextStats *get_text_stats(void)
+{
+  return &text_cache.stats;
 }
@@ -4,6 +4,7 @@
 #include "render/render.h"
 #include "ui/ui.h"
 
+// NOTE(dg): Every texture is packed into one atlas. These index its regions.
 #define TEXTURE_SPRITE 0
 #define TEXTURE_FONT 1
 #define TEXTURE_SCENE 2
@@ -18,6 +19,12 @@
 
 #define SHADER_PRIMITIVE 0
 #define SHADER_SPRITE 1
+#define SHADER_SPRITE_INSTANCED 2
+
+#define LAYER_SCENE 0
+#define LAYER_SPRITE 1
+#define LAYER_PRIMITIVE 2
+#define LAYER_UI 3
 
 #define DEBUG_BLACK ((Vec4F) {0.0f, 0.0f, 0.0f, 1.0f})
 #define DEBUG_WHITE ((Vec4F) {1.0f, 1.0f, 1.0f, 1.0f})
@@ -34,22 +41,42 @@ typedef struct Entity Entity;
 #define TEXTURE_COUNT 8
 #define SHADER_COUNT 8
 
+#define SPRITE_UV_COUNT 128
+
+// NOTE(dg): uv indexes the sprite UV table and is filled in by bake_sprites. The zero
+// slot is an empty rect, so a sprite that was never baked draws nothing.
 typedef struct Sprite Sprite;
 struct Sprite
 {
   Vec2I coord;
   Vec2I grid;
+  u32 uv;
+};
+
+// Where a sprite's cells ended up in the atlas, in texels for instances and in UVs for
+// quads.
+typedef struct SpriteUV SpriteUV;
+struct SpriteUV
+{
+  Vec2I coord;
+  Vec2I grid;
+  Vec2I cell_pos;
+  Vec2I cell_dim;
+  Vec2F uv_min;
+  Vec2F uv_max;
 };
 
 typedef struct Resources Resources;
 struct Resources
 {
-  R_Texture *textures;
+  R_Texture atlas;
+  R_TextureRegion *regions;
   R_Shader *shaders;
 };
 
 Resources load_resources(Arena *arena, String path);
 R_Shader *get_shader(u8 type);
+void bake_sprites(Sprite *sprites, u32 count);
 
 UI_Glyph get_glyph(char glyph);
 
@@ -67,3 +94,54 @@ void draw_sprite_x(Mat3x3F xform, Vec2F dim, Vec4F tint, Sprite sprite, bool fla
 
 void draw_scene(Vec2F pos, Vec2F dim, Vec4F tint);
 void draw_glyph(Vec2F pos, f32 size, Vec4F tint, Vec2I tex_coord);
+
+// @Cull /////////////////////////////////////////////////////////////////////////////////
+
+u32 view_mask_f32x4(F32x4 x, F32x4 y, F32x4 ext_x, F32x4 ext_y);
+
+// @Text /////////////////////////////////////////////////////////////////////////////////
+
+#define TEXT_CACHE_LAYOUTS 256
+#define TEXT_CACHE_GLYPHS 8192
+
+typedef struct TextGlyph TextGlyph;
+struct TextGlyph
+{
+  Vec2F pos;
+  Vec2I coords;
+};
+
+// A laid out string. Its glyphs are a run in the cache's glyph buffer, placed relative
+// to where the text is drawn.
+typedef struct TextLayout TextLayout;
+struct TextLayout
+{
+  u64 hash;
+  u32 size;
+  f32 width;
+  Vec2F spacing;
+  u32 space_width;
+  u32 first;
+  u32 count;
+};
+
+typedef struct TextStats TextStats;
+struct TextStats
+{
+  u32 layout_count;
+  u32 hit_count;
+  u64 layout_ticks;
+};
+
+typedef struct TextCache TextCache;
+struct TextCache
+{
+  TextLayout layouts[TEXT_CACHE_LAYOUTS];
+  u32 layout_count;
+  TextGlyph glyphs[TEXT_CACHE_GLYPHS];
+  u32 glyph_count;
+  TextStats stats;
+};
+
+void draw_text(String text, Vec2F pos, u32 size, f32 width, Vec2F spacing, u32 space_width, Vec4F tint);
+TextStats *get_text_stats(void);
@@ -19,8 +19,8 @@ Entity *create_entity(EntityType type)
 {
   Entity *en = alloc_entity();
   en->type = type;
-  en->is_active = TRUE;
-  en->xform = m3x3f(1.0f);
+  en_is_active(en) = TRUE;
+  en_xform(en) = m3x3f(1.0f);
   en->dim = v2f(16, 16);
   en->scale = v2f(1, 1);
   en->tint = v4f(1.0f, 1.0f, 1.0f, 1.0f);
@@ -33,7 +33,7 @@ Entity *create_entity(EntityType type)
     en->tint = DEBUG_YELLOW;
     break;
   case EntityType_Player:
-    en->props = EntityProp_Renders | 
+    en_props(en) = EntityProp_Renders | 
                 EntityProp_Collides | 
                 EntityProp_Controlled | 
                 EntityProp_Moves | 
@@ -46,17 +46,17 @@ Entity *create_entity(EntityType type)
     en->sprite = prefab.sprite.player_male_idle;
     en->scale = v2f(SPRITE_SCALE, SPRITE_SCALE);
     en->health = prefab.player_stat[EntityGender_Male].health;
-    en->invincibility_timer.duration = PLAYER_INVINCIBILITY_TIMER;
+    entity_add_timers(en)->invincibility.duration = PLAYER_INVINCIBILITY_TIMER;
 
     en->anim_descriptors = prefab.animation.player_male;
 
     entity_add_collider(en, Collider_Body);
     en->cols[Collider_Body]->col_type = P_ColliderType_Rect;
-    en->cols[Collider_Body]->pos = v2f(0, 0);
+    en_pos(en->cols[Collider_Body]) = v2f(0, 0);
     en->cols[Collider_Body]->scale = v2f(0.5, 1);
     break;
   case EntityType_Zombie:
-    en->props = EntityProp_Renders | 
+    en_props(en) = EntityProp_Renders | 
                 EntityProp_Moves | 
                 EntityProp_Collides |
                 EntityProp_AffectedByGravity |
@@ -66,18 +66,18 @@ Entity *create_entity(EntityType type)
     en->scale = v2f(SPRITE_SCALE, SPRITE_SCALE);
     break;
   case EntityType_Equipped:
-    en->props = EntityProp_Equipped;
+    en_props(en) = EntityProp_Equipped;
     en->draw_type = DrawType_Sprite;
     break;
   case EntityType_Ammo:
-    en->props = EntityProp_Renders | 
+    en_props(en) = EntityProp_Renders | 
                 EntityProp_Moves | 
                 EntityProp_Collides |
                 EntityProp_KillAfterTime;
     
     en->draw_type = DrawType_Sprite;
     en->move_type = MoveType_Projectile;
-    en->kill_timer.duration = BULLET_KILL_TIME;
+    entity_add_timers(en)->kill.duration = BULLET_KILL_TIME;
     en->scale = v2f(SPRITE_SCALE, SPRITE_SCALE);
 
     entity_add_collider(en, Collider_Hit);
@@ -88,16 +88,16 @@ Entity *create_entity(EntityType type)
     en->cols[Collider_Hit]->dim = V2F_ZERO;
     break;
   case EntityType_Collider:
-    en->props = EntityProp_Collides |
+    en_props(en) = EntityProp_Collides |
                 EntityProp_Renders;
     en->draw_type = DrawType_Primitive;
     break;
   case EntityType_Decoration:
-    en->props = EntityProp_Renders;
+    en_props(en) = EntityProp_Renders;
     en->draw_type = DrawType_Sprite;
     break;
   case EntityType_Collectable:
-    en->props = EntityProp_Renders |
+    en_props(en) = EntityProp_Renders |
                 EntityProp_BobsOverTime |
                 EntityProp_Collides;
 
@@ -112,13 +112,13 @@ Entity *create_entity(EntityType type)
     en->cols[Collider_Hit]->dim = V2F_ZERO;
     break;
   case EntityType_Egg:
-    en->props = EntityProp_Renders;
+    en_props(en) = EntityProp_Renders;
     en->draw_type = DrawType_Sprite;
     en->sprite = prefab.sprite.egg_0;
     en->scale = v2f(SPRITE_SCALE, SPRITE_SCALE);
     break;
   case EntityType_Shockwave:
-    en->props = EntityProp_Renders |
+    en_props(en) = EntityProp_Renders |
                 EntityProp_KillAfterTime |
                 EntityProp_Moves;
     en->draw_type = DrawType_Sprite;
@@ -128,7 +128,7 @@ Entity *create_entity(EntityType type)
     en->anim_descriptors = prefab.animation.shockwave;
     break;
   case EntityType_Merchant:
-    en->props = EntityProp_Renders;
+    en_props(en) = EntityProp_Renders;
     en->draw_type = DrawType_Sprite;
     en->sprite = prefab.sprite.wagon_left;
     en->dim = v2f(16 * 4, 16 * 2);
@@ -137,17 +137,21 @@ Entity *create_entity(EntityType type)
   default: break;
   }
 
+  entity_group_add(type_group(type), en);
+  entity_sync_prop_groups(en);
+
   return en;
 }
 
 Entity *spawn_entity(EntityType type, Vec2F pos)
 {
   Entity *en = create_entity(type);
-  en->pos = pos;
+  en_pos(en) = pos;
 
   entity_rem_prop(en, EntityProp_Renders);
-  en->is_active = FALSE;
+  en_is_active(en) = FALSE;
   en->marked_for_spawn = TRUE;
+  entity_group_add(EntityGroup_MarkedForSpawn, en);
 
   return en;
 }
@@ -155,7 +159,7 @@ Entity *spawn_entity(EntityType type, Vec2F pos)
 Entity *spawn_ammo(AmmoKind kind, Vec2F pos)
 {
   Entity *en = create_entity(EntityType_Ammo);
-  en->pos = pos;
+  en_pos(en) = pos;
 
   switch (kind)
   {
@@ -172,8 +176,9 @@ Entity *spawn_ammo(AmmoKind kind, Vec2F pos)
     break;
   }
 
-  en->is_active = FALSE;
+  en_is_active(en) = FALSE;
   en->marked_for_spawn = TRUE;
+  entity_group_add(EntityGroup_MarkedForSpawn, en);
   entity_rem_prop(en, EntityProp_Renders);
 
   return en;
@@ -182,18 +187,18 @@ Entity *spawn_ammo(AmmoKind kind, Vec2F pos)
 Entity *spawn_zombie(ZombieKind kind, Vec2F pos)
 {
   Entity *en = create_entity(EntityType_Zombie);
-  en->pos = pos;
+  en_pos(en) = pos;
   en->zombie_kind = kind;
 
   ZombieDesc desc = prefab.zombie[kind];
-  en->props |= desc.props;
+  entity_add_prop(en, (EntityProp) desc.props);
   en->move_type = desc.move_type;
   en->combat_type = desc.combat_type;
   en->health = desc.health;
   en->damage = desc.damage;
   en->speed = desc.speed;
   en->view_dist = 350.0f;
-  en->attack_timer.duration = desc.attack_cooldown;
+  entity_add_timers(en)->attack.duration = desc.attack_cooldown;
 
   switch (kind)
   {
@@ -205,12 +210,12 @@ Entity *spawn_zombie(ZombieKind kind, Vec2F pos)
 
     entity_add_collider(en, Collider_Body);
     en->cols[Collider_Body]->col_type = P_ColliderType_Rect;
-    en->cols[Collider_Body]->pos = v2f(0, 0);
+    en_pos(en->cols[Collider_Body]) = v2f(0, 0);
     en->cols[Collider_Body]->scale = v2f(0.5, 1);
 
     entity_add_collider(en, Collider_Hit);
     en->cols[Collider_Hit]->col_type = P_ColliderType_Rect;
-    en->cols[Collider_Hit]->pos = v2f(en->dim.width, 0);
+    en_pos(en->cols[Collider_Hit]) = v2f(en->dim.width, 0);
     en->cols[Collider_Hit]->scale = v2f(0.25, 0.5);
 
     break;
@@ -222,12 +227,12 @@ Entity *spawn_zombie(ZombieKind kind, Vec2F pos)
 
     entity_add_collider(en, Collider_Body);
     en->cols[Collider_Body]->col_type = P_ColliderType_Rect;
-    en->cols[Collider_Body]->pos = v2f(0, -4 * SPRITE_SCALE);
+    en_pos(en->cols[Collider_Body]) = v2f(0, -4 * SPRITE_SCALE);
     en->cols[Collider_Body]->scale = v2f(0.5, 0.5);
 
     entity_add_collider(en, Collider_Hit);
     en->cols[Collider_Hit]->col_type = P_ColliderType_Rect;
-    en->cols[Collider_Hit]->pos = v2f(20, -4 * SPRITE_SCALE);
+    en_pos(en->cols[Collider_Hit]) = v2f(20, -4 * SPRITE_SCALE);
     en->cols[Collider_Hit]->scale = v2f(0.2, 0.2);
 
     break;
@@ -239,12 +244,12 @@ Entity *spawn_zombie(ZombieKind kind, Vec2F pos)
 
     entity_add_collider(en, Collider_Body);
     en->cols[Collider_Body]->col_type = P_ColliderType_Rect;
-    en->cols[Collider_Body]->pos = v2f(0, -4 * SPRITE_SCALE);
+    en_pos(en->cols[Collider_Body]) = v2f(0, -4 * SPRITE_SCALE);
     en->cols[Collider_Body]->scale = v2f(0.5, 0.5);
 
     entity_add_collider(en, Collider_Hit);
     en->cols[Collider_Hit]->col_type = P_ColliderType_Rect;
-    en->cols[Collider_Hit]->pos = v2f(20, 0);
+    en_pos(en->cols[Collider_Hit]) = v2f(20, 0);
     en->cols[Collider_Hit]->scale = v2f(0.1, 0.1);
     
     break;
@@ -257,20 +262,21 @@ Entity *spawn_zombie(ZombieKind kind, Vec2F pos)
 
     entity_add_collider(en, Collider_Body);
     en->cols[Collider_Body]->col_type = P_ColliderType_Rect;
-    en->cols[Collider_Body]->pos = v2f(0, -6 * SPRITE_SCALE);
+    en_pos(en->cols[Collider_Body]) = v2f(0, -6 * SPRITE_SCALE);
     en->cols[Collider_Body]->scale = v2f(0.75, 1.25);
 
     entity_add_collider(en, Collider_Hit);
     en->cols[Collider_Hit]->col_type = P_ColliderType_Rect;
-    en->cols[Collider_Hit]->pos = v2f(5 * SPRITE_SCALE, -4 * SPRITE_SCALE);
+    en_pos(en->cols[Collider_Hit]) = v2f(5 * SPRITE_SCALE, -4 * SPRITE_SCALE);
     en->cols[Collider_Hit]->scale = v2f(0.25, 0.5);
 
     break;
   }
 
   entity_rem_prop(en, EntityProp_Renders);
-  en->is_active = FALSE;
+  en_is_active(en) = FALSE;
   en->marked_for_spawn = TRUE;
+  entity_group_add(EntityGroup_MarkedForSpawn, en);
 
   return en;
 }
@@ -280,39 +286,65 @@ Entity *spawn_collectable(CollectableKind kind, Vec2F pos)
   CollectableDesc desc = prefab.collectable[kind];
 
   Entity *en = create_entity(EntityType_Collectable);
-  en->pos = pos;
+  en_pos(en) = pos;
   en->item_kind = kind;
   en->sprite = desc.sprite;
-  en->bobbing.range = v2f(en->pos.y - 5, en->pos.y + 5);
+  en->bobbing.range = v2f(en_pos(en).y - 5, en_pos(en).y + 5);
   en->bobbing.state = -1;
 
   entity_rem_prop(en, EntityProp_Renders);
-  en->is_active = FALSE;
+  en_is_active(en) = FALSE;
   en->marked_for_spawn = TRUE;
+  entity_group_add(EntityGroup_MarkedForSpawn, en);
 
   return en;
 }
 
 Entity *spawn_particles(ParticleKind kind, Vec2F pos)
 {
+  if (game.deferring_commands)
+  {
+    defer_command((GameCommand) {
+      .kind = GameCommandKind_SpawnParticles, 
+      .particle_kind = kind, 
+      .pos = pos
+    });
+
+    return NIL_ENTITY;
+  }
+
   Entity *en = create_entity(EntityType_Any);
-  en->pos = pos;
+  en_pos(en) = pos;
 
   ParticleDesc desc = prefab.particle[kind];
-  en->particle_desc = desc;
+  EntityParticleGroup *group = entity_add_particle_group(en);
+  group->desc = desc;
+  if (alloc_particles(en, desc.count) == 0)
+  {
+    kill_entity(en, FALSE);
+  }
 
-  for (u32 i = 0; i < en->particle_desc.count; i++)
+  ParticleBuffer *buffer = &game.particle_buffer;
+  for (u32 i = group->first; i < group->first + group->count; i++)
   {
-    Particle *particle = get_next_free_particle();
-    particle->is_active = TRUE;
-    particle->pos = en->pos;
-    particle->scale = desc.scale;
-    particle->dir = (f32) random_i32(-en->particle_desc.spread, en->particle_desc.spread);
-    particle->rot = (f32) random_i32(-45, 45);
-    particle->color = desc.color_primary;
-    particle->vel = desc.vel;
-    particle->speed = desc.speed;
-    particle->owner = ref_from_entity(en);
+    f32 dir = (f32) random_i32(-desc.spread, desc.spread);
+    buffer->pos_x[i] = en_pos(en).x;
+    buffer->pos_y[i] = en_pos(en).y;
+    buffer->scale_x[i] = desc.scale.x;
+    buffer->scale_y[i] = desc.scale.y;
+    buffer->dir_sin[i] = sin_1f(dir);
+    buffer->dir_cos[i] = cos_1f(dir);
+    buffer->rot[i] = (f32) random_i32(-45, 45);
+    buffer->prev_pos_x[i] = buffer->pos_x[i];
+    buffer->prev_pos_y[i] = buffer->pos_y[i];
+    buffer->prev_rot[i] = buffer->rot[i];
+    buffer->color_r[i] = desc.color_primary.r;
+    buffer->color_g[i] = desc.color_primary.g;
+    buffer->color_b[i] = desc.color_primary.b;
+    buffer->color_a[i] = desc.color_primary.a;
+    buffer->vel_x[i] = desc.vel.x;
+    buffer->vel_y[i] = desc.vel.y;
+    buffer->speed[i] = desc.speed;
   }
 
   return en;
@@ -322,13 +354,13 @@ Entity *spawn_merchant(void)
 {
   Entity *en = create_entity(EntityType_Merchant);
   en->spid = SPID_Merchant;
-  en->pos = v2f(WIDTH/2, GROUND_Y+80);
+  en_pos(en) = v2f(WIDTH/2, GROUND_Y+80);
   en->state = EntityState_MerchantComing;
   en->scale = V2F_ZERO;
 
   Entity *slot_0 = create_entity(EntityType_Decoration);
-  slot_0->merchant_slot.kind = MerchantSlotKind_Weapon;
-  slot_0->pos = v2f(SPRITE_SCALE * -19, SPRITE_SCALE * 3);
+  entity_add_merchant_slot(slot_0)->kind = MerchantSlotKind_Weapon;
+  en_pos(slot_0) = v2f(SPRITE_SCALE * -19, SPRITE_SCALE * 3);
   slot_0->sprite = prefab.sprite.ui_slot_coin_empty;
   attach_entity_child(en, slot_0);
   
@@ -337,19 +369,19 @@ Entity *spawn_merchant(void)
   slot_populate_weapon(slot_0);
   entity_rem_prop(slot_0, EntityProp_Renders);
   entity_rem_prop(weapon_deco, EntityProp_Renders);
-  weapon_deco->is_active = TRUE;
+  en_is_active(weapon_deco) = TRUE;
 
   Entity *slot_1 = create_entity(EntityType_Decoration);
-  slot_1->merchant_slot.kind = MerchantSlotKind_Coin;
-  slot_1->pos = v2f(SPRITE_SCALE * -8, SPRITE_SCALE * 3);
+  entity_add_merchant_slot(slot_1)->kind = MerchantSlotKind_Coin;
+  en_pos(slot_1) = v2f(SPRITE_SCALE * -8, SPRITE_SCALE * 3);
   slot_1->sprite = prefab.sprite.ui_slot_coin_ammo;
   attach_entity_child(en, slot_1);
   slot_populate_ammo(slot_1);
   entity_rem_prop(slot_1, EntityProp_Renders);
 
   Entity *slot_2 = create_entity(EntityType_Decoration);
-  slot_2->merchant_slot.kind = MerchantSlotKind_Powerup;
-  slot_2->pos = v2f(SPRITE_SCALE * 15, SPRITE_SCALE * 3);
+  entity_add_merchant_slot(slot_2)->kind = MerchantSlotKind_Powerup;
+  en_pos(slot_2) = v2f(SPRITE_SCALE * 15, SPRITE_SCALE * 3);
   slot_2->sprite = prefab.sprite.ui_slot_soul_heal;
   attach_entity_child(en, slot_2);
   slot_populate_powerup(slot_2);
@@ -360,7 +392,19 @@ Entity *spawn_merchant(void)
 
 void kill_entity(Entity *en, bool slain)
 {
+  if (game.deferring_commands)
+  {
+    defer_command((GameCommand) {
+      .kind = GameCommandKind_KillEntity, 
+      .en = en, 
+      .slain = slain
+    });
+
+    return;
+  }
+
   en->marked_for_death = TRUE;
+  entity_group_add(EntityGroup_MarkedForDeath, en);
 
   push_event(EventType_EntityKilled, (EventDesc) {
     .en=en, 
@@ -374,33 +418,60 @@ void kill_entity(Entity *en, bool slain)
 inline
 bool entity_has_prop(Entity *en, EntityProp prop)
 {
-  return (en->props & prop) != 0;
+  return (en_props(en) & prop) != 0;
 }
 
 inline
 void entity_add_prop(Entity *en, EntityProp prop)
 {
-  en->props |= prop;
+  en_props(en) |= prop;
+  entity_sync_prop_groups(en);
 }
 
 inline
 void entity_rem_prop(Entity *en, EntityProp prop)
 {
-  en->props &= ~prop;
+  en_props(en) &= ~prop;
+  entity_sync_prop_groups(en);
 }
 
-Vec2F pos_from_entity(Entity *en)
+// Brings an entity's membership in the per-prop groups in line with its props
+void entity_sync_prop_groups(Entity *en)
 {
-  Mat3x3F mat = en->model_mat;
+  if (game.deferring_commands)
+  {
+    defer_command((GameCommand) {
+      .kind = GameCommandKind_SyncPropGroups, 
+      .en = en
+    });
+
+    return;
+  }
+
+  static const EntityProp group_props[EntityGroup_COUNT] = {
+    [EntityGroup_Moves] = EntityProp_Moves,
+    [EntityGroup_AffectedByGravity] = EntityProp_AffectedByGravity,
+    [EntityGroup_Renders] = EntityProp_Renders,
+    [EntityGroup_KillAfterTime] = EntityProp_KillAfterTime,
+  };
 
-  Entity *parent = entity_from_ref(en->parent);
-  while (entity_is_valid(parent))
+  for (u32 id = EntityGroup_Moves; id <= EntityGroup_KillAfterTime; id++)
   {
-    mat = mul_3x3f(parent->model_mat, mat);
-    parent = entity_from_ref(parent->parent);
+    if (en_props(en) & group_props[id])
+    {
+      entity_group_add(id, en);
+    }
+    else
+    {
+      entity_group_rem(id, en);
+    }
   }
+}
 
-  return v2f(mat.e[0][2], mat.e[1][2]);
+inline
+Vec2F pos_from_entity(Entity *en)
+{
+  return en->world.pos;
 }
 
 Vec2F pos_tl_from_entity(Entity *en)
@@ -447,75 +518,111 @@ Vec2F pos_br_from_entity(Entity *en)
   return result;
 }
 
+inline
 Vec2F dim_from_entity(Entity *en)
 {
-  Vec2F result = en->dim;
-  result = mul_2f(result, en->scale);
-
-  Entity *parent = entity_from_ref(en->parent);
-  while (entity_is_valid(parent))
-  {
-    result = mul_2f(result, parent->scale);
-    parent = entity_from_ref(parent->parent);
-  }
-
-  return result;
+  return mul_2f(en->dim, en->world.scale);
 }
 
+inline
 Vec2F scale_from_entity(Entity *en)
 {
-  Vec2F result = en->scale;
-
-  Entity *parent = entity_from_ref(en->parent);
-  while (entity_is_valid(parent))
-  {
-    result = mul_2f(result, parent->scale);
-    parent = entity_from_ref(parent->parent);
-  }
-
-  return result;
+  return en->world.scale;
 }
 
+inline
 f32 rot_from_entity(Entity *en)
 {
-  f32 result = en->rot;
-
-  Entity *parent = entity_from_ref(en->parent);
-  while (entity_is_valid(parent))
-  {
-    result += parent->rot;
-    parent = entity_from_ref(parent->parent);
-  }
-
-  return result;
+  return en->world.rot;
 }
 
+inline
 bool flip_x_from_entity(Entity *en)
 {
-  bool result = en->flip_x;
-
-  Entity *parent = entity_from_ref(en->parent);
-  while (entity_is_valid(parent))
-  {
-    result = parent->flip_x ? !result : result;
-    parent = entity_from_ref(parent->parent);
-  }
-
-  return result;
+  return en->world.flip_x;
 }
 
+inline
 bool flip_y_from_entity(Entity *en)
 {
-  bool result = en->flip_y;
+  return en->world.flip_y;
+}
 
-  Entity *parent = entity_from_ref(en->parent);
-  while (entity_is_valid(parent))
+// Rebuilds the model and world xforms of an entity whose parent is already up to date
+// for this tick. Returns FALSE without doing any work when neither the entity's local
+// values nor its parent's world xform changed since the last rebuild.
+bool update_entity_xform(Entity *en, Entity *parent)
+{
+  u64 slot = en_slot(en);
+  Vec2F pos = game.entities.pos[slot];
+  u32 parent_slot = (u32) en_slot(parent);
+
+  bool changed = en->xform_dirty ||
+                 parent->xform_changed ||
+                 parent_slot != en->local.parent_slot ||
+                 pos.x != en->local.pos.x || pos.y != en->local.pos.y ||
+                 en->scale.x != en->local.scale.x || en->scale.y != en->local.scale.y ||
+                 en->rot != en->local.rot ||
+                 en->flip_x != en->local.flip_x ||
+                 en->flip_y != en->local.flip_y;
+
+  if (!changed) return FALSE;
+
+  // NOTE(dg): A flip can't be blended into, so it is drawn as is.
+  if (en->flip_x != en->local.flip_x || en->flip_y != en->local.flip_y)
   {
-    result = parent->flip_y ? !result : result;
-    parent = entity_from_ref(parent->parent);
+    en->xform_snap = TRUE;
   }
 
-  return result;
+  en->xform_dirty = FALSE;
+  en->local.pos = pos;
+  en->local.scale = en->scale;
+  en->local.rot = en->rot;
+  en->local.flip_x = en->flip_x;
+  en->local.flip_y = en->flip_y;
+  en->local.parent_slot = parent_slot;
+
+  // The nil entity's world xform is zeroed every tick, so roots use the identity
+  Mat3x3F parent_xform = m3x3f(1.0f);
+  Vec2F parent_scale = v2f(1.0f, 1.0f);
+  f32 parent_rot = 0.0f;
+  bool parent_flip_x = FALSE;
+  bool parent_flip_y = FALSE;
+  if (entity_is_valid(parent))
+  {
+    parent_xform = game.entities.xform[parent_slot];
+    parent_scale = parent->world.scale;
+    parent_rot = parent->world.rot;
+    parent_flip_x = parent->world.flip_x;
+    parent_flip_y = parent->world.flip_y;
+  }
+
+  Mat3x3F xform = m3x3f(1.0f);
+
+  // Scale
+  xform = mul_3x3f(scale_3x3f(en->scale.x, en->scale.y), xform);
+  if (en->flip_x) xform = mul_3x3f(scale_3x3f(-1.0f, 1.0f), xform);
+  if (en->flip_y) xform = mul_3x3f(scale_3x3f(1.0f, -1.0f), xform);
+
+  // Rotate
+  xform = mul_3x3f(rotate_3x3f(en->rot * RADIANS), xform);
+
+  // Translate
+  xform = mul_3x3f(translate_3x3f(pos.x/parent_scale.x, pos.y/parent_scale.y), xform);
+
+  en->model_mat = xform;
+
+  // Move to world space
+  xform = mul_3x3f(parent_xform, xform);
+  game.entities.xform[slot] = xform;
+
+  en->world.pos = v2f(xform.e[0][2], xform.e[1][2]);
+  en->world.scale = mul_2f(en->scale, parent_scale);
+  en->world.rot = en->rot + parent_rot;
+  en->world.flip_x = en->flip_x != parent_flip_x;
+  en->world.flip_y = en->flip_y != parent_flip_y;
+
+  return TRUE;
 }
 
 void entity_look_at(Entity *en, Vec2F target_pos)
@@ -529,9 +636,9 @@ void entity_set_target(Entity *en, EntityRef target)
   Entity *target_entity = entity_from_ref(target);
   Vec2F target_pos = pos_from_entity(target_entity);
 
-  if (distance_2f(en->pos, target_pos) <= en->view_dist)
+  if (distance_2f(en_pos(en), target_pos) <= en->view_dist)
   {
-    Vec2F diff = v2f(target_pos.x - en->pos.x, target_pos.y - en->pos.y);
+    Vec2F diff = v2f(target_pos.x - en_pos(en).x, target_pos.y - en_pos(en).y);
     en->target_angle = atan_2f(diff);
     en->has_target = TRUE;
   }
@@ -556,6 +663,7 @@ void damage_entity(Entity *reciever, i16 damage)
 
   if (damage != 0)
   {
+    entity_add_timers(reciever);
     entity_add_prop(reciever, EntityProp_FlashWhite);
   }
 
@@ -570,10 +678,25 @@ void damage_entity(Entity *reciever, i16 damage)
 
 inline
 EntityRef ref_from_entity(Entity *en)
+{
+  EntityRef result = {0};
+
+  EntityList *list = &game.entities;
+  if (en >= list->data && en < list->data + list->count)
+  {
+    result.idx = (u32) (en - list->data);
+    result.gen = en->gen;
+  }
+
+  return result;
+}
+
+inline
+EntityRef ref_from_id(u64 id)
 {
   return (EntityRef) {
-    .ptr = en,
-    .id = en->id
+    .idx = (u32) id,
+    .gen = (u32) (id >> 32),
   };
 }
 
@@ -582,16 +705,84 @@ Entity *entity_from_ref(EntityRef ref)
 {
   Entity *result = NIL_ENTITY;
 
-  if (entity_is_valid(ref.ptr) && ref.ptr->id == ref.id && !ref.ptr->marked_for_death)
+  if (ref.idx < game.entities.count)
   {
-    result = ref.ptr;
+    Entity *en = &game.entities.data[ref.idx];
+    if (en->gen == ref.gen && en->type != EntityType_Nil && !en->marked_for_death)
+    {
+      result = en;
+    }
   }
 
   return result;
 }
 
+inline
+bool ref_equals(EntityRef a, EntityRef b)
+{
+  return a.idx == b.idx && a.gen == b.gen;
+}
+
 // @EntityList ///////////////////////////////////////////////////////////////////////////
 
+void init_entity_list(void)
+{
+  EntityList *list = &game.entities;
+  list->arena.pos = create_arena(GiB(1), FALSE);
+  list->arena.vel = create_arena(GiB(1), FALSE);
+  list->arena.new_vel = create_arena(GiB(1), FALSE);
+  list->arena.xform = create_arena(GiB(1), FALSE);
+  list->arena.prev_xform = create_arena(GiB(1), FALSE);
+  list->arena.props = create_arena(GiB(1), FALSE);
+  list->arena.is_active = create_arena(GiB(1), FALSE);
+  list->arena.group_mask = create_arena(GiB(1), FALSE);
+  list->arena.side = create_arena(GiB(1), FALSE);
+
+  for (u32 id = 0; id < EntityGroup_COUNT; id++)
+  {
+    list->arena.groups[id] = create_arena(GiB(1), FALSE);
+    list->groups[id].slots = arena_push(&list->arena.groups[id], u32, 1);
+  }
+
+  list->data = arena_push(&game.entity_arena, Entity, 1);
+  list->pos = arena_push(&list->arena.pos, Vec2F, 1);
+  list->vel = arena_push(&list->arena.vel, Vec2F, 1);
+  list->new_vel = arena_push(&list->arena.new_vel, Vec2F, 1);
+  list->xform = arena_push(&list->arena.xform, Mat3x3F, 1);
+  list->prev_xform = arena_push(&list->arena.prev_xform, Mat3x3F, 1);
+  list->props = arena_push(&list->arena.props, EntityProp, 1);
+  list->is_active = arena_push(&list->arena.is_active, bool, 1);
+  list->group_mask = arena_push(&list->arena.group_mask, u32, 1);
+  list->group_mask[0] = 0;
+  list->count = 1;
+
+  NIL_ENTITY = &list->data[0];
+  reset_nil_entity();
+}
+
+// NOTE(dg): Systems write through NIL_ENTITY instead of checking every ref, so it
+// gets wiped once per tick along with its components and side records.
+void reset_nil_entity(void)
+{
+  EntityList *list = &game.entities;
+  zero(list->data[0], Entity);
+  zero(list->pos[0], Vec2F);
+  zero(list->vel[0], Vec2F);
+  zero(list->new_vel[0], Vec2F);
+  zero(list->xform[0], Mat3x3F);
+  zero(list->prev_xform[0], Mat3x3F);
+  list->props[0] = 0;
+  list->is_active[0] = FALSE;
+
+  zero(*morphing_from_entity(NIL_ENTITY), EntityMorphing);
+  zero(*merchant_slot_from_entity(NIL_ENTITY), EntityMerchantSlot);
+  zero(*particle_group_from_entity(NIL_ENTITY), EntityParticleGroup);
+  zero(*timers_from_entity(NIL_ENTITY), EntityTimers);
+}
+
+// NOTE(dg): Entities are the only thing pushed onto the entity arena and each component
+// has an arena of its own, so every slot ends up at the same index in one dense array
+// per component and a ref's index addresses all of them directly.
 Entity *alloc_entity(void)
 {
   EntityList *list = &game.entities;
@@ -601,26 +792,40 @@ Entity *alloc_entity(void)
   {
     new_en = arena_push(&game.entity_arena, Entity, 1);
     zero(*new_en, Entity);
+    assert(new_en == list->data + list->count);
+
+    arena_push(&list->arena.pos, Vec2F, 1);
+    arena_push(&list->arena.vel, Vec2F, 1);
+    arena_push(&list->arena.new_vel, Vec2F, 1);
+    arena_push(&list->arena.xform, Mat3x3F, 1);
+    arena_push(&list->arena.prev_xform, Mat3x3F, 1);
+    arena_push(&list->arena.props, EntityProp, 1);
+    arena_push(&list->arena.is_active, bool, 1);
+    arena_push(&list->arena.group_mask, u32, 1);
+    list->group_mask[list->count] = 0;
+
+    // A group can never hold more members than there are slots
+    for (u32 id = 0; id < EntityGroup_COUNT; id++)
+    {
+      arena_push(&list->arena.groups[id], u32, 1);
+    }
 
-    new_en->children = arena_push(&game.entity_arena, EntityRef, MAX_ENTITY_CHILDREN);
-    new_en->free_child_list = arena_push(&game.entity_arena, i16, MAX_ENTITY_CHILDREN);
-
-    // Reset entity children
     for (u16 i = 0; i < MAX_ENTITY_CHILDREN; i++)
     {
-      new_en->children[i].ptr = NIL_ENTITY;
-      new_en->children[i].id = 0;
       new_en->free_child_list[i] = -1;
     }
 
     if (list->head == NULL)
     {
       list->head = new_en;
-      list->tail = new_en;
+    }
+    else
+    {
+      list->tail->next = new_en;
     }
 
+    new_en->gen = 1;
     new_en->next = NULL;
-    list->tail->next = new_en;
     list->tail = new_en;
     list->count++;
   }
@@ -629,7 +834,18 @@ Entity *alloc_entity(void)
     list->first_free = list->first_free->next_free;
   }
 
-  new_en->id = (u64) random_i32(2, UINT32_MAX-1);
+  u64 slot = en_slot(new_en);
+  zero(list->pos[slot], Vec2F);
+  zero(list->vel[slot], Vec2F);
+  zero(list->new_vel[slot], Vec2F);
+  zero(list->xform[slot], Mat3x3F);
+  zero(list->prev_xform[slot], Mat3x3F);
+  list->props[slot] = 0;
+  list->is_active[slot] = FALSE;
+
+  new_en->id = ((u64) new_en->gen << 32) | slot;
+  new_en->xform_dirty = TRUE;
+  new_en->xform_snap = TRUE;
 
   return new_en;
 }
@@ -638,42 +854,148 @@ void free_entity(Entity *en)
 {
   EntityList *list = &game.entities;
 
-  // Reset entity
-  // NOTE(dg): This is a load of crap.
+  // Release side records
+  if (en->morphing != NULL)
+  {
+    en->morphing->next_free = list->first_free_morphing;
+    list->first_free_morphing = en->morphing;
+  }
+
+  if (en->merchant_slot != NULL)
+  {
+    en->merchant_slot->next_free = list->first_free_merchant_slot;
+    list->first_free_merchant_slot = en->merchant_slot;
+  }
+
+  if (en->particle_group != NULL)
+  {
+    en->particle_group->next_free = list->first_free_particle_group;
+    list->first_free_particle_group = en->particle_group;
+  }
+
+  if (en->timers != NULL)
+  {
+    en->timers->next_free = list->first_free_timers;
+    list->first_free_timers = en->timers;
+  }
+
+  // Leave every group
+  for (u32 id = 0; id < EntityGroup_COUNT; id++)
+  {
+    entity_group_rem(id, en);
+  }
+
+  // Reset entity, keeping its place in the list and bumping its generation so any
+  // outstanding refs go stale
   Entity *next = en->next;
-  Entity *next_free = en->next_free;
-  EntityRef *children = en->children;
-  i16 *free_child_list = en->free_child_list;
+  u32 gen = en->gen + 1;
   zero(*en, Entity);
-  en->free_child_list = free_child_list;
-  en->children = children;
   for (u16 i = 0; i < MAX_ENTITY_CHILDREN; i++)
   {
-    en->children[i].ptr = NIL_ENTITY;
-    en->children[i].id = 0;
     en->free_child_list[i] = -1;
   }
-  en->next_free = next_free;
   en->next = next;
+  en->gen = gen != 0 ? gen : 1;
+
+  // Components are reset on alloc, but a freed slot must drop out of the dense passes
+  en_props(en) = 0;
+  en_is_active(en) = FALSE;
 
   en->next_free = list->first_free;
   list->first_free = en;
 }
 
-Entity *get_entity_by_id(u64 id)
+// Returns the position of the first member whose slot is not below slot.
+static
+u32 entity_group_search(EntityGroup *group, u32 slot)
 {
-  Entity *result = NIL_ENTITY;
-
-  for (Entity *en = game.entities.head; en != NULL; en = en->next)
+  u32 lo = 0;
+  u32 hi = group->count;
+  while (lo < hi)
   {
-    if (en->id == id)
+    u32 mid = lo + (hi - lo) / 2;
+    if (group->slots[mid] < slot)
     {
-      result = en;
-      break;
+      lo = mid + 1;
+    }
+    else
+    {
+      hi = mid;
     }
   }
 
-  return result;
+  return lo;
+}
+
+// NOTE(dg): Members are kept in slot order. New slots are always the highest, so most
+// joins land at the end and only a reused slot has to shift the members after it.
+void entity_group_add(EntityGroupID id, Entity *en)
+{
+  EntityList *list = &game.entities;
+  EntityGroup *group = &list->groups[id];
+  u32 slot = (u32) en_slot(en);
+  u32 bit = 1u << id;
+
+  // NOTE(dg): Writes through NIL_ENTITY must never make it a member
+  if (slot == 0 || (list->group_mask[slot] & bit)) return;
+
+  u32 pos = entity_group_search(group, slot);
+  for (u32 i = group->count; i > pos; i--)
+  {
+    group->slots[i] = group->slots[i-1];
+  }
+
+  group->slots[pos] = slot;
+  group->count++;
+  list->group_mask[slot] |= bit;
+}
+
+void entity_group_rem(EntityGroupID id, Entity *en)
+{
+  EntityList *list = &game.entities;
+  EntityGroup *group = &list->groups[id];
+  u32 slot = (u32) en_slot(en);
+  u32 bit = 1u << id;
+
+  if (!(list->group_mask[slot] & bit)) return;
+
+  u32 pos = entity_group_search(group, slot);
+  for (u32 i = pos; i + 1 < group->count; i++)
+  {
+    group->slots[i] = group->slots[i+1];
+  }
+
+  group->count--;
+  list->group_mask[slot] &= ~bit;
+}
+
+// Returns the first member after slot, or 0 past the last one. Pass 0 to start a walk.
+// Members that join or leave during a walk are visited or skipped by their slot, just
+// as on a walk over the entity list.
+// NOTE(dg): The cursor remembers where the last call ended up, so a walk that nothing
+// disturbs never has to search.
+u32 entity_group_next(EntityGroupID id, u32 slot)
+{
+  EntityGroup *group = &game.entities.groups[id];
+
+  u32 pos = group->cursor;
+  if (pos < group->count && group->slots[pos] == slot)
+  {
+    pos += 1;
+  }
+  else
+  {
+    pos = entity_group_search(group, slot + 1);
+  }
+
+  group->cursor = pos;
+  return pos < group->count ? group->slots[pos] : 0;
+}
+
+inline
+Entity *get_entity_by_id(u64 id)
+{
+  return entity_from_ref(ref_from_id(id));
 }
 
 Entity *get_entity_by_sp(u8 sp)
@@ -740,10 +1062,12 @@ void attach_entity_child_at(Entity *en, Entity *child, u16 index)
 
 void detach_entity_child(Entity *en, Entity *child)
 {
+  EntityRef child_ref = ref_from_entity(child);
+
   for (u16 i = 0; i < en->child_count; i++)
   {
     EntityRef *slot = &en->children[i];
-    if (slot->id == child->id)
+    if (ref_equals(*slot, child_ref))
     {
       zero(*slot, EntityRef);
 
@@ -768,16 +1092,11 @@ Entity *get_entity_child_at(Entity *en, u16 index)
 
 Entity *get_entity_child_by_id(Entity *en, u64 id)
 {
-  Entity *result = NIL_ENTITY;
+  Entity *result = get_entity_by_id(id);
 
-  for (u16 i = 0; i < MAX_ENTITY_CHILDREN; i++)
+  if (!entity_is_valid(en) || entity_from_ref(result->parent) != en)
   {
-    Entity *curr = entity_from_ref(en->children[i]);
-    if (curr->id == id)
-    {
-      result = curr;
-      break;
-    }
+    result = NIL_ENTITY;
   }
 
   return result;
@@ -824,6 +1143,129 @@ void entity_add_collider(Entity *en, ColliderID col_id)
   attach_entity_child(en, en->cols[col_id]);
 }
 
+// @SideTables ///////////////////////////////////////////////////////////////////////////
+
+// NOTE(dg): Data that only a handful of entities use lives in side records pulled from
+// per-type free lists. Entities without a record read from a zeroed nil record, the same
+// way a dangling ref reads from NIL_ENTITY.
+
+static EntityMorphing NIL_MORPHING;
+static EntityMerchantSlot NIL_MERCHANT_SLOT;
+static EntityParticleGroup NIL_PARTICLE_GROUP;
+static EntityTimers NIL_TIMERS;
+
+EntityMorphing *entity_add_morphing(Entity *en)
+{
+  if (en->morphing == NULL && en != NIL_ENTITY)
+  {
+    EntityList *list = &game.entities;
+    EntityMorphing *record = list->first_free_morphing;
+    if (record != NULL)
+    {
+      list->first_free_morphing = record->next_free;
+    }
+    else
+    {
+      record = arena_push(&list->arena.side, EntityMorphing, 1);
+    }
+
+    zero(*record, EntityMorphing);
+    en->morphing = record;
+  }
+
+  return morphing_from_entity(en);
+}
+
+EntityMerchantSlot *entity_add_merchant_slot(Entity *en)
+{
+  if (en->merchant_slot == NULL && en != NIL_ENTITY)
+  {
+    EntityList *list = &game.entities;
+    EntityMerchantSlot *record = list->first_free_merchant_slot;
+    if (record != NULL)
+    {
+      list->first_free_merchant_slot = record->next_free;
+    }
+    else
+    {
+      record = arena_push(&list->arena.side, EntityMerchantSlot, 1);
+    }
+
+    zero(*record, EntityMerchantSlot);
+    en->merchant_slot = record;
+  }
+
+  return merchant_slot_from_entity(en);
+}
+
+EntityParticleGroup *entity_add_particle_group(Entity *en)
+{
+  if (en->particle_group == NULL && en != NIL_ENTITY)
+  {
+    EntityList *list = &game.entities;
+    EntityParticleGroup *record = list->first_free_particle_group;
+    if (record != NULL)
+    {
+      list->first_free_particle_group = record->next_free;
+    }
+    else
+    {
+      record = arena_push(&list->arena.side, EntityParticleGroup, 1);
+    }
+
+    zero(*record, EntityParticleGroup);
+    en->particle_group = record;
+  }
+
+  return particle_group_from_entity(en);
+}
+
+EntityTimers *entity_add_timers(Entity *en)
+{
+  if (en->timers == NULL && en != NIL_ENTITY)
+  {
+    EntityList *list = &game.entities;
+    EntityTimers *record = list->first_free_timers;
+    if (record != NULL)
+    {
+      list->first_free_timers = record->next_free;
+    }
+    else
+    {
+      record = arena_push(&list->arena.side, EntityTimers, 1);
+    }
+
+    zero(*record, EntityTimers);
+    en->timers = record;
+  }
+
+  return timers_from_entity(en);
+}
+
+inline
+EntityMorphing *morphing_from_entity(Entity *en)
+{
+  return en->morphing != NULL ? en->morphing : &NIL_MORPHING;
+}
+
+inline
+EntityMerchantSlot *merchant_slot_from_entity(Entity *en)
+{
+  return en->merchant_slot != NULL ? en->merchant_slot : &NIL_MERCHANT_SLOT;
+}
+
+inline
+EntityParticleGroup *particle_group_from_entity(Entity *en)
+{
+  return en->particle_group != NULL ? en->particle_group : &NIL_PARTICLE_GROUP;
+}
+
+inline
+EntityTimers *timers_from_entity(Entity *en)
+{
+  return en->timers != NULL ? en->timers : &NIL_TIMERS;
+}
+
 // @Timer ////////////////////////////////////////////////////////////////////////////////
 
 inline
@@ -894,16 +1336,16 @@ void equip_weapon(Entity *en, WeaponKind kind)
   WeaponDesc desc = prefab.weapon[kind];
 
   en->is_weapon_equipped = TRUE;
-  en->attack_timer.duration = desc.shot_cooldown;
+  entity_add_timers(en)->attack.duration = desc.shot_cooldown;
 
   weapon_en->sprite = desc.sprite;
   weapon_en->weapon_kind = kind;
-  weapon_en->pos = desc.ancor;
+  en_pos(weapon_en) = desc.ancor;
   weapon_en->damage = desc.damage;
   weapon_en->speed = desc.bullet_speed;
   entity_add_prop(weapon_en, EntityProp_Renders);
 
-  shot_point_en->pos = desc.shot_point;
+  en_pos(shot_point_en) = desc.shot_point;
 
   game.weapon.kind = kind;
   if (game.weapon.is_reloading)
@@ -960,39 +1402,40 @@ bool entity_is_laying(Entity *en)
 
 bool slot_purchase_item(Entity *slot)
 {
+  EntityMerchantSlot *merchant_slot = merchant_slot_from_entity(slot);
   bool purchase_made = FALSE;
 
-  if (slot->merchant_slot.kind == MerchantSlotKind_Weapon &&
-      game.progression.weapon_unlocked[slot->merchant_slot.weapon_kind])
+  if (merchant_slot->kind == MerchantSlotKind_Weapon &&
+      game.progression.weapon_unlocked[merchant_slot->weapon_kind])
   {
     return FALSE;
   }
 
-  if (slot->merchant_slot.purchased == TRUE) return FALSE;
+  if (merchant_slot->purchased == TRUE) return FALSE;
 
-  switch (slot->merchant_slot.kind)
+  switch (merchant_slot->kind)
   {
   case MerchantSlotKind_Weapon:
-    if (game.coin_count >= slot->merchant_slot.price)
+    if (game.coin_count >= merchant_slot->price)
     {
-      game.coin_count -= slot->merchant_slot.price;
+      game.coin_count -= merchant_slot->price;
       purchase_made = TRUE;
     }
   case MerchantSlotKind_Coin:
-    if (game.coin_count >= slot->merchant_slot.price)
+    if (game.coin_count >= merchant_slot->price)
     {
-      game.coin_count -= slot->merchant_slot.price;
+      game.coin_count -= merchant_slot->price;
       purchase_made = TRUE;
     }
   case MerchantSlotKind_Powerup:
-    if (game.soul_count >= slot->merchant_slot.price)
+    if (game.soul_count >= merchant_slot->price)
     {
-      game.soul_count -= slot->merchant_slot.price;
+      game.soul_count -= merchant_slot->price;
       purchase_made = TRUE;
     }
   }
 
-  slot->merchant_slot.purchased = purchase_made;
+  merchant_slot->purchased = purchase_made;
 
   return purchase_made;
 }
@@ -1039,12 +1482,13 @@ void slot_populate_weapon(Entity *slot)
     }
   }
 
-  slot->merchant_slot.weapon_kind = weapon_kind;
-  slot->merchant_slot.price = prefab.weapon[weapon_kind].merchant.price;
-  slot->merchant_slot.purchased = FALSE;
+  EntityMerchantSlot *merchant_slot = merchant_slot_from_entity(slot);
+  merchant_slot->weapon_kind = weapon_kind;
+  merchant_slot->price = prefab.weapon[weapon_kind].merchant.price;
+  merchant_slot->purchased = FALSE;
 
   Entity *weapon_deco = get_entity_child_at(slot, 0);
-  weapon_deco->pos = prefab.weapon[weapon_kind].merchant.offset;
+  en_pos(weapon_deco) = prefab.weapon[weapon_kind].merchant.offset;
   weapon_deco->sprite = prefab.weapon[weapon_kind].sprite;
   weapon_deco->rot = 270;
   entity_rem_prop(weapon_deco, EntityProp_Renders);
@@ -1052,10 +1496,11 @@ void slot_populate_weapon(Entity *slot)
 
 void slot_populate_ammo(Entity *slot)
 {
+  EntityMerchantSlot *merchant_slot = merchant_slot_from_entity(slot);
   i32 roll = random_i32(1, 4);
-  slot->merchant_slot.ammo_count = 8 * roll;
-  slot->merchant_slot.price = roll;
-  slot->merchant_slot.purchased = FALSE;
+  merchant_slot->ammo_count = 8 * roll;
+  merchant_slot->price = roll;
+  merchant_slot->purchased = FALSE;
   slot->sprite = prefab.sprite.ui_slot_coin_ammo;
 }
 
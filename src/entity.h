@@ -34,11 +34,21 @@ typedef enum ColliderID
   Collider_COUNT,
 } ColliderID;
 
+typedef enum CollisionLayer
+{
+  CollisionLayer_ZombieBody = bit(0),
+  CollisionLayer_MeleeHit =   bit(1),
+  CollisionLayer_Collectable = bit(2),
+} CollisionLayer;
+
+// Handle into the entity slot array. A slot's generation is bumped every time it is
+// freed, so a ref to a recycled slot never resolves. Generation 0 is never live, which
+// makes a zeroed ref the nil ref.
 typedef struct EntityRef EntityRef;
 struct EntityRef
 {
-  Entity *ptr;
-  u64 id;
+  u32 idx;
+  u32 gen;
 };
 
 typedef struct Timer Timer;
@@ -100,22 +110,6 @@ struct ParticleDesc
   Vec2F vel;
 };
 
-typedef struct Particle Particle;
-struct Particle
-{
-  Vec4F color;
-  Vec2F pos;
-  Vec2F scale;
-  f32 dir;
-  f32 rot;
-  Vec2F vel;
-  f32 speed;
-  bool is_grounded;
-  bool is_active;
-  
-  EntityRef owner;
-};
-
 // Entity ///////////////////////////////////////////////////////////////////////////
 
 typedef enum EntityGender
@@ -179,6 +173,8 @@ typedef enum EntityType
   EntityType_Merchant,
   EntityType_Corpse,
   EntityType_Shockwave,
+
+  EntityType_COUNT,
 } EntityType;
 
 typedef enum EntityProp
@@ -307,6 +303,85 @@ struct ZombieDesc
   f32 attack_cooldown;
 };
 
+typedef enum MerchantSlotKind
+{
+  MerchantSlotKind_Weapon,
+  MerchantSlotKind_Coin,
+  MerchantSlotKind_Powerup,
+} MerchantSlotKind;
+
+typedef struct EntityMorphing EntityMorphing;
+struct EntityMorphing
+{
+  EntityMorphing *next_free;
+  Timer timer;
+  EntityType into;
+};
+
+typedef struct EntityMerchantSlot EntityMerchantSlot;
+struct EntityMerchantSlot
+{
+  EntityMerchantSlot *next_free;
+  MerchantSlotKind kind;
+  WeaponKind weapon_kind;
+  u16 price;
+  u16 ammo_count;
+  bool purchased;
+};
+
+typedef struct EntityParticleGroup EntityParticleGroup;
+struct EntityParticleGroup
+{
+  EntityParticleGroup *next_free;
+  ParticleDesc desc;
+  Timer timer;
+
+  // Span of the emitter's live particles in the particle buffer
+  u32 first;
+  u32 count;
+};
+
+typedef struct EntityTimers EntityTimers;
+struct EntityTimers
+{
+  EntityTimers *next_free;
+  Timer flash;
+  Timer attack;
+  Timer damage;
+  Timer kill;
+  Timer invincibility;
+  Timer muzzle_flash;
+  Timer egg;
+};
+
+// NOTE(dg): The first EntityType_COUNT groups hold the entities of one type each and
+// are named by type_group. The rest track a hot prop or a pending spawn or death. A
+// slot's memberships are one bit per group, so there can be at most 32.
+typedef enum EntityGroupID
+{
+  EntityGroup_Moves = EntityType_COUNT,
+  EntityGroup_AffectedByGravity,
+  EntityGroup_Renders,
+  EntityGroup_KillAfterTime,
+  EntityGroup_MarkedForSpawn,
+  EntityGroup_MarkedForDeath,
+
+  EntityGroup_COUNT,
+} EntityGroupID;
+
+#define type_group(type) ((EntityGroupID) (type))
+
+// Dense array of the live slots in a group, kept in slot order as members join and
+// leave. Passes walk it with entity_group_next, which visits members in the order a
+// walk over the whole entity list would.
+typedef struct EntityGroup EntityGroup;
+struct EntityGroup
+{
+  u32 *slots;
+  u32 count;
+  u32 cursor;
+};
+
 typedef struct Entity Entity;
 struct Entity
 {
@@ -314,33 +389,51 @@ struct Entity
   Entity *next_free;
 
   EntityRef parent;
-  EntityRef *children;
+  EntityRef children[MAX_ENTITY_CHILDREN];
   i16 child_count;
-  i16 *free_child_list;
+  i16 free_child_list[MAX_ENTITY_CHILDREN];
   i16 free_child_count;
 
   // General
   u64 id;
+  u32 gen;
   u8 spid;
   EntityType type;
   MoveType move_type;
   CombatType combat_type;
-  EntityProp props;
-  bool is_active;
   bool marked_for_death;
   bool marked_for_spawn;
 
   // Transform
-  Vec2F pos;
   f32 rot;
   Vec2F scale;
-  Mat3x3F xform;
   Mat3x3F model_mat;
   Vec2F input_dir;
+  bool xform_dirty;
+  bool xform_changed;
+  bool xform_snap;
+
+  // World transform as of the last xform pass, along with the local values it was
+  // built from
+  struct
+  {
+    Vec2F pos;
+    Vec2F scale;
+    f32 rot;
+    bool flip_x;
+    bool flip_y;
+  } world;
+  struct
+  {
+    Vec2F pos;
+    Vec2F scale;
+    f32 rot;
+    bool flip_x;
+    bool flip_y;
+    u32 parent_slot;
+  } local;
 
   // Physics
-  Vec2F vel;
-  Vec2F new_vel;
   f32 speed;
   
   // Drawing
@@ -382,7 +475,6 @@ struct Entity
     f32 rate;
     i8 state;
   } distort_y;
-  Timer flash_timer;
 
   // Targeting
   bool has_target;
@@ -391,43 +483,16 @@ struct Entity
   f32 view_dist;
   f32 stop_dist;
 
-  // Morphing
-  struct
-  {
-    Timer timer;
-    EntityType into;
-  } morphing;
-
-  // Merchant slot
-  struct
-  {
-    enum
-    {
-      MerchantSlotKind_Weapon,
-      MerchantSlotKind_Coin,
-      MerchantSlotKind_Powerup,
-    } kind;
-    WeaponKind weapon_kind;
-    u16 price;
-    u16 ammo_count;
-    bool purchased;
-  } merchant_slot;
-
-  // Particle group
-  ParticleDesc particle_desc;
-  Timer particle_timer;
-  u32 particles_killed;
+  // Side tables, only populated for the entities that use them
+  EntityMorphing *morphing;
+  EntityMerchantSlot *merchant_slot;
+  EntityParticleGroup *particle_group;
+  EntityTimers *timers;
 
   // Combat
   bool is_weapon_equipped;
   i16 health;
   i16 damage;
-  Timer attack_timer;
-  Timer damage_timer;
-  Timer kill_timer;
-  Timer invincibility_timer;
-  Timer muzzle_flash_timer;
-  Timer egg_timer;
 
   // Kinds
   ZombieKind zombie_kind;
@@ -438,13 +503,56 @@ struct Entity
 typedef struct EntityList EntityList;
 struct EntityList
 {
+  Entity *data;
   Entity *head;
   Entity *tail;
   Entity *first_free;
   u64 count;
+
+  // Hot components, stored as dense arrays parallel to data and indexed by slot
+  Vec2F *pos;
+  Vec2F *vel;
+  Vec2F *new_vel;
+  Mat3x3F *xform;
+  Mat3x3F *prev_xform;
+  EntityProp *props;
+  bool *is_active;
+
+  EntityGroup groups[EntityGroup_COUNT];
+  u32 *group_mask;
+
+  EntityMorphing *first_free_morphing;
+  EntityMerchantSlot *first_free_merchant_slot;
+  EntityParticleGroup *first_free_particle_group;
+  EntityTimers *first_free_timers;
+
+  struct
+  {
+    Arena pos;
+    Arena vel;
+    Arena new_vel;
+    Arena xform;
+    Arena prev_xform;
+    Arena props;
+    Arena is_active;
+    Arena group_mask;
+    Arena groups[EntityGroup_COUNT];
+    Arena side;
+  } arena;
 };
 
-Entity *NIL_ENTITY = &(Entity) {0};
+// NOTE(dg): Slot 0 of the entity list is reserved as the nil entity, so it has a row
+// in every component array like any other slot.
+Entity *NIL_ENTITY = NULL;
+
+#define en_slot(en) ((en) - game.entities.data)
+#define en_pos(en) (game.entities.pos[en_slot(en)])
+#define en_vel(en) (game.entities.vel[en_slot(en)])
+#define en_new_vel(en) (game.entities.new_vel[en_slot(en)])
+#define en_xform(en) (game.entities.xform[en_slot(en)])
+#define en_props(en) (game.entities.props[en_slot(en)])
+#define en_is_active(en) (game.entities.is_active[en_slot(en)])
+#define en_group(id) (&game.entities.groups[id])
 
 Entity *create_entity(EntityType type);
 Entity *spawn_entity(EntityType type, Vec2F pos);
@@ -458,6 +566,7 @@ void kill_entity(Entity *en, bool slain);
 bool entity_has_prop(Entity *en, EntityProp prop);
 void entity_add_prop(Entity *en, EntityProp prop);
 void entity_rem_prop(Entity *en, EntityProp prop);
+void entity_sync_prop_groups(Entity *en);
 
 Vec2F pos_from_entity(Entity *en);
 Vec2F pos_tl_from_entity(Entity *en);
@@ -469,6 +578,7 @@ Vec2F scale_from_entity(Entity *en);
 f32 rot_from_entity(Entity *en);
 bool flip_x_from_entity(Entity *en);
 bool flip_y_from_entity(Entity *en);
+bool update_entity_xform(Entity *en, Entity *parent);
 
 void entity_look_at(Entity *en, Vec2F target_pos);
 void entity_set_target(Entity *en, EntityRef target);
@@ -479,12 +589,19 @@ void damage_entity(Entity *reciever, i16 damage);
 // EntityRef ////////////////////////////////////////////////////////////////////////
 
 EntityRef ref_from_entity(Entity *en);
+EntityRef ref_from_id(u64 id);
 Entity *entity_from_ref(EntityRef ref);
+bool ref_equals(EntityRef a, EntityRef b);
 
 // EntityList ///////////////////////////////////////////////////////////////////////
 
+void init_entity_list(void);
+void reset_nil_entity(void);
 Entity *alloc_entity(void);
 void free_entity(Entity *en);
+void entity_group_add(EntityGroupID id, Entity *en);
+void entity_group_rem(EntityGroupID id, Entity *en);
+u32 entity_group_next(EntityGroupID id, u32 slot);
 Entity *get_entity_by_id(u64 id);
 Entity *get_entity_by_sp(u8 sp);
 
@@ -498,6 +615,15 @@ Entity *get_entity_child_by_type(Entity *en, EntityType type);
 
 void entity_add_collider(Entity *en, ColliderID col_id);
 
+EntityMorphing *entity_add_morphing(Entity *en);
+EntityMerchantSlot *entity_add_merchant_slot(Entity *en);
+EntityParticleGroup *entity_add_particle_group(Entity *en);
+EntityTimers *entity_add_timers(Entity *en);
+EntityMorphing *morphing_from_entity(Entity *en);
+EntityMerchantSlot *merchant_slot_from_entity(Entity *en);
+EntityParticleGroup *particle_group_from_entity(Entity *en);
+EntityTimers *timers_from_entity(Entity *en);
+
 // Timer /////////////////////////////////////////////////////////////////////////////
 
 void timer_start(Timer *timer, f64 duration);
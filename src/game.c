@@ -9,9 +9,11 @@
 #include "input.h"
 #include "entity.h"
 #include "prefabs.h"
+#include "profile.h"
+#include "counters.h"
 #include "game.h"
 
-#define EN_IN_ENTITIES Entity *en = game.entities.head; en; en = en->next
+#define EN_IN_SLOTS u64 slot = 1; slot < game.entities.count; slot++
 
 extern Globals global;
 extern Prefabs prefab;
@@ -29,18 +31,25 @@ void init_game(void)
 
   ui_init_widgetstore(128, &global.perm_arena);
 
+  init_entity_list();
+  init_particle_buffer(&global.perm_arena);
+  init_snapshot(&game.snapshot);
+  init_game_counters();
+  init_command_buffers();
+  game.collision_arena = create_arena(GiB(1), FALSE);
+
   // - Starting entities ---
   {
     spawn_merchant();
 
     Entity *player = create_entity(EntityType_Player);
     player->spid = SPID_Player;
-    player->pos = v2f(WIDTH/2.0f, HEIGHT/2.0f);
+    en_pos(player) = v2f(WIDTH/2.0f, HEIGHT/2.0f);
     entity_set_gender(player, EntityGender_Female);
 
     Entity *gun = create_entity(EntityType_Equipped);
     gun->spid = SPID_Gun;
-    gun->pos = v2f(35.0f, 5.0f);
+    en_pos(gun) = v2f(35.0f, 5.0f);
     attach_entity_child(player, gun);
 
     Entity *shot_point = create_entity(EntityType_Debug);
@@ -49,6 +58,7 @@ void init_game(void)
     Entity *muzzle_flash = create_entity(EntityType_Decoration);
     muzzle_flash->sprite = prefab.sprite.muzzle_flash;
     entity_add_prop(muzzle_flash, EntityProp_HideAfterTime);
+    entity_add_timers(muzzle_flash);
     entity_rem_prop(muzzle_flash, EntityProp_Renders);
     attach_entity_child(gun, muzzle_flash);
 
@@ -60,12 +70,277 @@ void init_game(void)
   for (i32 i = 0; i < 0; i++)
   {
     Entity *en = create_entity(EntityType_Any);
-    en->pos = v2f(200, 200);
+    en_pos(en) = v2f(200, 200);
+  }
+}
+
+// Registers the counters the debug overlay and the CSV stream report, in column order.
+void init_game_counters(void)
+{
+  GameCounters *counters = &game.counters;
+
+  char const *entity_names[EntityType_COUNT] = {
+    [EntityType_Any] = "entities.any",
+    [EntityType_Debug] = "entities.debug",
+    [EntityType_Player] = "entities.player",
+    [EntityType_Zombie] = "entities.zombie",
+    [EntityType_Equipped] = "entities.equipped",
+    [EntityType_Ammo] = "entities.ammo",
+    [EntityType_Egg] = "entities.egg",
+    [EntityType_Decoration] = "entities.decoration",
+    [EntityType_Collider] = "entities.collider",
+    [EntityType_Collectable] = "entities.collectable",
+    [EntityType_Merchant] = "entities.merchant",
+    [EntityType_Corpse] = "entities.corpse",
+    [EntityType_Shockwave] = "entities.shockwave",
+  };
+
+  for (u32 type = EntityType_Nil + 1; type < EntityType_COUNT; type++)
+  {
+    counters->entities[type] = counter_register(entity_names[type], CounterKind_Sum);
+  }
+
+  counters->pass_gravity = counter_register("pass.gravity", CounterKind_Sum);
+  counters->pass_movement = counter_register("pass.movement", CounterKind_Sum);
+  counters->pass_xform = counter_register("pass.xform", CounterKind_Sum);
+  counters->pass_behavior = counter_register("pass.behavior", CounterKind_Sum);
+  counters->pass_collision = counter_register("pass.collision", CounterKind_Sum);
+  counters->pass_combat = counter_register("pass.combat", CounterKind_Sum);
+  counters->pass_animation = counter_register("pass.animation", CounterKind_Sum);
+
+  counters->collision_pairs = counter_register("collision.pairs", CounterKind_Sum);
+  counters->collision_tests = counter_register("collision.tests", CounterKind_Sum);
+  counters->particles = counter_register("particles.alive", CounterKind_Sum);
+
+  counters->draws = counter_register("render.draws", CounterKind_Gauge);
+  counters->vertices = counter_register("render.vertices", CounterKind_Gauge);
+  counters->instances = counter_register("render.instances", CounterKind_Gauge);
+  counters->batches = counter_register("render.batches", CounterKind_Gauge);
+  counters->flushes = counter_register("render.flushes", CounterKind_Gauge);
+  counters->shader_switches = counter_register("render.shader_switches", CounterKind_Gauge);
+  counters->texture_switches = counter_register("render.texture_switches", CounterKind_Gauge);
+  counters->upload_bytes = counter_register("render.upload_bytes", CounterKind_Gauge);
+
+  counters->frame_arena_bytes = counter_register("arena.frame_bytes", CounterKind_Sum);
+  counters->draw_arena_bytes = counter_register("arena.draw_bytes", CounterKind_Gauge);
+}
+
+// Updates en's world xform and then its children's, so a parent's is final before any
+// of its children read it. Last tick's xform is kept for blending, unless the entity or
+// its parent snapped. Returns how many entities the tree had.
+static
+u32 update_xform_tree(Entity *en)
+{
+  EntityList *list = &game.entities;
+  Entity *parent = entity_from_ref(en->parent);
+
+  u32 slot = (u32) en_slot(en);
+  list->prev_xform[slot] = list->xform[slot];
+
+  en->xform_changed = FALSE;
+  if (en_is_active(en))
+  {
+    en->xform_changed = update_entity_xform(en, parent);
+  }
+
+  en->xform_snap = en->xform_snap || parent->xform_snap;
+  if (en->xform_snap)
+  {
+    list->prev_xform[slot] = list->xform[slot];
+  }
+
+  u32 visited_count = 1;
+  for (u16 i = 0; i < MAX_ENTITY_CHILDREN; i++)
+  {
+    if (en->children[i].gen == 0) continue;
+
+    Entity *child = entity_from_ref(en->children[i]);
+    if (entity_from_ref(child->parent) != en) continue;
+
+    visited_count += update_xform_tree(child);
+  }
+
+  // NOTE(dg): The children have read the flag by now. Anything spawned from here on
+  // keeps its own until the next pass, so it is drawn unblended until then.
+  en->xform_snap = FALSE;
+
+  return visited_count;
+}
+
+// Walks the trees under roots first to first + count - 1 of the XformJob at data.
+static
+void update_xform_trees(void *data, u32 first, u32 count)
+{
+  prof_begin("update_xform_trees");
+  XformJob *job = (XformJob *) data;
+
+  u32 visited_count = 0;
+  for (u32 i = first; i < first + count; i++)
+  {
+    visited_count += update_xform_tree(&game.entities.data[job->roots[i]]);
+  }
+
+  os_atomic_add_u32(&job->visited_count, visited_count);
+  prof_end();
+}
+
+// Ticks the animations, bobbing, distortion and timed props of the entities in slots
+// first to first + count - 1 of the slot array at data.
+static
+void animate_entities(void *data, u32 first, u32 count)
+{
+  prof_begin("animate_entities");
+  u32 *slots = (u32 *) data;
+  f64 dt = game.dt;
+
+  for (u32 i = first; i < first + count; i++)
+  {
+    set_command_order(i);
+    Entity *en = &game.entities.data[slots[i]];
+
+    if (entity_has_prop(en, EntityProp_BobsOverTime))
+    {
+      if (en_pos(en).y > en->bobbing.range.e[1] - 0.1f)
+      {
+        en->bobbing.state = -1;
+      }
+
+      if (en_pos(en).y < en->bobbing.range.e[0] + 0.1f)
+      {
+        en->bobbing.state = 1;
+      }
+      
+      en_pos(en).y += 10 * dt * en->bobbing.state;
+    }
+
+    if (entity_has_prop(en, EntityProp_DistortScaleX))
+    {
+      if (en->distort_x.state == 0)
+      {
+        en->scale.x -= dt * en->distort_x.rate * 8;
+
+        if (en->scale.x <= en->distort_x.saved * en->distort_x.scale)
+        {
+          en->scale.x = en->distort_x.saved * en->distort_x.scale;
+          en->distort_x.state = 1;
+        }
+      }
+
+      if (en->distort_x.state == 1)
+      {
+        en->scale.x += dt * en->distort_x.rate;
+
+        if (en->scale.x >= en->distort_x.saved)
+        {
+          en->scale.x = en->distort_x.saved;
+          en->distort_x.state = 0;
+          entity_rem_prop(en, EntityProp_DistortScaleX);
+        }
+      }
+    }
+
+    if (entity_has_prop(en, EntityProp_DistortScaleY))
+    {
+      if (en->distort_y.state == 0)
+      {
+        en->scale.y -= dt * en->distort_y.rate * 8;
+
+        if (en->scale.y <= en->distort_y.saved * en->distort_y.scale)
+        {
+          en->scale.y = en->distort_y.saved * en->distort_y.scale;
+          en->distort_y.state = 1;
+        }
+      }
+
+      if (en->distort_y.state == 1)
+      {
+        en->scale.y += dt * en->distort_y.rate;
+
+        if (en->scale.y >= en->distort_y.saved)
+        {
+          en->scale.y = en->distort_y.saved;
+          en->distort_y.state = 0;
+          entity_rem_prop(en, EntityProp_DistortScaleY);
+        }
+      }
+    }
+
+    // NOTE(dg): This runs on the job system, so it can't pull a timer record off the
+    // free list. The flash and hide props are only ever set on entities that have one.
+    EntityTimers *timers = timers_from_entity(en);
+
+    if (entity_has_prop(en, EntityProp_FlashWhite))
+    {
+      timers->flash.duration = FLASH_TIME;
+
+      if (!timers->flash.ticking)
+      {
+        timer_start(&timers->flash, timers->flash.duration);
+      }
+
+      if (timer_timeout(&timers->flash))
+      {
+        timers->flash.ticking = FALSE;
+
+        entity_rem_prop(en, EntityProp_FlashWhite);
+      }
+    }
+
+    if (entity_has_prop(en, EntityProp_HideAfterTime))
+    {
+      if (timer_timeout(&timers->muzzle_flash))
+      {
+        timers->muzzle_flash.ticking = FALSE;
+        
+        entity_rem_prop(en, EntityProp_Renders);
+      }
+    }
+
+    if (en->state == EntityState_Nil) continue;
+    
+    // Clear prev animation if the state changed
+    if (en->prev_state != en->state)
+    {
+      zero(en->anim, Animation);
+      en->prev_state = en->state;
+    }
+    
+    if (en->anim_descriptors != NULL)
+    {
+      AnimationDesc anim_desc = en->anim_descriptors[en->state];
+      en->sprite = anim_desc.frames[en->anim.frame_idx];
+
+      // - Tick animation ---
+      if (anim_desc.frame_count > 1)
+      {
+        en->anim.tick_counter += ANIM_TICK;
+
+        if (en->anim.tick_counter % anim_desc.ticks_per_frame == 0)
+        {
+          en->anim.frame_idx += 1;
+
+          if (en->anim.frame_idx == anim_desc.frame_count)
+          {
+            en->anim.frame_idx = 0;
+
+            // - Exit animation ---
+            if (anim_desc.exit_state != EntityState_Nil)
+            {
+              en->state = anim_desc.exit_state;
+            }
+          }
+        }
+      }
+    }
   }
+
+  prof_end();
 }
 
 void update_game(void)
 {
+  prof_begin("update_game");
+
   f64 t = game.t;
   f64 dt = game.dt;
   Vec2F mouse_pos = screen_to_world(get_mouse_pos());
@@ -80,6 +355,7 @@ void update_game(void)
   ui_clear_widgetstore();
 
   // - Waves ---
+  prof_begin("waves");
   if (game.state != GameState_SoOver)
   {
     i32 total_zombies_this_wave = 0;
@@ -171,7 +447,10 @@ void update_game(void)
     }
   }
 
+  prof_end();
+
   // - Merchant ---
+  prof_begin("merchant");
   {
     Entity *merchant = get_entity_by_sp(SPID_Merchant);
 
@@ -206,7 +485,8 @@ void update_game(void)
 
         // - Slot 0 ---
         {
-          Entity *slot = get_entity_child_at(merchant, 0); 
+          Entity *slot = get_entity_child_at(merchant, 0);
+          EntityMerchantSlot *merchant_slot = merchant_slot_from_entity(slot);
           P_CollisionParams col = {
             .pos = add_2f(pos_bl_from_entity(slot), v2f(4*SPRITE_SCALE, 4*SPRITE_SCALE)),
             .dim = v2f(9*SPRITE_SCALE, 9*SPRITE_SCALE),
@@ -216,9 +496,9 @@ void update_game(void)
           {
             game.is_ui_hovered = TRUE;
 
-            if (!slot->merchant_slot.purchased)
+            if (!merchant_slot->purchased)
             {
-              slot->pos.y = lerp_1f(slot->pos.y, SPRITE_SCALE * (3 + 2), dt * LERP_MULT);
+              en_pos(slot).y = lerp_1f(en_pos(slot).y, SPRITE_SCALE * (3 + 2), dt * LERP_MULT);
             }
             
             if (is_key_just_pressed(Key_Mouse1))
@@ -226,18 +506,18 @@ void update_game(void)
               bool purchase_made = slot_purchase_item(slot);
               if (purchase_made)
               {
-                WeaponKind weapon = slot->merchant_slot.weapon_kind;
+                WeaponKind weapon = merchant_slot->weapon_kind;
                 game.progression.weapon_unlocked[weapon] = TRUE;
                 game.weapon.ammo_loaded[weapon] = prefab.weapon[weapon].ammo;
                 equip_weapon(player, weapon);
 
                 Entity *child = get_entity_child_at(slot, 0);
-                child->is_active = FALSE;
+                en_is_active(child) = FALSE;
                 entity_rem_prop(child, EntityProp_Renders);
               }
             }
 
-            if (!slot->merchant_slot.purchased)
+            if (!merchant_slot->purchased)
             {
               ui_rect(add_2f(pos_from_entity(slot), v2f(-75, 45)),
                       v2f(150, 60), 
@@ -247,25 +527,26 @@ void update_game(void)
                       add_2f(pos_from_entity(slot), v2f(-70, 80)),
                       20,
                       999,
-                      prefab.weapon[slot->merchant_slot.weapon_kind].name.data);
+                      prefab.weapon[merchant_slot->weapon_kind].name.data);
 
               ui_text(str("Cost: %i"),
                       add_2f(pos_from_entity(slot), v2f(-70, 55)),
                       20,
                       999,
-                      prefab.weapon[slot->merchant_slot.weapon_kind].merchant.price);
+                      prefab.weapon[merchant_slot->weapon_kind].merchant.price);
             }
           }
 
-          if (!p_rect_point_interect(col, mouse_pos) || slot->merchant_slot.purchased)
+          if (!p_rect_point_interect(col, mouse_pos) || merchant_slot->purchased)
           {
-            slot->pos.y = lerp_1f(slot->pos.y, SPRITE_SCALE*3, dt * LERP_MULT);
+            en_pos(slot).y = lerp_1f(en_pos(slot).y, SPRITE_SCALE*3, dt * LERP_MULT);
           }
         }
 
         // - Slot 1 ---
         {
           Entity *slot = get_entity_child_at(merchant, 1);
+          EntityMerchantSlot *merchant_slot = merchant_slot_from_entity(slot);
           P_CollisionParams col = {
             .pos = add_2f(pos_bl_from_entity(slot), v2f(4*SPRITE_SCALE, 4*SPRITE_SCALE)),
             .dim = v2f(9*SPRITE_SCALE, 9*SPRITE_SCALE),
@@ -275,9 +556,9 @@ void update_game(void)
           {
             game.is_ui_hovered = TRUE;
 
-            if (!slot->merchant_slot.purchased)
+            if (!merchant_slot->purchased)
             {
-              slot->pos.y = lerp_1f(slot->pos.y, SPRITE_SCALE * (3 + 2), dt * LERP_MULT);
+              en_pos(slot).y = lerp_1f(en_pos(slot).y, SPRITE_SCALE * (3 + 2), dt * LERP_MULT);
             }
 
             if (is_key_just_pressed(Key_Mouse1))
@@ -285,7 +566,7 @@ void update_game(void)
               bool purchase_made = slot_purchase_item(slot);
               if (purchase_made)
               {
-                game.weapon.ammo_reserved += slot->merchant_slot.ammo_count;
+                game.weapon.ammo_reserved += merchant_slot->ammo_count;
                 slot->sprite = prefab.sprite.ui_slot_coin_empty;
 
                 Entity *weapon_deco = get_entity_child_at(slot, 0);
@@ -293,7 +574,7 @@ void update_game(void)
               }
             }
 
-            if (!slot->merchant_slot.purchased)
+            if (!merchant_slot->purchased)
             {
               ui_rect(add_2f(pos_from_entity(slot), v2f(-75, 45)),
                       v2f(150, 60), 
@@ -303,25 +584,26 @@ void update_game(void)
                       add_2f(pos_from_entity(slot), v2f(-70, 80)),
                       20,
                       999,
-                      slot->merchant_slot.ammo_count);
+                      merchant_slot->ammo_count);
 
               ui_text(str("Cost: %i"),
                       add_2f(pos_from_entity(slot), v2f(-70, 55)),
                       20,
                       999,
-                      slot->merchant_slot.price);
+                      merchant_slot->price);
             }
           }
           
-          if (!p_rect_point_interect(col, mouse_pos) || slot->merchant_slot.purchased)
+          if (!p_rect_point_interect(col, mouse_pos) || merchant_slot->purchased)
           {
-            slot->pos.y = lerp_1f(slot->pos.y, SPRITE_SCALE*3, dt * LERP_MULT);
+            en_pos(slot).y = lerp_1f(en_pos(slot).y, SPRITE_SCALE*3, dt * LERP_MULT);
           }
         }
 
         // - Slot 2 ---
         {
           Entity *slot = get_entity_child_at(merchant, 2);
+          EntityMerchantSlot *merchant_slot = merchant_slot_from_entity(slot);
           P_CollisionParams col = {
             .pos = add_2f(pos_bl_from_entity(slot), v2f(4*SPRITE_SCALE, 4*SPRITE_SCALE)),
             .dim = v2f(9*SPRITE_SCALE, 9*SPRITE_SCALE),
@@ -331,9 +613,9 @@ void update_game(void)
           {
             game.is_ui_hovered = TRUE;
 
-            if (!slot->merchant_slot.purchased)
+            if (!merchant_slot->purchased)
             {
-              slot->pos.y = lerp_1f(slot->pos.y, SPRITE_SCALE * (3 + 2), dt * LERP_MULT);
+              en_pos(slot).y = lerp_1f(en_pos(slot).y, SPRITE_SCALE * (3 + 2), dt * LERP_MULT);
             }
 
             if (is_key_just_pressed(Key_Mouse1))
@@ -344,12 +626,12 @@ void update_game(void)
                 slot->sprite = prefab.sprite.ui_slot_soul_empty;
                 
                 Entity *child = get_entity_child_at(slot, 0);
-                child->is_active = FALSE;
+                en_is_active(child) = FALSE;
                 entity_rem_prop(child, EntityProp_Renders);
               }
             }
 
-            if (!slot->merchant_slot.purchased)
+            if (!merchant_slot->purchased)
             {
               ui_rect(add_2f(pos_from_entity(slot), v2f(-40, 35)),
                       v2f(100, 50), 
@@ -359,7 +641,7 @@ void update_game(void)
                       add_2f(pos_from_entity(slot), v2f(-35, 60)),
                       20,
                       999,
-                      slot->merchant_slot.ammo_count);
+                      merchant_slot->ammo_count);
 
               ui_text(str("Cost: %i"),
                       add_2f(pos_from_entity(slot), v2f(-35, 40)),
@@ -369,9 +651,9 @@ void update_game(void)
             }
           }
           
-          if (!p_rect_point_interect(col, mouse_pos) || slot->merchant_slot.purchased)
+          if (!p_rect_point_interect(col, mouse_pos) || merchant_slot->purchased)
           {
-            slot->pos.y = lerp_1f(slot->pos.y, SPRITE_SCALE*3, dt * LERP_MULT);
+            en_pos(slot).y = lerp_1f(en_pos(slot).y, SPRITE_SCALE*3, dt * LERP_MULT);
           }
         }
       }
@@ -394,7 +676,10 @@ void update_game(void)
     }
   }
 
+  prof_end();
+
   // - Switch weapon ---
+  prof_begin("weapon");
   {
     if (entity_is_valid(player))
     {
@@ -466,32 +751,43 @@ void update_game(void)
     }
   }
   
+  prof_end();
+
   // - Update entity spawning and dying ---
-  for (EN_IN_ENTITIES)
+  // NOTE(dg): Passes walk their groups in slot order, the order the whole entity list
+  // used to be walked in. That order decides which entity draws from the random stream
+  // first and which contact resolves first, so the groups never reorder the game.
+  prof_begin("spawn_death");
   {
-    if (en->marked_for_spawn)
+    for (u32 slot = entity_group_next(EntityGroup_MarkedForSpawn, 0); slot != 0;
+         slot = entity_group_next(EntityGroup_MarkedForSpawn, slot))
     {
+      Entity *en = &game.entities.data[slot];
       en->marked_for_spawn = FALSE;
-      en->is_active = TRUE;
+      en_is_active(en) = TRUE;
       entity_add_prop(en, EntityProp_Renders);
+      entity_group_rem(EntityGroup_MarkedForSpawn, en);
     }
 
-    if (en->marked_for_death)
+    for (u32 slot = entity_group_next(EntityGroup_MarkedForDeath, 0); slot != 0;
+         slot = entity_group_next(EntityGroup_MarkedForDeath, slot))
     {
-      en->marked_for_death = FALSE;
-      free_entity(en);
+      free_entity(&game.entities.data[slot]);
     }
 
-    if (entity_has_prop(en, EntityProp_KillAfterTime))
+    for (u32 slot = entity_group_next(EntityGroup_KillAfterTime, 0); slot != 0;
+         slot = entity_group_next(EntityGroup_KillAfterTime, slot))
     {
-      if (!en->kill_timer.ticking)
+      Entity *en = &game.entities.data[slot];
+      EntityTimers *timers = entity_add_timers(en);
+      if (!timers->kill.ticking)
       {
-        timer_start(&en->kill_timer, en->kill_timer.duration);
+        timer_start(&timers->kill, timers->kill.duration);
       }
 
-      if (timer_timeout(&en->kill_timer))
+      if (timer_timeout(&timers->kill))
       {
-        en->kill_timer.ticking = FALSE;
+        timers->kill.ticking = FALSE;
         kill_entity(en, TRUE);
       }
     }
@@ -502,10 +798,32 @@ void update_game(void)
     game.time_alive = t;
   }
 
-  // - Update entity position ---
-  for (EN_IN_ENTITIES)
+  prof_end();
+
+  // - Apply gravity ---
+  prof_begin("movement");
+  EntityGroup *falling = en_group(EntityGroup_AffectedByGravity);
+  counter_add(game.counters.pass_gravity, falling->count);
+  for (u32 slot = entity_group_next(EntityGroup_AffectedByGravity, 0); slot != 0;
+       slot = entity_group_next(EntityGroup_AffectedByGravity, slot))
+  {
+    Entity *en = &game.entities.data[slot];
+    if (!en_is_active(en) || entity_has_prop(en, EntityProp_Grounded)) continue;
+
+    en_new_vel(en).y -= GRAVITY * dt * dt;
+  }
+
+  // - Update entity movement ---
+  // NOTE(dg): LookAtPlayer is only ever set on zombies, which all move.
+  EntityGroup *movers = en_group(EntityGroup_Moves);
+  counter_add(game.counters.pass_movement, movers->count);
+  f32 edge_left = screen_to_world(v2f(global.viewport.x, 0)).x;
+  f32 edge_right = screen_to_world(v2f(global.viewport.z, 0)).x;
+  for (u32 slot = entity_group_next(EntityGroup_Moves, 0); slot != 0;
+       slot = entity_group_next(EntityGroup_Moves, slot))
   {
-    if (!en->is_active) continue;
+    Entity *en = &game.entities.data[slot];
+    if (!en_is_active(en)) continue;
 
     if (entity_has_prop(en, EntityProp_LookAtPlayer))
     {
@@ -515,285 +833,283 @@ void update_game(void)
         entity_look_at(en, player_pos);
       }
     }
-    
-    if (entity_has_prop(en, EntityProp_AffectedByGravity) &&
-       !entity_has_prop(en, EntityProp_Grounded))
-    {
-      en->new_vel.y -= GRAVITY * dt * dt;
-    }
 
     // - Update entitiy movement ---
-    if (entity_has_prop(en, EntityProp_Moves))
+    // NOTE(dg): State changes are temporary. Need proper state machine
+    if (entity_has_prop(en, EntityProp_Controlled))
     {
-      // NOTE(dg): State changes are temporary. Need proper state machine
-      if (entity_has_prop(en, EntityProp_Controlled))
-      {
-        entity_look_at(en, mouse_pos);
-
-        if (is_key_pressed(Key_A) && !is_key_pressed(Key_D))
-        {
-          en->new_vel.x = lerp_1f(en->new_vel.x, -en->speed * dt, PLAYER_ACC * dt);
-          if (entity_has_prop(en, EntityProp_Grounded))
-          {
-            en->state = EntityState_Walk;
-          }
-        }
+      entity_look_at(en, mouse_pos);
 
-        if (is_key_pressed(Key_D) && !is_key_pressed(Key_A))
-        {
-          en->new_vel.x = lerp_1f(en->new_vel.x, en->speed * dt, PLAYER_ACC * dt);
-          if (entity_has_prop(en, EntityProp_Grounded))
-          {
-            en->state = EntityState_Walk;
-          }
-        }
-
-        if (is_key_pressed(Key_A) && is_key_pressed(Key_D))
-        {
-          en->new_vel.x = lerp_1f(en->new_vel.x, 0.0f, PLAYER_FRIC * 2.0f * dt);
-          en->new_vel.x = to_zero(en->new_vel.x, 1.0f);
-          if (entity_has_prop(en, EntityProp_Grounded))
-          {
-            en->state = EntityState_Walk;
-          }
-        }
-        
-        if (!is_key_pressed(Key_A) && !is_key_pressed(Key_D))
+      if (is_key_pressed(Key_A) && !is_key_pressed(Key_D))
+      {
+        en_new_vel(en).x = lerp_1f(en_new_vel(en).x, -en->speed * dt, PLAYER_ACC * dt);
+        if (entity_has_prop(en, EntityProp_Grounded))
         {
-          en->new_vel.x = lerp_1f(en->new_vel.x, 0.0f, PLAYER_FRIC * dt);
-          en->new_vel.x = to_zero(en->new_vel.x, 1.0f);
-          if (entity_has_prop(en, EntityProp_Grounded))
-          {
-            en->state = EntityState_Idle;
-          }
+          en->state = EntityState_Walk;
         }
+      }
 
-        bool jump_key_pressed = is_key_pressed(Key_W) || is_key_pressed(Key_Space);
-        if (jump_key_pressed && entity_has_prop(en, EntityProp_Grounded))
+      if (is_key_pressed(Key_D) && !is_key_pressed(Key_A))
+      {
+        en_new_vel(en).x = lerp_1f(en_new_vel(en).x, en->speed * dt, PLAYER_ACC * dt);
+        if (entity_has_prop(en, EntityProp_Grounded))
         {
-          en->new_vel.y = prefab.player_stat[game.player_gender].jump_vel * dt;
-          entity_rem_prop(en, EntityProp_Grounded);
-          en->state = EntityState_Jump;
+          en->state = EntityState_Walk;
         }
+      }
 
-        // @TODO: This should not be the jump state entry.
-        if (!entity_has_prop(en, EntityProp_Grounded))
+      if (is_key_pressed(Key_A) && is_key_pressed(Key_D))
+      {
+        en_new_vel(en).x = lerp_1f(en_new_vel(en).x, 0.0f, PLAYER_FRIC * 2.0f * dt);
+        en_new_vel(en).x = to_zero(en_new_vel(en).x, 1.0f);
+        if (entity_has_prop(en, EntityProp_Grounded))
         {
+          en->state = EntityState_Walk;
         }
       }
-      else
+      
+      if (!is_key_pressed(Key_A) && !is_key_pressed(Key_D))
       {
-        Vec2F player_pos = pos_from_entity(player);
-        f32 dist_from_player = distance_2f(pos_from_entity(en), player_pos);
-
-        switch (en->move_type)
+        en_new_vel(en).x = lerp_1f(en_new_vel(en).x, 0.0f, PLAYER_FRIC * dt);
+        en_new_vel(en).x = to_zero(en_new_vel(en).x, 1.0f);
+        if (entity_has_prop(en, EntityProp_Grounded))
         {
-        default: break;
-        case MoveType_Grounded:
-          if (entity_has_prop(en, EntityProp_Grounded) && !entity_is_laying(en))
-          { 
-            if (dist_from_player >= en->stop_dist)
-            {
-              en->state = EntityState_Walk;
-            }
-            else
-            {
-              en->state = EntityState_Idle;
-            }
-          }
-
-          if (en->state == EntityState_Walk)
-          {
-            en->new_vel.x = en->flip_x ? -en->speed * dt : en->speed * dt;
-          }
-          else
-          {
-            en->new_vel.x = 0;
-          }
-
-          break;
-        case MoveType_Flying:
-          if (en->has_target)
-          {
-            en->input_dir.x = cos_1f(en->target_angle);
-            en->input_dir.y = sin_1f(en->target_angle);
-
-            en->rot = en->target_angle * DEGREES;
-          }
-          else
-          {
-            en->input_dir = V2F_ZERO;
-          }
+          en->state = EntityState_Idle;
+        }
+      }
 
-          if (en->input_dir.x != 0.0f || en->input_dir.y != 0.0f)
-          {
-            en->input_dir = normalize_2f(en->input_dir);
-          }
+      bool jump_key_pressed = is_key_pressed(Key_W) || is_key_pressed(Key_Space);
+      if (jump_key_pressed && entity_has_prop(en, EntityProp_Grounded))
+      {
+        en_new_vel(en).y = prefab.player_stat[game.player_gender].jump_vel * dt;
+        entity_rem_prop(en, EntityProp_Grounded);
+        en->state = EntityState_Jump;
+      }
 
-          // X Acceleration
-          if (en->input_dir.x != 0.0f)
-          {
-            en->new_vel.x += PLAYER_ACC * dir(en->input_dir.x) * dt;
-            f32 bound = en->speed * absv(en->input_dir.x) * dt;
-            en->new_vel.x = clamp(en->vel.x, -bound, bound);
-          }
-          else
-          {
-            en->new_vel.x = lerp_1f(en->vel.x, 0.0f, PLAYER_FRIC * dt);
-            en->new_vel.x = to_zero(en->vel.x, 0.1f);
-          }
+      // @TODO: This should not be the jump state entry.
+      if (!entity_has_prop(en, EntityProp_Grounded))
+      {
+      }
+    }
+    else
+    {
+      Vec2F player_pos = pos_from_entity(player);
+      f32 dist_from_player = distance_2f(pos_from_entity(en), player_pos);
 
-          // Y Acceleration
-          if (en->input_dir.y != 0.0f)
+      switch (en->move_type)
+      {
+      default: break;
+      case MoveType_Grounded:
+        if (entity_has_prop(en, EntityProp_Grounded) && !entity_is_laying(en))
+        { 
+          if (dist_from_player >= en->stop_dist)
           {
-            en->new_vel.y += PLAYER_ACC * dir(en->input_dir.y) * dt;
-            f32 bound = en->speed * absv(en->input_dir.y) * dt;
-            en->new_vel.y = clamp(en->vel.y, -bound, bound);
+            en->state = EntityState_Walk;
           }
           else
           {
-            en->new_vel.y = lerp_1f(en->vel.y, 0.0f, PLAYER_FRIC * dt);
-            en->new_vel.y = to_zero(en->vel.y, 0.1f);
+            en->state = EntityState_Idle;
           }
-        case MoveType_Projectile:
-          en->new_vel.x = cos_1f(en->rot * RADIANS) * en->speed * dt;
-          en->new_vel.y = sin_1f(en->rot * RADIANS) * en->speed * dt;
-          break;
         }
-      }
-
-      en->vel = en->new_vel;
-      en->pos = add_2f(en->pos, en->vel);
 
-      if (entity_has_prop(en, EntityProp_WrapsAtEdges))
-      {
-        Vec2F dim = dim_from_entity(en);
-        f32 left = screen_to_world(v2f(global.viewport.x, 0)).x;
-        f32 right = screen_to_world(v2f(global.viewport.z, 0)).x;
-
-        if (en->pos.x + dim.width <= left)
+        if (en->state == EntityState_Walk)
         {
-          en->pos.x = right;
+          en_new_vel(en).x = en->flip_x ? -en->speed * dt : en->speed * dt;
         }
-        else if (en->pos.x >= right)
+        else
         {
-          en->pos.x = left;
+          en_new_vel(en).x = 0;
         }
-      }
-    }
 
-    // - Wagon merchant face player ---
-    if (en->type == EntityType_Merchant)
-    {
-      Vec2F en_pos = pos_from_entity(en);
-      Vec2F player_pos = pos_from_entity(player);
-      if (en_pos.x < player_pos.x)
-      {
-        en->sprite = prefab.sprite.wagon_left;
+        break;
+      case MoveType_Flying:
+        if (en->has_target)
+        {
+          en->input_dir.x = cos_1f(en->target_angle);
+          en->input_dir.y = sin_1f(en->target_angle);
+
+          en->rot = en->target_angle * DEGREES;
+        }
+        else
+        {
+          en->input_dir = V2F_ZERO;
+        }
+
+        if (en->input_dir.x != 0.0f || en->input_dir.y != 0.0f)
+        {
+          en->input_dir = normalize_2f(en->input_dir);
+        }
+
+        // X Acceleration
+        if (en->input_dir.x != 0.0f)
+        {
+          en_new_vel(en).x += PLAYER_ACC * dir(en->input_dir.x) * dt;
+          f32 bound = en->speed * absv(en->input_dir.x) * dt;
+          en_new_vel(en).x = clamp(en_vel(en).x, -bound, bound);
+        }
+        else
+        {
+          en_new_vel(en).x = lerp_1f(en_vel(en).x, 0.0f, PLAYER_FRIC * dt);
+          en_new_vel(en).x = to_zero(en_vel(en).x, 0.1f);
+        }
+
+        // Y Acceleration
+        if (en->input_dir.y != 0.0f)
+        {
+          en_new_vel(en).y += PLAYER_ACC * dir(en->input_dir.y) * dt;
+          f32 bound = en->speed * absv(en->input_dir.y) * dt;
+          en_new_vel(en).y = clamp(en_vel(en).y, -bound, bound);
+        }
+        else
+        {
+          en_new_vel(en).y = lerp_1f(en_vel(en).y, 0.0f, PLAYER_FRIC * dt);
+          en_new_vel(en).y = to_zero(en_vel(en).y, 0.1f);
+        }
+      case MoveType_Projectile:
+        en_new_vel(en).x = cos_1f(en->rot * RADIANS) * en->speed * dt;
+        en_new_vel(en).y = sin_1f(en->rot * RADIANS) * en->speed * dt;
+        break;
       }
-      else
+    }
+
+    // - Integrate entity velocity ---
+    // NOTE(dg): Done here rather than in a pass of its own so the movers after this
+    // one see where it is this tick, as they did when this was one loop. A root's world
+    // position is its position, so it is set now and the xform pass fills in the rest.
+    en_vel(en) = en_new_vel(en);
+    en_pos(en) = add_2f(en_pos(en), en_vel(en));
+
+    if (entity_has_prop(en, EntityProp_WrapsAtEdges))
+    {
+      Vec2F dim = dim_from_entity(en);
+
+      if (en_pos(en).x + dim.width <= edge_left)
       {
-        en->sprite = prefab.sprite.wagon_right;
+        en_pos(en).x = edge_right;
+        en->xform_snap = TRUE;
+      }
+      else if (en_pos(en).x >= edge_right)
+      {
+        en_pos(en).x = edge_left;
+        en->xform_snap = TRUE;
       }
     }
 
-    // - Update entity xform ---
+    if (!entity_is_valid(entity_from_ref(en->parent)))
     {
-      Mat3x3F xform = m3x3f(1.0f);
-      Entity *parent = entity_from_ref(en->parent);
-
-      // Scale
-      xform = mul_3x3f(scale_3x3f(en->scale.x, en->scale.y), xform);
-      if (en->flip_x) xform = mul_3x3f(scale_3x3f(-1.0f, 1.0f), xform);
-      if (en->flip_y) xform = mul_3x3f(scale_3x3f(1.0f, -1.0f), xform);
+      en->world.pos = en_pos(en);
+    }
+  }
 
-      // Rotate
-      xform = mul_3x3f(rotate_3x3f(en->rot * RADIANS), xform);
+  // - Wagon merchant face player ---
+  for (u32 slot = entity_group_next(type_group(EntityType_Merchant), 0); slot != 0;
+       slot = entity_group_next(type_group(EntityType_Merchant), slot))
+  {
+    Entity *en = &game.entities.data[slot];
+    if (!en_is_active(en)) continue;
 
-      // Translate
-      {
-        Vec2F scale = v2f(1.0f, 1.0f);
-        for (Entity *p = parent; entity_is_valid(p); p = entity_from_ref(p->parent))
-        {
-          scale = mul_2f(scale, p->scale);
-        }
+    Vec2F merchant_pos = pos_from_entity(en);
+    Vec2F player_pos = pos_from_entity(player);
+    if (merchant_pos.x < player_pos.x)
+    {
+      en->sprite = prefab.sprite.wagon_left;
+    }
+    else
+    {
+      en->sprite = prefab.sprite.wagon_right;
+    }
+  }
 
-        xform = mul_3x3f(translate_3x3f(en->pos.x/scale.x, en->pos.y/scale.y), xform);
-      }
+  prof_end();
 
-      en->model_mat = xform;
+  // - Update entity xform ---
+  // NOTE(dg): Trees never share an entity, so the roots are shared out over the job
+  // system and each tree is walked on its own.
+  prof_begin("xform");
+  {
+    EntityList *list = &game.entities;
+    XformJob job = {0};
+    job.roots = arena_push(&game.frame_arena, u32, list->count);
 
-      // Move to world space
+    for (u32 type = EntityType_Nil + 1; type < EntityType_COUNT; type++)
+    {
+      EntityGroup *group = en_group(type_group(type));
+      for (u32 i = 0; i < group->count; i++)
       {
-        Mat3x3F model = m3x3f(1.0f);
-        for (Entity *p = parent; entity_is_valid(p); p = entity_from_ref(p->parent))
-        {
-          model = mul_3x3f(p->model_mat, model);
-        }
-        
-        xform = mul_3x3f(model, xform);
-      }
+        Entity *en = &list->data[group->slots[i]];
+        if (entity_is_valid(entity_from_ref(en->parent))) continue;
 
-      en->xform = xform;
+        job.roots[job.root_count++] = group->slots[i];
+      }
     }
+
+    job_parallel_for(job.root_count, XFORM_JOB_GRAIN, update_xform_trees, &job);
+    counter_add(game.counters.pass_xform, job.visited_count);
   }
 
   // - Update equipped entities ---
-  for (EN_IN_ENTITIES)
+  for (u32 slot = entity_group_next(type_group(EntityType_Equipped), 0); slot != 0;
+       slot = entity_group_next(type_group(EntityType_Equipped), slot))
   {
-    if (!en->is_active) continue;
+    Entity *en = &game.entities.data[slot];
+    if (!en_is_active(en) || !entity_has_prop(en, EntityProp_Equipped)) continue;
 
-    if (en->props & EntityProp_Equipped)
+    bool parent_flipped = entity_from_ref(en->parent)->flip_x;
+
+    if (!game.weapon.is_reloading)
     {
-      bool parent_flipped = en->parent.ptr->flip_x;
+      Vec2F entity_pos = pos_from_entity(en);
+      f32 angle = atan_2f(sub_2f(mouse_pos, entity_pos)) * DEGREES;
 
-      if (!game.weapon.is_reloading)
+      if (!parent_flipped)
       {
-        Vec2F entity_pos = pos_from_entity(en);
-        f32 angle = atan_2f(sub_2f(mouse_pos, entity_pos)) * DEGREES;
-
-        if (!parent_flipped)
-        {
-          angle = clamp(angle, -90, 90);
-        }
-        else
+        angle = clamp(angle, -90, 90);
+      }
+      else
+      {
+        if (angle < 0)
         {
-          if (angle < 0)
-          {
-            angle += 360;
-          }
-
-          angle = -clamp(angle, 90, 270) + 180;
+          angle += 360;
         }
 
-        en->rot = angle;
+        angle = -clamp(angle, 90, 270) + 180;
       }
+
+      en->rot = angle;
     }
   }
 
+  prof_end();
+
   // - Update zombie behaviors ---
-  for (EN_IN_ENTITIES)
+  prof_begin("behavior");
+  EntityGroup *zombies = en_group(type_group(EntityType_Zombie));
+  counter_add(game.counters.pass_behavior, zombies->count);
+  for (u32 slot = entity_group_next(type_group(EntityType_Zombie), 0); slot != 0;
+       slot = entity_group_next(type_group(EntityType_Zombie), slot))
   {
-    if (!en->is_active) continue;
+    Entity *en = &game.entities.data[slot];
+    if (!en_is_active(en)) continue;
 
     // - Lay eggs ---
     if (entity_has_prop(en, EntityProp_LaysEggs))
     {
-      if (!en->egg_timer.ticking)
+      EntityTimers *timers = entity_add_timers(en);
+      if (!timers->egg.ticking)
       {
         if (!entity_is_laying(en))
         {
-          timer_start(&en->egg_timer, 3.0f);
+          timer_start(&timers->egg, 3.0f);
         }
         else if (en->state == EntityState_LayEggLaying)
         {
-          timer_start(&en->egg_timer, 2.0f);
+          timer_start(&timers->egg, 2.0f);
         }
       }
 
-      if (timer_timeout(&en->egg_timer))
+      if (timer_timeout(&timers->egg))
       {
-        en->egg_timer.ticking = FALSE;
+        timers->egg.ticking = FALSE;
 
         if (!entity_is_laying(en))
         {
@@ -801,48 +1117,22 @@ void update_game(void)
         }
         else
         {
-          spawn_entity(EntityType_Egg, en->pos);
+          spawn_entity(EntityType_Egg, en_pos(en));
           en->state = EntityState_LayEggEnd;
         }
       }
     }
 
-    // - Update egg ---
-    if (en->type == EntityType_Egg)
-    {
-      if (!en->egg_timer.ticking)
-      {
-        timer_start(&en->egg_timer, 3.0f);
-      }
-
-      f64 remaining_time = timer_remaining(&en->egg_timer);
-      if (remaining_time <= 1.0f)
-      {
-        en->sprite = prefab.sprite.egg_2;
-      }
-      else if (remaining_time <= 2.0f)
-      {
-        en->sprite = prefab.sprite.egg_1;
-      }
-
-      // - Hatched ---
-      if (timer_timeout(&en->egg_timer))
-      {
-        kill_entity(en, FALSE);
-        spawn_zombie(ZombieKind_BabyChicken, pos_from_entity(en));
-        spawn_particles(ParticleKind_EggHatch, sub_2f(pos_from_entity(en), v2f(0, 25)));
-      }
-    }
-
     // - Morphing ---
     if (entity_has_prop(en, EntityProp_Morphs))
     {
-      if (!en->morphing.timer.ticking)
+      EntityMorphing *morphing = entity_add_morphing(en);
+      if (!morphing->timer.ticking)
       {
-        timer_start(&en->morphing.timer, BABY_CHICKEN_GROWTH_DURATION);
+        timer_start(&morphing->timer, BABY_CHICKEN_GROWTH_DURATION);
       }
 
-      if (timer_timeout(&en->morphing.timer))
+      if (timer_timeout(&morphing->timer))
       {
         kill_entity(en, FALSE);
         spawn_zombie(ZombieKind_Chicken, pos_from_entity(en));
@@ -850,538 +1140,508 @@ void update_game(void)
     }
   }
 
-  // - Update entity collision ---
-  for (EN_IN_ENTITIES)
+  // - Update eggs ---
+  EntityGroup *eggs = en_group(type_group(EntityType_Egg));
+  counter_add(game.counters.pass_behavior, eggs->count);
+  for (u32 slot = entity_group_next(type_group(EntityType_Egg), 0); slot != 0;
+       slot = entity_group_next(type_group(EntityType_Egg), slot))
   {
-    if (!en->is_active) continue;
+    Entity *en = &game.entities.data[slot];
+    if (!en_is_active(en)) continue;
 
-    if (entity_has_prop(en, EntityProp_Collides))
+    EntityTimers *timers = entity_add_timers(en);
+    if (!timers->egg.ticking)
     {
-      Vec2F dim = dim_from_entity(en);
-
-      // Ground collision
-      if (entity_has_prop(en, EntityProp_CollidesWithGround))
-      {
-        if (p_rect_y_range_intersect(
-              collision_params_from_entity(en->cols[Collider_Body], en->vel), 
-              v2f(-3000.0f, 3000.0f), GROUND_Y))
-        {
-          en->pos.y = GROUND_Y + 
-                      dim_from_entity(en->cols[Collider_Body]).height/2 -
-                      en->cols[Collider_Body]->pos.y;
-
-          en->vel.y = 0.0f;
-          en->new_vel.y = 0.0f;
-          entity_add_prop(en, EntityProp_Grounded);
-        }
-        else
-        {
-          entity_rem_prop(en, EntityProp_Grounded);
-        }
-      }
-
-      // Bullet vs Zombie collision
-      if (en->type == EntityType_Ammo)
-      {
-        for (Entity *other = game.entities.head; other; other = other->next)
-        {
-          if (other->type == EntityType_Zombie)
-          {
-            if (p_rect_circle_intersect(
-                  collision_params_from_entity(other->cols[Collider_Body], other->vel),
-                  collision_params_from_entity(en->cols[Collider_Hit], en->vel)))
-            {
-              spawn_particles(ParticleKind_Blood, pos_from_entity(en));
-              damage_entity(other, en->damage);
-              kill_entity(en, TRUE);
-            }
-          }
-        }
-      }
-
-      // Zombie vs Player collision
-      if (en->combat_type == CombatType_Melee && entity_is_valid(player))
-      {
-        if (p_rect_rect_intersect(
-              collision_params_from_entity(en->cols[Collider_Hit], en->vel),
-              collision_params_from_entity(player->cols[Collider_Body], player->vel)))
-        {
-          if (!en->colliding_with_player)
-          {
-            // Collision enter
-            en->colliding_with_player = TRUE;
-            damage_entity(player, en->damage);
-            timer_start(&en->invincibility_timer, en->invincibility_timer.duration);
-          }
-          else
-          {
-            if (!en->attack_timer.ticking)
-            {
-              timer_start(&en->attack_timer, en->attack_timer.duration);
-            }
-          }
-          
-          if (timer_timeout(&en->attack_timer) && timer_timeout(&player->invincibility_timer))
-          {
-            en->attack_timer.ticking = FALSE;
-            player->invincibility_timer.ticking = FALSE;
-
-            damage_entity(player, en->damage);
-          }
-        }
-        else
-        {
-          en->colliding_with_player = FALSE;
-          en->attack_timer.ticking = FALSE;
-        }
-      }
-
-      // Item vs Player collision
-      if (en->type == EntityType_Collectable && entity_is_valid(player))
-      {
-        if (p_rect_circle_intersect(
-              collision_params_from_entity(player->cols[Collider_Body], player->vel),
-              collision_params_from_entity(en->cols[Collider_Hit], en->vel)))
-        {
-          if (en->item_kind == CollectableKind_Coin)
-          {
-            spawn_particles(ParticleKind_PickupCoin, pos_from_entity(en));
-            game.coin_count++;
-          }
-          else if (en->item_kind == CollectableKind_Soul)
-          {
-            spawn_particles(ParticleKind_PickupSoul, pos_from_entity(en));
-            game.soul_count++;
-          }
-          
-          kill_entity(en, TRUE);
-        }
-      }
+      timer_start(&timers->egg, 3.0f);
     }
-  }
 
-  // - Update entity combat ---
-  for (EN_IN_ENTITIES)
-  {
-    if (!en->is_active) continue;
-
-    // Update player invinsibility timer
-    if (en->spid == SPID_Player)
+    f64 remaining_time = timer_remaining(&timers->egg);
+    if (remaining_time <= 1.0f)
     {
-      if (!en->invincibility_timer.ticking)
-      {
-        timer_start(&en->invincibility_timer, en->invincibility_timer.duration);
-      }
+      en->sprite = prefab.sprite.egg_2;
     }
-
-    if (entity_has_prop(en, EntityProp_Controlled))
+    else if (remaining_time <= 2.0f)
     {
-      if (en->is_weapon_equipped)
-      {
-        if (game.weapon.shot_count == 0) game.weapon.shot_count = 3;
-
-        if (!en->attack_timer.ticking &&
-            game.weapon.kind == WeaponKind_BurstRifle && 
-            game.weapon.shot_count == 3)
-        {
-          timer_start(&en->attack_timer, en->attack_timer.duration * 3);
-        }
-        else if (!en->attack_timer.ticking)
-        {
-          timer_start(&en->attack_timer, en->attack_timer.duration);
-        }
-
-        bool can_shoot = FALSE;
-        if (timer_timeout(&en->attack_timer) && 
-            game.weapon.ammo_loaded[game.weapon.kind] > 0 && 
-            !game.weapon.is_reloading)
-        {
-          if (game.weapon.kind == WeaponKind_BurstRifle)
-          {
-            can_shoot = ((is_key_pressed(Key_Mouse1) && game.weapon.shot_count == 3) ||
-                        (game.weapon.shot_count < 3 && game.weapon.shot_count > 0)) &&
-                        !game.is_ui_hovered;
-
-            if (can_shoot)
-            {
-              game.weapon.shot_count -= 1;
-            }
-          }
-          else
-          {
-            can_shoot = is_key_pressed(Key_Mouse1) && !game.is_ui_hovered;
-          }
-        }
+      en->sprite = prefab.sprite.egg_1;
+    }
 
-        if (can_shoot)
-        {
-          en->attack_timer.ticking = FALSE;
-
-          Entity *gun = get_entity_child_by_spid(en, SPID_Gun);
-          Entity *shot_point = get_entity_child_at(gun, 0);
-          Vec2F spawn_pos = pos_from_entity(shot_point);
-          f32 spawn_rot = en->flip_x ? -gun->rot + 180 : gun->rot;
-          Entity *ammo = spawn_ammo(prefab.weapon[gun->weapon_kind].ammo_kind, spawn_pos);
-          ammo->rot = spawn_rot;
-          ammo->speed = gun->speed;
-          ammo->damage = gun->damage;
-
-          Entity *muzzle_flash = get_entity_child_at(gun, 1);
-          muzzle_flash->pos = shot_point->pos;
-          if (gun->weapon_kind == WeaponKind_LaserPistol)
-          {
-            muzzle_flash->sprite = prefab.sprite.laser_flash;
-          }
-          else
-          {
-            muzzle_flash->sprite = prefab.sprite.muzzle_flash;
-          }
+    // - Hatched ---
+    if (timer_timeout(&timers->egg))
+    {
+      kill_entity(en, FALSE);
+      spawn_zombie(ZombieKind_BabyChicken, pos_from_entity(en));
+      spawn_particles(ParticleKind_EggHatch, sub_2f(pos_from_entity(en), v2f(0, 25)));
+    }
+  }
 
-          if (!muzzle_flash->muzzle_flash_timer.ticking)
-          {
-            timer_start(&muzzle_flash->muzzle_flash_timer, 0.08f);
-            entity_add_prop(muzzle_flash, EntityProp_Renders);
-            entity_distort_x(gun, 0.7f, 4.0f, 1.0f);
-          }
+  prof_end();
 
-          if (gun->weapon_kind != WeaponKind_LaserPistol)
-          {
-            spawn_particles(ParticleKind_Smoke, spawn_pos);
-          }
-            
-          game.weapon.ammo_loaded[game.weapon.kind] -= 1;
-        }
-      }
-    }
-    else
+  // - Update ground collision and build collision broad phase ---
+  // NOTE(dg): An entity's own ground collision settles its velocity before it is pushed,
+  // so the params cached in the grid match what the narrow phase used to recompute.
+  prof_begin("collision");
+  P_Grid *grid = &game.collision_grid;
+  EntityGroup *ammo = en_group(type_group(EntityType_Ammo));
+  u32 live_ammo_count = 0;
+  u64 narrow_test_count = 0;
+  {
+    p_grid_begin(grid, 
+                 V2F_ZERO, 
+                 v2f(WIDTH, HEIGHT), 
+                 COLLISION_CELL_SIZE, 
+                 game.entities.count * 2,
+                 &game.collision_arena);
+
+    // Ground collision, melee hits and pickups only ever involve these types
+    EntityType collider_types[] = {EntityType_Player, EntityType_Zombie, EntityType_Collectable};
+    for (u32 type_idx = 0; type_idx < arr_len(collider_types); type_idx++)
     {
-      if (entity_is_valid(player) && player->is_active)
+      EntityGroup *group = en_group(type_group(collider_types[type_idx]));
+      counter_add(game.counters.pass_collision, group->count);
+      for (u32 slot = entity_group_next(type_group(collider_types[type_idx]), 0); slot != 0;
+           slot = entity_group_next(type_group(collider_types[type_idx]), slot))
       {
-        entity_set_target(en, ref_from_entity(player));
-      }
-      else
-      {
-        en->has_target = FALSE;
-      }
+        Entity *en = &game.entities.data[slot];
+        if (!en_is_active(en) || !entity_has_prop(en, EntityProp_Collides)) continue;
 
-      if (en->has_target)
-      {
-        switch (en->combat_type)
+        if (entity_has_prop(en, EntityProp_CollidesWithGround))
         {
-        case CombatType_Ranged:
-          if (!en->attack_timer.ticking)
+          narrow_test_count++;
+          if (p_rect_y_range_intersect(
+                collision_params_from_entity(en->cols[Collider_Body], en_vel(en)), 
+                v2f(-3000.0f, 3000.0f), GROUND_Y))
           {
-            timer_start(&en->attack_timer, en->attack_timer.duration);
-          }
-          else if (timer_timeout(&en->attack_timer))
-          {
-            en->attack_timer.ticking = FALSE;
+            en_pos(en).y = GROUND_Y + 
+                        dim_from_entity(en->cols[Collider_Body]).height/2 -
+                        en_pos(en->cols[Collider_Body]).y;
 
-            Vec2F spawn_pos = v2f(en->pos.x, en->pos.y);
-            Entity *ammo = spawn_ammo(AmmoKind_Laser, spawn_pos);
-            ammo->tint = DEBUG_GREEN;
-            ammo->rot = en->rot;
-            ammo->speed = 700.0f;
-          }
-
-          break;
-        case CombatType_Pound:
-          if (!en->attack_timer.ticking && en->state != EntityState_Jump)
-          {
-            timer_start(&en->attack_timer, 3.0f);
+            en_vel(en).y = 0.0f;
+            en_new_vel(en).y = 0.0f;
+            entity_add_prop(en, EntityProp_Grounded);
           }
-
-          if (timer_timeout(&en->attack_timer))
+          else
           {
-            en->attack_timer.ticking = FALSE;
-
-            en->state = EntityState_Jump;
-            en->sprite = prefab.sprite.bloat_pound_0;
-            en->new_vel.y = 1200.0f * dt;
-            entity_rem_prop(en, EntityProp_Grounded); 
+            entity_rem_prop(en, EntityProp_Grounded);
           }
-          
-          if (en->state == EntityState_Jump && entity_has_prop(en, EntityProp_Grounded))
-          {
-            en->state = EntityState_PoundEnd;
-
-            Vec2F this_pos = pos_from_entity(en);
-            Vec2F player_pos = pos_from_entity(player);
-            if (absv(this_pos.x - player_pos.x) <= BLOAT_POUND_RANGE &&
-                entity_has_prop(player, EntityProp_Grounded))
-            {
-              damage_entity(player, en->damage);
-            }
-
-            // - Spawn shockwave ---
-            Vec2F spawn_pos = sub_2f(this_pos, v2f(0, 65.0f));
-            {
-              Entity *shockwave;
-
-              shockwave = spawn_entity(EntityType_Shockwave, spawn_pos);
-              shockwave->kill_timer.duration = 0.5f;
-              shockwave->new_vel.x = -2.5f;
-
-              shockwave = spawn_entity(EntityType_Shockwave, spawn_pos);
-              shockwave->kill_timer.duration = 0.5f;
-              shockwave->new_vel.x = 2.5f;
-              shockwave->flip_x = TRUE;
-            }
-
-            spawn_particles(ParticleKind_Dirt, spawn_pos);
-
-            // @TODO(dg): camera shake
-          }
-
-          break;
-          default: break;
         }
-      }
-    }
-  }
-
-  // - Animate entities ---
-  for (EN_IN_ENTITIES)
-  {
-    if (entity_has_prop(en, EntityProp_BobsOverTime))
-    {
-      if (en->pos.y > en->bobbing.range.e[1] - 0.1f)
-      {
-        en->bobbing.state = -1;
-      }
 
-      if (en->pos.y < en->bobbing.range.e[0] + 0.1f)
-      {
-        en->bobbing.state = 1;
-      }
-      
-      en->pos.y += 10 * dt * en->bobbing.state;
-    }
-
-    if (entity_has_prop(en, EntityProp_DistortScaleX))
-    {
-      if (en->distort_x.state == 0)
-      {
-        en->scale.x -= dt * en->distort_x.rate * 8;
-
-        if (en->scale.x <= en->distort_x.saved * en->distort_x.scale)
+        if (en->combat_type == CombatType_Melee)
         {
-          en->scale.x = en->distort_x.saved * en->distort_x.scale;
-          en->distort_x.state = 1;
+          p_grid_push(grid, 
+                      collision_params_from_entity(en->cols[Collider_Hit], en_vel(en)),
+                      slot,
+                      CollisionLayer_MeleeHit);
         }
-      }
-
-      if (en->distort_x.state == 1)
-      {
-        en->scale.x += dt * en->distort_x.rate;
-
-        if (en->scale.x >= en->distort_x.saved)
+        else if (en->type == EntityType_Collectable)
         {
-          en->scale.x = en->distort_x.saved;
-          en->distort_x.state = 0;
-          entity_rem_prop(en, EntityProp_DistortScaleX);
+          p_grid_push(grid, 
+                      collision_params_from_entity(en->cols[Collider_Hit], en_vel(en)),
+                      slot,
+                      CollisionLayer_Collectable);
         }
       }
     }
 
-    if (entity_has_prop(en, EntityProp_DistortScaleY))
+    counter_add(game.counters.pass_collision, ammo->count);
+    for (u32 i = 0; i < ammo->count; i++)
     {
-      if (en->distort_y.state == 0)
-      {
-        en->scale.y -= dt * en->distort_y.rate * 8;
-
-        if (en->scale.y <= en->distort_y.saved * en->distort_y.scale)
-        {
-          en->scale.y = en->distort_y.saved * en->distort_y.scale;
-          en->distort_y.state = 1;
-        }
-      }
-
-      if (en->distort_y.state == 1)
+      u32 slot = ammo->slots[i];
+      if (game.entities.is_active[slot] && (game.entities.props[slot] & EntityProp_Collides))
       {
-        en->scale.y += dt * en->distort_y.rate;
-
-        if (en->scale.y >= en->distort_y.saved)
-        {
-          en->scale.y = en->distort_y.saved;
-          en->distort_y.state = 0;
-          entity_rem_prop(en, EntityProp_DistortScaleY);
-        }
+        live_ammo_count++;
       }
     }
 
-    if (entity_has_prop(en, EntityProp_FlashWhite))
+    // Zombie bodies are only ever tested against bullets, so skip them on quiet ticks
+    if (live_ammo_count > 0)
     {
-      en->flash_timer.duration = FLASH_TIME;
-
-      if (!en->flash_timer.ticking)
+      for (u32 i = 0; i < zombies->count; i++)
       {
-        timer_start(&en->flash_timer, en->flash_timer.duration);
-      }
-
-      if (timer_timeout(&en->flash_timer))
-      {
-        en->flash_timer.ticking = FALSE;
+        Entity *en = &game.entities.data[zombies->slots[i]];
+        if (en->cols[Collider_Body] == NULL) continue;
 
-        entity_rem_prop(en, EntityProp_FlashWhite);
-      }
-    }
-
-    if (entity_has_prop(en, EntityProp_HideAfterTime))
-    {
-      if (timer_timeout(&en->muzzle_flash_timer))
-      {
-        en->muzzle_flash_timer.ticking = FALSE;
-        
-        entity_rem_prop(en, EntityProp_Renders);
+        p_grid_push(grid, 
+                    collision_params_from_entity(en->cols[Collider_Body], en_vel(en)),
+                    zombies->slots[i],
+                    CollisionLayer_ZombieBody);
       }
     }
 
-    if (en->state == EntityState_Nil) continue;
-    
-    // Clear prev animation if the state changed
-    if (en->prev_state != en->state)
-    {
-      zero(en->anim, Animation);
-      en->prev_state = en->state;
-    }
-    
-    if (en->anim_descriptors != NULL)
-    {
-      AnimationDesc anim_desc = en->anim_descriptors[en->state];
-      en->sprite = anim_desc.frames[en->anim.frame_idx];
-
-      // - Tick animation ---
-      if (anim_desc.frame_count > 1)
-      {
-        en->anim.tick_counter += ANIM_TICK;
-
-        if (en->anim.tick_counter % anim_desc.ticks_per_frame == 0)
-        {
-          en->anim.frame_idx += 1;
-
-          if (en->anim.frame_idx == anim_desc.frame_count)
-          {
-            en->anim.frame_idx = 0;
+    p_grid_build(grid, &game.collision_arena);
+  }
 
-            // - Exit animation ---
-            if (anim_desc.exit_state != EntityState_Nil)
-            {
-              en->state = anim_desc.exit_state;
-            }
-          }
-        }
+  // - Find entities touching the player ---
+  bool *touching_player = arena_push(&game.frame_arena, bool, grid->entry_count);
+  for (u32 i = 0; i < grid->entry_count; i++)
+  {
+    touching_player[i] = FALSE;
+  }
+
+  if (entity_is_valid(player))
+  {
+    P_CollisionParams body = collision_params_from_entity(player->cols[Collider_Body], 
+                                                          en_vel(player));
+    P_GridQuery query = p_grid_query(grid, 
+                                     body, 
+                                     CollisionLayer_MeleeHit | CollisionLayer_Collectable);
+
+    narrow_test_count += query.count;
+    for (u32 i = 0; i < query.count; i++)
+    {
+      P_GridEntry *entry = &grid->entries[query.data[i]];
+      if (entry->mask & CollisionLayer_MeleeHit)
+      {
+        touching_player[query.data[i]] = p_rect_rect_intersect(entry->params, body);
+      }
+      else
+      {
+        touching_player[query.data[i]] = p_rect_circle_intersect(body, entry->params);
       }
     }
   }
 
-  // - Update particles ---
-  for (i32 i = 0; i < MAX_PARTICLES; i++)
+  // - Bullet vs Zombie collision ---
+  for (u32 slot = entity_group_next(type_group(EntityType_Ammo), 0);
+       slot != 0 && live_ammo_count > 0;
+       slot = entity_group_next(type_group(EntityType_Ammo), slot))
   {
-    Particle *particle = &game.particle_buffer.data[i];
+    Entity *en = &game.entities.data[slot];
+    if (!en_is_active(en) || !entity_has_prop(en, EntityProp_Collides)) continue;
 
-    if (!particle->is_active) continue;
+    P_CollisionParams hit = collision_params_from_entity(en->cols[Collider_Hit], en_vel(en));
+    P_GridQuery query = p_grid_query(grid, hit, CollisionLayer_ZombieBody);
 
-    Entity *owner = entity_from_ref(particle->owner);
-    ParticleDesc desc = owner->particle_desc;
-
-    switch (desc.emmission_type)
+    // A bullet only ever hits one zombie, the first in group order. Bodies were pushed
+    // in group order, so that is the lowest entry index.
+    u32 hit_idx = UINT32_MAX;
+    for (u32 j = 0; j < query.count; j++)
     {
-    case ParticleEmmissionType_Burst:
-      if (has_prop(desc.props, ParticleProp_VariateColor))
-      {
-        particle->color = lerp_4f(particle->color, desc.color_secondary, dt);
-      }
+      u32 entry_idx = query.data[j];
+      if (entry_idx >= hit_idx) continue;
 
-      if (has_prop(desc.props, ParticleProp_ScaleOverTime))
+      narrow_test_count++;
+      if (p_rect_circle_intersect(grid->entries[entry_idx].params, hit))
       {
-        particle->scale = add_2f(particle->scale, scale_2f(desc.scale_delta, dt));
-        particle->scale.x = clamp_bot(particle->scale.x, 0.0f);
-        particle->scale.y = clamp_bot(particle->scale.y, 0.0f);
+        hit_idx = entry_idx;
       }
+    }
 
-      if (has_prop(desc.props, ParticleProp_SpeedOverTime))
-      {
-        particle->speed += desc.speed_delta * dt * dt;
-        particle->speed = clamp_bot(particle->speed, 0.0f);
-      }
+    if (hit_idx != UINT32_MAX)
+    {
+      Entity *other = &game.entities.data[grid->entries[hit_idx].id];
+      spawn_particles(ParticleKind_Blood, pos_from_entity(en));
+      damage_entity(other, en->damage);
+      kill_entity(en, TRUE);
+    }
+  }
 
-      if (has_prop(desc.props, ParticleProp_RotateOverTime))
-      {
-        particle->rot += desc.rot_delta * dt * dt;
-      }
+  // - Player collision ---
+  // NOTE(dg): Melee hits and collectables were pushed zombies first and then
+  // collectables, so walking the grid entries visits them in that order.
+  for (u32 entry_idx = 0; entry_idx < grid->entry_count && entity_is_valid(player); entry_idx++)
+  {
+    P_GridEntry *entry = &grid->entries[entry_idx];
+    Entity *en = &game.entities.data[entry->id];
+    bool touching = touching_player[entry_idx];
 
-      if (has_prop(desc.props, ParticleProp_AffectedByGravity))
+    // Zombie vs Player collision
+    if (entry->mask & CollisionLayer_MeleeHit)
+    {
+      EntityTimers *timers = entity_add_timers(en);
+      EntityTimers *player_timers = timers_from_entity(player);
+      if (touching)
       {
-        if (!particle->is_grounded)
+        if (!en->colliding_with_player)
+        {
+          // Collision enter
+          en->colliding_with_player = TRUE;
+          damage_entity(player, en->damage);
+          timer_start(&timers->invincibility, timers->invincibility.duration);
+        }
+        else
+        {
+          if (!timers->attack.ticking)
+          {
+            timer_start(&timers->attack, timers->attack.duration);
+          }
+        }
+        
+        if (timer_timeout(&timers->attack) && timer_timeout(&player_timers->invincibility))
         {
-          particle->vel.x = sin_1f(particle->dir) * particle->speed * dt;
-          particle->vel.y -= GRAVITY * dt * dt;
+          timers->attack.ticking = FALSE;
+          player_timers->invincibility.ticking = FALSE;
+
+          damage_entity(player, en->damage);
         }
       }
       else
       {
-        particle->vel = v2f(
-          sin_1f(particle->dir) * particle->speed * dt,
-          cos_1f(particle->dir) * particle->speed * dt
-        );
+        en->colliding_with_player = FALSE;
+        timers->attack.ticking = FALSE;
       }
+    }
 
-      if (has_prop(desc.props, ParticleProp_CollidesWithGround))
+    // Item vs Player collision
+    if (entry->mask & CollisionLayer_Collectable)
+    {
+      if (touching)
       {
-        Vec2F p_col_pos = {
-          particle->pos.x, 
-          particle->pos.y + particle->scale.y
-        };
-
-        P_CollisionParams params = {.pos=p_col_pos, .vel=particle->vel};
-        if (p_point_y_range_intersect(params, v2f(-3000.0f, 3000.0f), GROUND_Y))
+        if (en->item_kind == CollectableKind_Coin)
         {
-          particle->pos.y = GROUND_Y - particle->scale.y;
-          particle->vel = V2F_ZERO;
-          particle->is_grounded = TRUE;
+          spawn_particles(ParticleKind_PickupCoin, pos_from_entity(en));
+          game.coin_count++;
         }
+        else if (en->item_kind == CollectableKind_Soul)
+        {
+          spawn_particles(ParticleKind_PickupSoul, pos_from_entity(en));
+          game.soul_count++;
+        }
+        
+        kill_entity(en, TRUE);
       }
-      
-      particle->pos = add_2f(particle->pos, particle->vel);
+    }
+  }
+
+  counter_add(game.counters.collision_pairs, grid->candidate_count);
+  counter_add(game.counters.collision_tests, narrow_test_count);
+  prof_end();
+
+  // - Update entity combat ---
+  // NOTE(dg): The player and zombies are the only entities that take part in combat.
+  prof_begin("combat");
+  EntityType fighter_types[] = {EntityType_Player, EntityType_Zombie};
+  for (u32 type_idx = 0; type_idx < arr_len(fighter_types); type_idx++)
+  {
+    EntityGroup *group = en_group(type_group(fighter_types[type_idx]));
+    counter_add(game.counters.pass_combat, group->count);
+    for (u32 slot = entity_group_next(type_group(fighter_types[type_idx]), 0); slot != 0;
+         slot = entity_group_next(type_group(fighter_types[type_idx]), slot))
+    {
+      Entity *en = &game.entities.data[slot];
+      if (!en_is_active(en)) continue;
 
-      if (has_prop(desc.props, ParticleProp_KillAfterTime))
+      EntityTimers *timers = entity_add_timers(en);
+
+      // Update player invinsibility timer
+      if (en->spid == SPID_Player)
       {
-        if (!owner->particle_timer.ticking)
+        if (!timers->invincibility.ticking)
         {
-          timer_start(&owner->particle_timer, desc.duration);
+          timer_start(&timers->invincibility, timers->invincibility.duration);
         }
+      }
 
-        if (timer_timeout(&owner->particle_timer))
+      if (entity_has_prop(en, EntityProp_Controlled))
+      {
+        if (en->is_weapon_equipped)
         {
-          particle->is_active = FALSE;
-          owner->particles_killed += 1;
+          if (game.weapon.shot_count == 0) game.weapon.shot_count = 3;
+
+          if (!timers->attack.ticking &&
+              game.weapon.kind == WeaponKind_BurstRifle && 
+              game.weapon.shot_count == 3)
+          {
+            timer_start(&timers->attack, timers->attack.duration * 3);
+          }
+          else if (!timers->attack.ticking)
+          {
+            timer_start(&timers->attack, timers->attack.duration);
+          }
+
+          bool can_shoot = FALSE;
+          if (timer_timeout(&timers->attack) && 
+              game.weapon.ammo_loaded[game.weapon.kind] > 0 && 
+              !game.weapon.is_reloading)
+          {
+            if (game.weapon.kind == WeaponKind_BurstRifle)
+            {
+              can_shoot = ((is_key_pressed(Key_Mouse1) && game.weapon.shot_count == 3) ||
+                          (game.weapon.shot_count < 3 && game.weapon.shot_count > 0)) &&
+                          !game.is_ui_hovered;
+
+              if (can_shoot)
+              {
+                game.weapon.shot_count -= 1;
+              }
+            }
+            else
+            {
+              can_shoot = is_key_pressed(Key_Mouse1) && !game.is_ui_hovered;
+            }
+          }
 
-          if (owner->particles_killed == desc.count)
+          if (can_shoot)
           {
-            kill_entity(owner, TRUE);
+            timers->attack.ticking = FALSE;
+
+            Entity *gun = get_entity_child_by_spid(en, SPID_Gun);
+            Entity *shot_point = get_entity_child_at(gun, 0);
+            Vec2F spawn_pos = pos_from_entity(shot_point);
+            f32 spawn_rot = en->flip_x ? -gun->rot + 180 : gun->rot;
+            Entity *ammo = spawn_ammo(prefab.weapon[gun->weapon_kind].ammo_kind, spawn_pos);
+            ammo->rot = spawn_rot;
+            ammo->speed = gun->speed;
+            ammo->damage = gun->damage;
+
+            Entity *muzzle_flash = get_entity_child_at(gun, 1);
+            en_pos(muzzle_flash) = en_pos(shot_point);
+            if (gun->weapon_kind == WeaponKind_LaserPistol)
+            {
+              muzzle_flash->sprite = prefab.sprite.laser_flash;
+            }
+            else
+            {
+              muzzle_flash->sprite = prefab.sprite.muzzle_flash;
+            }
+
+            EntityTimers *muzzle_flash_timers = entity_add_timers(muzzle_flash);
+            if (!muzzle_flash_timers->muzzle_flash.ticking)
+            {
+              timer_start(&muzzle_flash_timers->muzzle_flash, 0.08f);
+              entity_add_prop(muzzle_flash, EntityProp_Renders);
+              entity_distort_x(gun, 0.7f, 4.0f, 1.0f);
+            }
+
+            if (gun->weapon_kind != WeaponKind_LaserPistol)
+            {
+              spawn_particles(ParticleKind_Smoke, spawn_pos);
+            }
+            
+            game.weapon.ammo_loaded[game.weapon.kind] -= 1;
           }
         }
       }
       else
       {
-        if (game.just_entered_wave)
+        if (entity_is_valid(player) && en_is_active(player))
         {
-          particle->is_active = FALSE;
-          owner->particles_killed += 1;
-          
-          if (owner->particles_killed == desc.count)
+          entity_set_target(en, ref_from_entity(player));
+        }
+        else
+        {
+          en->has_target = FALSE;
+        }
+
+        if (en->has_target)
+        {
+          switch (en->combat_type)
           {
-            kill_entity(owner, TRUE);
+          case CombatType_Ranged:
+            if (!timers->attack.ticking)
+            {
+              timer_start(&timers->attack, timers->attack.duration);
+            }
+            else if (timer_timeout(&timers->attack))
+            {
+              timers->attack.ticking = FALSE;
+
+              Vec2F spawn_pos = v2f(en_pos(en).x, en_pos(en).y);
+              Entity *ammo = spawn_ammo(AmmoKind_Laser, spawn_pos);
+              ammo->tint = DEBUG_GREEN;
+              ammo->rot = en->rot;
+              ammo->speed = 700.0f;
+            }
+
+            break;
+          case CombatType_Pound:
+            if (!timers->attack.ticking && en->state != EntityState_Jump)
+            {
+              timer_start(&timers->attack, 3.0f);
+            }
+
+            if (timer_timeout(&timers->attack))
+            {
+              timers->attack.ticking = FALSE;
+
+              en->state = EntityState_Jump;
+              en->sprite = prefab.sprite.bloat_pound_0;
+              en_new_vel(en).y = 1200.0f * dt;
+              entity_rem_prop(en, EntityProp_Grounded); 
+            }
+          
+            if (en->state == EntityState_Jump && entity_has_prop(en, EntityProp_Grounded))
+            {
+              en->state = EntityState_PoundEnd;
+
+              Vec2F this_pos = pos_from_entity(en);
+              Vec2F player_pos = pos_from_entity(player);
+              if (absv(this_pos.x - player_pos.x) <= BLOAT_POUND_RANGE &&
+                  entity_has_prop(player, EntityProp_Grounded))
+              {
+                damage_entity(player, en->damage);
+              }
+
+              // - Spawn shockwave ---
+              Vec2F spawn_pos = sub_2f(this_pos, v2f(0, 65.0f));
+              {
+                Entity *shockwave;
+
+                shockwave = spawn_entity(EntityType_Shockwave, spawn_pos);
+                entity_add_timers(shockwave)->kill.duration = 0.5f;
+                en_new_vel(shockwave).x = -2.5f;
+
+                shockwave = spawn_entity(EntityType_Shockwave, spawn_pos);
+                entity_add_timers(shockwave)->kill.duration = 0.5f;
+                en_new_vel(shockwave).x = 2.5f;
+                shockwave->flip_x = TRUE;
+              }
+
+              spawn_particles(ParticleKind_Dirt, spawn_pos);
+
+              // @TODO(dg): camera shake
+            }
+
+            break;
+            default: break;
           }
         }
       }
-    case ParticleEmmissionType_Linear:
-      // ...
-      break;
     }
   }
 
+  prof_end();
+
+  // - Animate entities ---
+  // NOTE(dg): An entity only ever touches itself here, so the live entities are gathered
+  // from the type groups into one array and shared out over the job system.
+  prof_begin("animation");
+  {
+    u32 *slots = arena_push(&game.frame_arena, u32, game.entities.count);
+    u32 animated_count = 0;
+
+    for (u32 type = EntityType_Nil + 1; type < EntityType_COUNT; type++)
+    {
+      EntityGroup *group = en_group(type_group(type));
+      for (u32 i = 0; i < group->count; i++)
+      {
+        slots[animated_count++] = group->slots[i];
+      }
+    }
+
+    counter_add(game.counters.pass_animation, animated_count);
+    begin_deferred_commands();
+    job_parallel_for(animated_count, ANIMATION_JOB_GRAIN, animate_entities, slots);
+    end_deferred_commands(animated_count);
+  }
+
+  prof_end();
+
+  // - Update particles ---
+  // NOTE(dg): While the frame loop is behind, every other particle step is dropped.
+  prof_begin("particles");
+  if (global.frame.behind && !game.particle_buffer.held)
+  {
+    hold_particles();
+    global.frame.degraded_ticks += 1;
+  }
+  else
+  {
+    update_particles(dt);
+  }
+
+  counter_add(game.counters.particles, game.particle_buffer.count);
+  prof_end();
+
   if (game.state == GameState_SoOver)
   {
     // FIXME(dg): center these alignments
@@ -1396,6 +1656,7 @@ void update_game(void)
   }
 
   // - Event queue ---
+  prof_begin("events");
   for (Event *ev = peek_event(); game.event_queue.count != 0; pop_event())
   {
     switch (ev->type)
@@ -1430,14 +1691,17 @@ void update_game(void)
         // Spawn drop
         if (kind != CollectableKind_Nil)
         {
-          spawn_collectable(kind, v2f(en->pos.x, GROUND_Y + (4 * SPRITE_SCALE)));
+          spawn_collectable(kind, v2f(en_pos(en).x, GROUND_Y + (4 * SPRITE_SCALE)));
         }
       }
     break;
     }
   }
 
+  prof_end();
+
   // - HUD ---
+  prof_begin("hud");
   {
     // - Hearts ---
     {
@@ -1496,150 +1760,471 @@ void update_game(void)
       ui_text(str("%i"), v2f(65, 35), 30, 999, game.soul_count);
     }
 
-    ui_text(str("%.0f"), v2f(WIDTH/2 - 20, HEIGHT-50), 25, 999, game.time_alive);
-    ui_text(str("Wave %i"), v2f(WIDTH-150, HEIGHT-50), 25, 999, game.current_wave.num+1);
+    ui_text(str("%.0f"), v2f(WIDTH/2 - 20, HEIGHT-50), 25, 999, game.time_alive);
+    ui_text(str("Wave %i"), v2f(WIDTH-150, HEIGHT-50), 25, 999, game.current_wave.num+1);
+  }
+
+  if (global.debug)
+  {
+    String duration_str;
+
+    duration_str = format_duration(game.update_time, &game.frame_arena);
+    duration_str = str_concat(str("update: "), duration_str, &game.frame_arena);
+    duration_str = str_concat(duration_str, str("\n"), &game.frame_arena);
+    ui_text(duration_str, v2f(WIDTH - 150, HEIGHT - 75), 15, 999);
+
+    duration_str = format_duration(game.render_time, &game.frame_arena);
+    duration_str = str_concat(str("render: "), duration_str, &game.frame_arena);
+    duration_str = str_concat(duration_str, str("\n"), &game.frame_arena);
+    ui_text(duration_str, v2f(WIDTH - 150, HEIGHT - 100), 15, 999);
+
+    ui_text(str("pairs: %llu"), v2f(WIDTH - 150, HEIGHT - 125), 15, 999, 
+            game.collision_grid.candidate_count);
+
+    ui_text(str("particles: %u (%llu dropped)"), v2f(WIDTH - 150, HEIGHT - 150), 15, 999, 
+            game.particle_buffer.count,
+            game.particle_buffer.dropped_count);
+
+    ui_text(str("draws: %u, flushes: %u"), v2f(WIDTH - 150, HEIGHT - 175), 15, 999, 
+            game.render_stats.draw_count,
+            game.render_stats.flush_count);
+
+    ui_text(str("quads: %u drawn, %u culled"), v2f(WIDTH - 150, HEIGHT - 225), 15, 999, 
+            game.drawn_count,
+            game.culled_count);
+
+    ui_text(str("latency: %.1f in, %.1f sim, %.1f queue, %.1f draw"), 
+            v2f(WIDTH - 150, HEIGHT - 250), 15, 999, 
+            game.latency.input / 1000000.0,
+            game.latency.update / 1000000.0,
+            game.latency.queue / 1000000.0,
+            game.latency.render / 1000000.0);
+
+    ui_text(str("ticks: %llu dropped, %llu degraded"), v2f(WIDTH - 150, HEIGHT - 275), 15, 999, 
+            global.frame.dropped_ticks,
+            global.frame.degraded_ticks);
+
+    ui_text(str("text: %.3f ms (%u laid out)"), v2f(WIDTH - 150, HEIGHT - 200), 15, 999, 
+            stm_ms(game.text_stats.layout_ticks),
+            game.text_stats.layout_count);
+
+    profile_draw_overlay(v2f(10, HEIGHT - 295), v2f(WIDTH - 20, 96));
+    counters_draw_overlay(v2f(10, HEIGHT - 140), v2f(500, 132));
+  }
+
+  // - Developer tools ---
+  {
+    // - Toggle debug ---
+    if (is_key_just_pressed(Key_Tab))
+    {
+      global.debug = !global.debug; 
+    }
+    
+    for (u32 slot = entity_group_next(type_group(EntityType_Debug), 0); slot != 0;
+         slot = entity_group_next(type_group(EntityType_Debug), slot))
+    {
+      Entity *en = &game.entities.data[slot];
+      if (!en_is_active(en)) continue;
+      
+      if (global.debug)
+      {
+        entity_add_prop(en, EntityProp_Renders);
+      }
+      else
+      {
+        entity_rem_prop(en, EntityProp_Renders);
+      }
+    }
+
+    // - Kill player ---
+    if (is_key_just_pressed(Key_Backspace) && entity_is_valid(player))
+    { 
+      kill_entity(player, TRUE);
+    }
+
+    // - Spawn particles --- 
+    // if (is_key_pressed(Key_P) && entity_is_valid(player))
+    // {
+    //   spawn_particles(ParticleKind_Debug, en_pos(player));
+    // }
+
+    // - Write profile trace ---
+    if (is_key_just_pressed(Key_9) && global.debug)
+    {
+      profile_write_trace(str("trace.json"));
+    }
+
+    // - Stream counters ---
+    if (is_key_just_pressed(Key_8) && global.debug)
+    {
+      if (counters_are_streaming())
+      {
+        counters_close_csv();
+      }
+      else
+      {
+        counters_open_csv(str("counters.csv"));
+      }
+    }
+
+    // - Unlock all progression ---
+    if (is_key_just_pressed(Key_P) && entity_is_valid(player))
+    {
+      for (i32 i = 1; i < WeaponKind_COUNT; i++)
+      {
+        game.progression.weapon_unlocked[i] = TRUE;
+      }
+    }
+  }
+
+  prof_end();
+
+  reset_nil_entity();
+
+  // - Close the tick's counters ---
+  for (u32 type = EntityType_Nil + 1; type < EntityType_COUNT; type++)
+  {
+    counter_set(game.counters.entities[type], en_group(type_group(type))->count);
+  }
+
+  counter_set(game.counters.frame_arena_bytes, 
+              (u64) (game.frame_arena.allocated - game.frame_arena.memory));
+  counters_end_tick();
+
+  arena_clear(&game.frame_arena);
+
+  prof_end();
+}
+
+// Marks which members of the render group overlap the view. Bounds come from the
+// transformed quad each entity draws, and are tested four at a time.
+static
+void cull_renders(EntityGroup *renders, bool *visible)
+{
+  for (u32 i = 0; i < renders->count; i += 4)
+  {
+    f32 pos_x[4] = {0};
+    f32 pos_y[4] = {0};
+    f32 axis_xx[4] = {0};
+    f32 axis_xy[4] = {0};
+    f32 axis_yx[4] = {0};
+    f32 axis_yy[4] = {0};
+    f32 dim_x[4] = {0};
+    f32 dim_y[4] = {0};
+
+    u32 lane_count = min(renders->count - i, 4);
+    for (u32 lane = 0; lane < lane_count; lane++)
+    {
+      u32 slot = renders->slots[i+lane];
+      Entity *en = &game.entities.data[slot];
+      Mat3x3F *xform = &game.entities.xform[slot];
+
+      // NOTE(dg): Primitives are drawn as a 16x16 quad about the origin.
+      Vec2F dim = en->draw_type == DrawType_Sprite ? en->dim : v2f(16.0f, 16.0f);
+
+      pos_x[lane] = xform->e[0][2];
+      pos_y[lane] = xform->e[1][2];
+      axis_xx[lane] = xform->e[0][0];
+      axis_xy[lane] = xform->e[0][1];
+      axis_yx[lane] = xform->e[1][0];
+      axis_yy[lane] = xform->e[1][1];
+      dim_x[lane] = dim.width;
+      dim_y[lane] = dim.height;
+    }
+
+    F32x4 zero = f32x4(0.0f);
+    F32x4 half = f32x4(0.5f);
+    F32x4 xx = load_f32x4(axis_xx);
+    F32x4 xy = load_f32x4(axis_xy);
+    F32x4 yx = load_f32x4(axis_yx);
+    F32x4 yy = load_f32x4(axis_yy);
+    F32x4 half_w = mul_f32x4(load_f32x4(dim_x), half);
+    F32x4 half_h = mul_f32x4(load_f32x4(dim_y), half);
+
+    F32x4 ext_x = add_f32x4(mul_f32x4(max_f32x4(xx, sub_f32x4(zero, xx)), half_w),
+                            mul_f32x4(max_f32x4(xy, sub_f32x4(zero, xy)), half_h));
+    F32x4 ext_y = add_f32x4(mul_f32x4(max_f32x4(yx, sub_f32x4(zero, yx)), half_w),
+                            mul_f32x4(max_f32x4(yy, sub_f32x4(zero, yy)), half_h));
+
+    u32 mask = view_mask_f32x4(load_f32x4(pos_x), load_f32x4(pos_y), ext_x, ext_y);
+    for (u32 lane = 0; lane < lane_count; lane++)
+    {
+      visible[i+lane] = (mask >> lane) & 1;
+    }
+  }
+}
+
+// Renders the current tick on this thread, through the same snapshot the render thread
+// would be handed. alpha is how far past the last tick the frame is, from 0 to 1.
+void render_game(f32 alpha)
+{
+  prof_begin("render_game");
+  snapshot_game(&game.snapshot);
+
+  // NOTE(dg): Nothing waits between the stages here, so only drawing shows up.
+  u64 now = stm_now();
+  game.snapshot.input_time = now;
+  game.snapshot.update_start = now;
+  game.snapshot.publish_time = now;
+
+  RenderFeedback feedback = {0};
+  draw_snapshot(&game.snapshot, alpha, &feedback);
+  apply_feedback(&feedback);
+  prof_end();
+}
+
+// @Snapshot /////////////////////////////////////////////////////////////////////////////
+
+void init_triple_buffer(TripleBuffer *buffer)
+{
+  buffer->write = 0;
+  buffer->shared = 1;
+  buffer->read = 2;
+}
+
+// Hands the write slot to the reader and takes back whichever slot was shared.
+void triple_buffer_publish(TripleBuffer *buffer)
+{
+  buffer->write = os_atomic_exchange_u32(&buffer->shared, buffer->write | TRIPLE_BUFFER_FRESH);
+  buffer->write &= ~TRIPLE_BUFFER_FRESH;
+}
+
+// Moves the read slot on to the newest published one. Returns false, leaving the read
+// slot as it was, when nothing has been published since the last call.
+bool triple_buffer_acquire(TripleBuffer *buffer)
+{
+  if (!(os_atomic_load_u32(&buffer->shared) & TRIPLE_BUFFER_FRESH)) return FALSE;
+
+  buffer->read = os_atomic_exchange_u32(&buffer->shared, buffer->read);
+  buffer->read &= ~TRIPLE_BUFFER_FRESH;
+
+  return TRUE;
+}
+
+void init_snapshot(RenderSnapshot *snapshot)
+{
+  zero(*snapshot, RenderSnapshot);
+  snapshot->arena = create_arena(GiB(1), FALSE);
+}
+
+// Copies out what is visible this tick. Entities go in slot order and are culled here,
+// so a snapshot only holds quads that will be drawn.
+void snapshot_game(RenderSnapshot *snapshot)
+{
+  prof_begin("snapshot");
+  arena_clear(&snapshot->arena);
+
+  // NOTE(dg): Groups are kept in slot order, which is the draw order.
+  EntityGroup *renders = en_group(EntityGroup_Renders);
+
+  // - Cull ---
+  // NOTE(dg): Everything is tested against the view before any vertices are made.
+  // Whatever falls outside is counted and skipped.
+  bool *visible = arena_push(&game.draw_arena, bool, renders->count);
+  cull_renders(renders, visible);
+  u32 culled_count = 0;
+
+  // - Sprites ---
+  snapshot->sprites = arena_push(&snapshot->arena, SnapshotSprite, renders->count);
+  snapshot->sprite_count = 0;
+  for (u32 i = 0; i < renders->count; i++)
+  {
+    u32 slot = renders->slots[i];
+    EntityProp props = game.entities.props[slot];
+
+    Entity *en = &game.entities.data[slot];
+    if (en->draw_type != DrawType_Sprite) continue;
+
+    if (!visible[i])
+    {
+      culled_count++;
+      continue;
+    }
+
+    snapshot->sprites[snapshot->sprite_count++] = (SnapshotSprite) {
+      .prev_xform = en->xform_snap ? game.entities.xform[slot] : game.entities.prev_xform[slot],
+      .xform = game.entities.xform[slot],
+      .dim = en->dim,
+      .tint = en->tint,
+      .sprite = en->sprite,
+      .flash = (props & EntityProp_FlashWhite) != 0,
+    };
   }
 
-  if (global.debug)
+  // - Primitives ---
+  snapshot->rects = arena_push(&snapshot->arena, SnapshotRect, renders->count);
+  snapshot->rect_count = 0;
+  for (u32 i = 0; i < renders->count; i++)
   {
-    String duration_str;
+    u32 slot = renders->slots[i];
+    if (!game.entities.is_active[slot]) continue;
 
-    duration_str = format_duration(game.update_time, &game.frame_arena);
-    duration_str = str_concat(str("update: "), duration_str, &game.frame_arena);
-    duration_str = str_concat(duration_str, str("\n"), &game.frame_arena);
-    ui_text(duration_str, v2f(WIDTH - 150, HEIGHT - 75), 15, 999);
+    Entity *en = &game.entities.data[slot];
+    if (en->draw_type != DrawType_Primitive) continue;
 
-    duration_str = format_duration(game.render_time, &game.frame_arena);
-    duration_str = str_concat(str("render: "), duration_str, &game.frame_arena);
-    duration_str = str_concat(duration_str, str("\n"), &game.frame_arena);
-    ui_text(duration_str, v2f(WIDTH - 150, HEIGHT - 100), 15, 999);
-  }
+    if (en->type == EntityType_Collider && !global.debug) continue;
 
-  // - Developer tools ---
-  {
-    // - Toggle debug ---
-    if (is_key_just_pressed(Key_Tab))
+    if (!visible[i])
     {
-      global.debug = !global.debug; 
+      culled_count++;
+      continue;
     }
-    
-    for (EN_IN_ENTITIES)
+
+    Vec4F color = en->tint;
+    if (en->type == EntityType_Collider)
     {
-      if (!en->is_active) continue;
-      
-      if (en->type == EntityType_Debug)
+      switch (en->col_id)
       {
-        if (global.debug)
-        {
-          entity_add_prop(en, EntityProp_Renders);
-        }
-        else
-        {
-          entity_rem_prop(en, EntityProp_Renders);
-        }
+      case Collider_Body:
+      case Collider_Head:
+        color = v4f(0, 1, 0, 0.35f); 
+        break;
+      case Collider_Hit:
+        color = v4f(1, 0, 0, 0.35f); 
+        break;
+      default:            
+        color = v4f(1, 1, 1, 0.35f); 
+        break;
       }
     }
 
-    // - Kill player ---
-    if (is_key_just_pressed(Key_Backspace) && entity_is_valid(player))
-    { 
-      kill_entity(player, TRUE);
-    }
+    snapshot->rects[snapshot->rect_count++] = (SnapshotRect) {
+      .prev_xform = en->xform_snap ? game.entities.xform[slot] : game.entities.prev_xform[slot],
+      .xform = game.entities.xform[slot],
+      .tint = color,
+    };
+  }
 
-    // - Spawn particles --- 
-    // if (is_key_pressed(Key_P) && entity_is_valid(player))
-    // {
-    //   spawn_particles(ParticleKind_Debug, player->pos);
-    // }
+  // - Particles ---
+  ParticleBuffer *particles = &game.particle_buffer;
+  snapshot->particles = arena_push(&snapshot->arena, SnapshotParticle, particles->count);
+  snapshot->particle_count = 0;
+  for (u32 i = 0; i < particles->span_count; i++)
+  {
+    Entity *owner = entity_from_ref(particles->spans[i].owner);
+    EntityParticleGroup *group = particle_group_from_entity(owner);
 
-    // - Unlock all progression ---
-    if (is_key_just_pressed(Key_P) && entity_is_valid(player))
+    // NOTE(dg): A particle's rect turns about its corner at pos, so it stays within
+    // |scale_x| + |scale_y| of pos on either axis.
+    u32 end = group->first + group->count;
+    for (u32 j = group->first; j < end; j += PARTICLE_LANES)
     {
-      for (i32 i = 1; i < WeaponKind_COUNT; i++)
+      F32x4 zero = f32x4(0.0f);
+      F32x4 scale_x = load_f32x4(&particles->scale_x[j]);
+      F32x4 scale_y = load_f32x4(&particles->scale_y[j]);
+      F32x4 ext = add_f32x4(max_f32x4(scale_x, sub_f32x4(zero, scale_x)),
+                            max_f32x4(scale_y, sub_f32x4(zero, scale_y)));
+
+      u32 mask = view_mask_f32x4(load_f32x4(&particles->pos_x[j]), 
+                                 load_f32x4(&particles->pos_y[j]), 
+                                 ext, 
+                                 ext);
+
+      u32 lane_count = min(end - j, PARTICLE_LANES);
+      for (u32 lane = 0; lane < lane_count; lane++)
       {
-        game.progression.weapon_unlocked[i] = TRUE;
+        if (!(mask & (1 << lane)))
+        {
+          culled_count++;
+          continue;
+        }
+
+        u32 k = j + lane;
+        snapshot->particles[snapshot->particle_count++] = (SnapshotParticle) {
+          .prev_pos = v2f(particles->prev_pos_x[k], particles->prev_pos_y[k]),
+          .pos = v2f(particles->pos_x[k], particles->pos_y[k]),
+          .scale = v2f(particles->scale_x[k], particles->scale_y[k]),
+          .prev_rot = particles->prev_rot[k],
+          .rot = particles->rot[k],
+          .color = v4f(particles->color_r[k], 
+                       particles->color_g[k], 
+                       particles->color_b[k], 
+                       particles->color_a[k]),
+        };
       }
     }
   }
 
-  zero(*NIL_ENTITY, Entity);
-  arena_clear(&game.frame_arena);
+  // - Widgets ---
+  // NOTE(dg): Widget text lives in the widget store until the next update, so it is
+  // copied along with the widget.
+  UI_WidgetStore *widgets = ui_get_widgetstore();
+  snapshot->widgets = arena_push(&snapshot->arena, UI_Widget, widgets->count);
+  snapshot->widget_count = widgets->count;
+  for (u64 i = 0; i < widgets->count; i++)
+  {
+    snapshot->widgets[i] = widgets->data[i];
+    snapshot->widgets[i].text = str_copy(widgets->data[i].text, &snapshot->arena);
+  }
+
+  counter_set(game.counters.draw_arena_bytes, 
+              (u64) (game.draw_arena.allocated - game.draw_arena.memory));
+  arena_clear(&game.draw_arena);
+  game.drawn_count = snapshot->sprite_count + snapshot->rect_count + snapshot->particle_count;
+  game.culled_count = culled_count;
+  prof_end();
 }
 
-void render_game(void)
+// Draws a snapshot. It is only read, so the simulation can build the next one meanwhile.
+// Whatever moves is drawn alpha of the way from its previous tick to its last one.
+void draw_snapshot(RenderSnapshot *snapshot, f32 alpha, RenderFeedback *feedback)
 {
+  prof_begin("draw_snapshot");
+  u64 render_start = stm_now();
+
+  R_Renderer *renderer = &global.renderer;
   clear_frame(V4F_ZERO);
 
   // - Draw scene ---
+  prof_begin("scene");
+  r_use_layer(renderer, LAYER_SCENE);
   draw_scene(v2f(0, 0), scale_2f(v2f(192, 108), SPRITE_SCALE), v4f(1, 1, 1, 1));
+  prof_end();
 
   // - Draw sprite batch ---
-  for (EN_IN_ENTITIES)
+  prof_begin("sprites");
+  r_use_layer(renderer, LAYER_SPRITE);
+  for (u32 i = 0; i < snapshot->sprite_count; i++)
   {
-    if (en->draw_type != DrawType_Sprite) continue;
-
-    if (entity_has_prop(en, EntityProp_Renders))
-    {
-      bool flash = entity_has_prop(en, EntityProp_FlashWhite);
-      draw_sprite_x(en->xform, en->dim, en->tint, en->sprite, flash);
-    }
+    SnapshotSprite *sprite = &snapshot->sprites[i];
+    Mat3x3F xform = lerp_3x3f(sprite->prev_xform, sprite->xform, alpha);
+    draw_sprite_x(xform, sprite->dim, sprite->tint, sprite->sprite, sprite->flash);
   }
+
+  prof_end();
   
   // - Draw primitive batch ---
+  prof_begin("primitives");
+  r_use_layer(renderer, LAYER_PRIMITIVE);
   {
-    // Draw entities
-    for (EN_IN_ENTITIES)
+    for (u32 i = 0; i < snapshot->rect_count; i++)
     {
-      if (!en->is_active || en->draw_type != DrawType_Primitive) continue;
-
-      if (entity_has_prop(en, EntityProp_Renders))
-      {
-        if (en->type == EntityType_Collider && global.debug)
-        {
-          Vec4F color = en->tint;
-          switch (en->col_id)
-          {
-          case Collider_Body:
-          case Collider_Head:
-            color = v4f(0, 1, 0, 0.35f); 
-            break;
-          case Collider_Hit:
-            color = v4f(1, 0, 0, 0.35f); 
-            break;
-          default:            
-            color = v4f(1, 1, 1, 0.35f); 
-            break;
-          }
-
-          draw_rect_x(en->xform, color);
-        }
-        else if (en->type != EntityType_Collider)
-        {
-          draw_rect_x(en->xform, en->tint);
-        }
-      }
+      SnapshotRect *rect = &snapshot->rects[i];
+      draw_rect_x(lerp_3x3f(rect->prev_xform, rect->xform, alpha), rect->tint);
     }
 
-    // Draw particles
-    for (i32 i = 0; i < MAX_PARTICLES; i++)
+    for (u32 i = 0; i < snapshot->particle_count; i++)
     {
-      Particle *particle = &game.particle_buffer.data[i];
-      
-      if (!particle->is_active) continue;
-
-      f32 rot = particle->rot * RADIANS;
-      draw_rect(particle->pos, particle->scale, rot, particle->color);
+      SnapshotParticle *particle = &snapshot->particles[i];
+      Vec2F pos = add_2f(scale_2f(particle->prev_pos, 1.0f - alpha), 
+                         scale_2f(particle->pos, alpha));
+      f32 rot = particle->prev_rot * (1.0f - alpha) + particle->rot * alpha;
+      draw_rect(pos, particle->scale, rot * RADIANS, particle->color);
     }
   }
 
+  prof_end();
+
   // - Draw UI batch ---
-  UI_WidgetStore *widgets = ui_get_widgetstore();
+  // NOTE(dg): The UI shares one layer, so rects go under textured rects and those go
+  // under text no matter which widget came first.
+  prof_begin("ui");
+  r_use_layer(renderer, LAYER_UI);
+  u64 text_ticks = 0;
   {
-    for (u64 wdgt_idx = 0; wdgt_idx < widgets->count; wdgt_idx++)
+    for (u64 wdgt_idx = 0; wdgt_idx < snapshot->widget_count; wdgt_idx++)
     {
-      const f32 scale = 1.0f/8;
-
-      UI_Widget widget = widgets->data[wdgt_idx];
+      UI_Widget widget = snapshot->widgets[wdgt_idx];
       switch (widget.type)
       {
       case UI_WidgetType_Nil:
@@ -1651,84 +2236,372 @@ void render_game(void)
         break;
       case UI_WidgetType_Text:
         {}
-        Vec2F offset = V2F_ZERO;
-        u32 word_start_pos = 0;
+        u64 time_start = stm_now();
+        draw_text(widget.text, 
+                  widget.pos, 
+                  widget.text_size, 
+                  widget.dim.width, 
+                  widget.text_spacing, 
+                  widget.space_width, 
+                  R_WHITE);
+        text_ticks += stm_since(time_start);
+        break;
+      }
+    }
+  }
 
-        u32 len = widget.text.len;
-        for (u32 chr_idx = 0; chr_idx < len; chr_idx++)
-        {
-          char chr = widget.text.data[chr_idx];
-          if (((chr < 65 || chr > 90) && (chr < 97 || chr > 122)) || chr_idx == len-1)
-          {
-            UI_Glyph glyph = get_glyph(chr);
+  prof_end();
 
-            // Calculate word length
-            f32 word_len = 0;
-            for (u32 i = word_start_pos; i <= chr_idx; i++)
-            {
-              chr = widget.text.data[i];
-              word_len += (widget.text_size * (glyph.dim.width * scale)) + 
-                          (widget.text_spacing.x * (widget.text_size * scale));
-            }
+  prof_begin("flush");
+  r_flush(renderer);
+  prof_end();
 
-            // Move to next line
-            if (offset.x + word_len > widget.dim.width && chr_idx < len)
-            {
-              offset.x = 0;
-              offset.y -= (widget.text_spacing.y * (widget.text_size * scale)) + 
-                          widget.text_size;
+  feedback->render_stats = renderer->stats;
+  zero(renderer->stats, R_Stats);
 
-              word_len += (glyph.dim.width + glyph.off.x + widget.space_width) * 
-                          widget.text_size;
-            }
+  TextStats *text_stats = get_text_stats();
+  text_stats->layout_ticks = text_ticks;
+  feedback->text_stats = *text_stats;
+  zero(*text_stats, TextStats);
 
-            // Draw the word
-            for (u32 i = word_start_pos; i <= chr_idx; i++)
-            {
-              chr = widget.text.data[i];
-              if (chr != ' ')
-              {
-                UI_Glyph glyph = get_glyph(chr);
+  u64 render_end = stm_now();
+  feedback->latency = (FrameLatency) {
+    .input = stm_ns(stm_diff(snapshot->update_start, snapshot->input_time)),
+    .update = stm_ns(stm_diff(snapshot->publish_time, snapshot->update_start)),
+    .queue = stm_ns(stm_diff(render_start, snapshot->publish_time)),
+    .render = stm_ns(stm_diff(render_end, render_start)),
+  };
 
-                Vec2F draw_pos = add_2f(add_2f(widget.pos, 
-                                        scale_2f(glyph.off, widget.text_size*scale)), 
-                                        offset);
-                draw_glyph(draw_pos, widget.text_size, R_WHITE, glyph.coords);
+  prof_end();
+}
 
-                offset.x += (widget.text_size * (glyph.dim.width * scale)) + 
-                            (widget.text_spacing.x * (widget.text_size * scale));
-              }
-              else
-              {
-                offset.x += widget.space_width * widget.text_size * scale;
-              }
-            }
-            
-            word_start_pos = chr_idx + 1;
-          }
-        }
-        break;
+// Takes in what the last drawn snapshot reported, for the debug overlay and counters.
+void apply_feedback(RenderFeedback *feedback)
+{
+  game.render_stats = feedback->render_stats;
+  game.text_stats = feedback->text_stats;
+  game.latency = feedback->latency;
+
+  GameCounters *counters = &game.counters;
+  R_Stats *stats = &feedback->render_stats;
+  counter_set(counters->draws, stats->draw_count);
+  counter_set(counters->vertices, stats->vertex_count);
+  counter_set(counters->instances, stats->instance_count);
+  counter_set(counters->batches, stats->flush_count);
+  counter_set(counters->flushes, stats->submit_count);
+  counter_set(counters->shader_switches, stats->shader_switch_count);
+  counter_set(counters->texture_switches, stats->texture_switch_count);
+  counter_set(counters->upload_bytes, stats->upload_bytes);
+}
+
+void init_particle_buffer(Arena *arena)
+{
+  ParticleBuffer *buffer = &game.particle_buffer;
+  buffer->pos_x = arena_push(arena, f32, MAX_PARTICLES);
+  buffer->pos_y = arena_push(arena, f32, MAX_PARTICLES);
+  buffer->vel_x = arena_push(arena, f32, MAX_PARTICLES);
+  buffer->vel_y = arena_push(arena, f32, MAX_PARTICLES);
+  buffer->scale_x = arena_push(arena, f32, MAX_PARTICLES);
+  buffer->scale_y = arena_push(arena, f32, MAX_PARTICLES);
+  buffer->speed = arena_push(arena, f32, MAX_PARTICLES);
+  buffer->rot = arena_push(arena, f32, MAX_PARTICLES);
+  buffer->dir_sin = arena_push(arena, f32, MAX_PARTICLES);
+  buffer->dir_cos = arena_push(arena, f32, MAX_PARTICLES);
+  buffer->color_r = arena_push(arena, f32, MAX_PARTICLES);
+  buffer->color_g = arena_push(arena, f32, MAX_PARTICLES);
+  buffer->color_b = arena_push(arena, f32, MAX_PARTICLES);
+  buffer->color_a = arena_push(arena, f32, MAX_PARTICLES);
+  buffer->grounded = arena_push(arena, f32, MAX_PARTICLES);
+  buffer->prev_pos_x = arena_push(arena, f32, MAX_PARTICLES);
+  buffer->prev_pos_y = arena_push(arena, f32, MAX_PARTICLES);
+  buffer->prev_rot = arena_push(arena, f32, MAX_PARTICLES);
+  buffer->count = 0;
+
+  buffer->spans = arena_push(arena, ParticleSpan, MAX_PARTICLES / PARTICLE_LANES);
+  buffer->span_count = 0;
+  buffer->dropped_count = 0;
+  buffer->held = FALSE;
+}
+
+// Reserves a zeroed span at the end of the buffer for the owner's particle group and
+// returns how many particles it got.
+// NOTE(dg): When the buffer is full, the burst is cut down to whatever is left, which
+// may be nothing. The rest are counted as dropped. Live bursts are never touched.
+u32 alloc_particles(Entity *owner, u32 count)
+{
+  ParticleBuffer *buffer = &game.particle_buffer;
+  EntityParticleGroup *group = particle_group_from_entity(owner);
+
+  u32 granted = min(count, MAX_PARTICLES - buffer->count);
+  u32 padded = (granted + PARTICLE_LANES - 1) & ~(PARTICLE_LANES - 1);
+  buffer->dropped_count += count - granted;
+
+  group->first = buffer->count;
+  group->count = granted;
+  if (granted == 0) return 0;
+
+  buffer->spans[buffer->span_count++] = (ParticleSpan) {
+    .owner = ref_from_entity(owner),
+    .first = group->first,
+    .count = padded,
+  };
+
+  buffer->count += padded;
+
+  for (u32 i = group->first; i < group->first + padded; i++)
+  {
+    buffer->pos_x[i] = 0.0f;
+    buffer->pos_y[i] = 0.0f;
+    buffer->vel_x[i] = 0.0f;
+    buffer->vel_y[i] = 0.0f;
+    buffer->scale_x[i] = 0.0f;
+    buffer->scale_y[i] = 0.0f;
+    buffer->speed[i] = 0.0f;
+    buffer->rot[i] = 0.0f;
+    buffer->dir_sin[i] = 0.0f;
+    buffer->dir_cos[i] = 0.0f;
+    buffer->color_r[i] = 0.0f;
+    buffer->color_g[i] = 0.0f;
+    buffer->color_b[i] = 0.0f;
+    buffer->color_a[i] = 0.0f;
+    buffer->grounded[i] = 0.0f;
+    buffer->prev_pos_x[i] = 0.0f;
+    buffer->prev_pos_y[i] = 0.0f;
+    buffer->prev_rot[i] = 0.0f;
+  }
+
+  return granted;
+}
+
+// Slides count particles down from src to dst. dst is never past src, so copying
+// front to back is safe even when the two overlap.
+static
+void move_particles(ParticleBuffer *buffer, u32 dst, u32 src, u32 count)
+{
+  for (u32 i = 0; i < count; i++)
+  {
+    buffer->pos_x[dst+i] = buffer->pos_x[src+i];
+    buffer->pos_y[dst+i] = buffer->pos_y[src+i];
+    buffer->vel_x[dst+i] = buffer->vel_x[src+i];
+    buffer->vel_y[dst+i] = buffer->vel_y[src+i];
+    buffer->scale_x[dst+i] = buffer->scale_x[src+i];
+    buffer->scale_y[dst+i] = buffer->scale_y[src+i];
+    buffer->speed[dst+i] = buffer->speed[src+i];
+    buffer->rot[dst+i] = buffer->rot[src+i];
+    buffer->dir_sin[dst+i] = buffer->dir_sin[src+i];
+    buffer->dir_cos[dst+i] = buffer->dir_cos[src+i];
+    buffer->color_r[dst+i] = buffer->color_r[src+i];
+    buffer->color_g[dst+i] = buffer->color_g[src+i];
+    buffer->color_b[dst+i] = buffer->color_b[src+i];
+    buffer->color_a[dst+i] = buffer->color_a[src+i];
+    buffer->grounded[dst+i] = buffer->grounded[src+i];
+    buffer->prev_pos_x[dst+i] = buffer->prev_pos_x[src+i];
+    buffer->prev_pos_y[dst+i] = buffer->prev_pos_y[src+i];
+    buffer->prev_rot[dst+i] = buffer->prev_rot[src+i];
+  }
+}
+
+// Steps one emitter's span a lane group at a time. The props are the same for the
+// whole span, so every branch here is taken or skipped for all of it.
+static
+void simulate_particles(ParticleBuffer *buffer, u32 first, u32 count, ParticleDesc *desc, f32 dt)
+{
+  b8 props = desc->props;
+
+  F32x4 zeros = f32x4(0.0f);
+  F32x4 ones = f32x4(1.0f);
+  F32x4 t = f32x4(dt);
+  F32x4 target_r = f32x4(desc->color_secondary.r);
+  F32x4 target_g = f32x4(desc->color_secondary.g);
+  F32x4 target_b = f32x4(desc->color_secondary.b);
+  F32x4 target_a = f32x4(desc->color_secondary.a);
+  F32x4 scale_step_x = f32x4(desc->scale_delta.x * dt);
+  F32x4 scale_step_y = f32x4(desc->scale_delta.y * dt);
+  F32x4 speed_step = f32x4(desc->speed_delta * dt * dt);
+  F32x4 rot_step = f32x4(desc->rot_delta * dt * dt);
+  F32x4 gravity_step = f32x4(GRAVITY * dt * dt);
+  F32x4 ground_y = f32x4(GROUND_Y);
+  F32x4 ground_min_x = f32x4(-3000.0f);
+  F32x4 ground_max_x = f32x4(3000.0f);
+
+  for (u32 i = first; i < first + count; i += PARTICLE_LANES)
+  {
+    F32x4 pos_x = load_f32x4(buffer->pos_x + i);
+    F32x4 pos_y = load_f32x4(buffer->pos_y + i);
+    F32x4 vel_x = load_f32x4(buffer->vel_x + i);
+    F32x4 vel_y = load_f32x4(buffer->vel_y + i);
+    F32x4 scale_x = load_f32x4(buffer->scale_x + i);
+    F32x4 scale_y = load_f32x4(buffer->scale_y + i);
+    F32x4 speed = load_f32x4(buffer->speed + i);
+    F32x4 grounded = load_f32x4(buffer->grounded + i);
+
+    store_f32x4(buffer->prev_pos_x + i, pos_x);
+    store_f32x4(buffer->prev_pos_y + i, pos_y);
+    store_f32x4(buffer->prev_rot + i, load_f32x4(buffer->rot + i));
+
+    if (has_prop(props, ParticleProp_VariateColor))
+    {
+      F32x4 r = load_f32x4(buffer->color_r + i);
+      F32x4 g = load_f32x4(buffer->color_g + i);
+      F32x4 b = load_f32x4(buffer->color_b + i);
+      F32x4 a = load_f32x4(buffer->color_a + i);
+      store_f32x4(buffer->color_r + i, add_f32x4(r, mul_f32x4(sub_f32x4(target_r, r), t)));
+      store_f32x4(buffer->color_g + i, add_f32x4(g, mul_f32x4(sub_f32x4(target_g, g), t)));
+      store_f32x4(buffer->color_b + i, add_f32x4(b, mul_f32x4(sub_f32x4(target_b, b), t)));
+      store_f32x4(buffer->color_a + i, add_f32x4(a, mul_f32x4(sub_f32x4(target_a, a), t)));
+    }
+
+    if (has_prop(props, ParticleProp_ScaleOverTime))
+    {
+      scale_x = max_f32x4(add_f32x4(scale_x, scale_step_x), zeros);
+      scale_y = max_f32x4(add_f32x4(scale_y, scale_step_y), zeros);
+    }
+
+    if (has_prop(props, ParticleProp_SpeedOverTime))
+    {
+      speed = max_f32x4(add_f32x4(speed, speed_step), zeros);
+    }
+
+    if (has_prop(props, ParticleProp_RotateOverTime))
+    {
+      store_f32x4(buffer->rot + i, add_f32x4(load_f32x4(buffer->rot + i), rot_step));
+    }
+
+    F32x4 step_x = mul_f32x4(mul_f32x4(load_f32x4(buffer->dir_sin + i), speed), t);
+    if (has_prop(props, ParticleProp_AffectedByGravity))
+    {
+      F32x4 is_grounded = gt_f32x4(grounded, zeros);
+      vel_x = select_f32x4(is_grounded, vel_x, step_x);
+      vel_y = select_f32x4(is_grounded, vel_y, sub_f32x4(vel_y, gravity_step));
+    }
+    else
+    {
+      vel_x = step_x;
+      vel_y = mul_f32x4(mul_f32x4(load_f32x4(buffer->dir_cos + i), speed), t);
+    }
+
+    if (has_prop(props, ParticleProp_CollidesWithGround))
+    {
+      F32x4 bottom_y = add_f32x4(pos_y, scale_y);
+      F32x4 hit = and_f32x4(ge_f32x4(pos_x, ground_min_x), le_f32x4(pos_x, ground_max_x));
+      hit = and_f32x4(hit, le_f32x4(add_f32x4(bottom_y, vel_y), ground_y));
+
+      pos_y = select_f32x4(hit, sub_f32x4(ground_y, scale_y), pos_y);
+      vel_x = select_f32x4(hit, zeros, vel_x);
+      vel_y = select_f32x4(hit, zeros, vel_y);
+      grounded = select_f32x4(hit, ones, grounded);
+    }
+
+    store_f32x4(buffer->pos_x + i, add_f32x4(pos_x, vel_x));
+    store_f32x4(buffer->pos_y + i, add_f32x4(pos_y, vel_y));
+    store_f32x4(buffer->vel_x + i, vel_x);
+    store_f32x4(buffer->vel_y + i, vel_y);
+    store_f32x4(buffer->scale_x + i, scale_x);
+    store_f32x4(buffer->scale_y + i, scale_y);
+    store_f32x4(buffer->speed + i, speed);
+    store_f32x4(buffer->grounded + i, grounded);
+  }
+}
+
+// Simulates and expires spans first to first + count - 1. The f32 at data is dt.
+static
+void simulate_particle_spans(void *data, u32 first, u32 count)
+{
+  prof_begin("simulate_particle_spans");
+  ParticleBuffer *buffer = &game.particle_buffer;
+  f32 dt = *(f32 *) data;
+
+  for (u32 i = first; i < first + count; i++)
+  {
+    set_command_order(i);
+
+    ParticleSpan span = buffer->spans[i];
+    Entity *owner = entity_from_ref(span.owner);
+    EntityParticleGroup *group = particle_group_from_entity(owner);
+    if (group->count == 0) continue;
+
+    ParticleDesc *desc = &group->desc;
+    if (desc->emmission_type != ParticleEmmissionType_Burst) continue;
+
+    simulate_particles(buffer, span.first, group->count, desc, dt);
+
+    // - Kill ---
+    bool expired = FALSE;
+    if (has_prop(desc->props, ParticleProp_KillAfterTime))
+    {
+      if (!group->timer.ticking)
+      {
+        timer_start(&group->timer, desc->duration);
       }
+
+      expired = timer_timeout(&group->timer);
+    }
+    else
+    {
+      expired = game.just_entered_wave;
+    }
+
+    if (expired)
+    {
+      group->count = 0;
+      kill_entity(owner, TRUE);
     }
   }
 
-  r_flush(&global.renderer);
-  arena_clear(&game.draw_arena);
+  prof_end();
 }
 
-Particle *get_next_free_particle(void)
+// Simulates and expires every span, then packs the survivors down over the holes left
+// by dead emitters in buffer order. Costs O(live), whatever the capacity.
+// NOTE(dg): Spans don't overlap, so they are simulated on the job system. Packing moves
+// them, so it waits until they are all done.
+void update_particles(f32 dt)
 {
   ParticleBuffer *buffer = &game.particle_buffer;
-  
-  Particle *result = &buffer->data[buffer->pos];
-  buffer->pos += 1;
 
-  if (buffer->pos == MAX_PARTICLES)
+  begin_deferred_commands();
+  job_parallel_for(buffer->span_count, PARTICLE_JOB_GRAIN, simulate_particle_spans, &dt);
+  end_deferred_commands(buffer->span_count);
+
+  u32 span_count = 0;
+  u32 count = 0;
+  for (u32 i = 0; i < buffer->span_count; i++)
   {
-    buffer->pos = 0;
+    ParticleSpan span = buffer->spans[i];
+    Entity *owner = entity_from_ref(span.owner);
+    EntityParticleGroup *group = particle_group_from_entity(owner);
+    if (group->count == 0) continue;
+
+    // - Compact ---
+    if (span.first != count)
+    {
+      move_particles(buffer, count, span.first, span.count);
+      span.first = count;
+      group->first = count;
+    }
+
+    buffer->spans[span_count++] = span;
+    count += span.count;
   }
 
-  return result;
+  buffer->span_count = span_count;
+  buffer->count = count;
+  buffer->held = FALSE;
+}
+
+// Skips a tick's particle step. Particles stay where they are, so they are drawn still
+// instead of blending over the last step again.
+void hold_particles(void)
+{
+  ParticleBuffer *buffer = &game.particle_buffer;
+  for (u32 i = 0; i < buffer->count; i++)
+  {
+    buffer->prev_pos_x[i] = buffer->pos_x[i];
+    buffer->prev_pos_y[i] = buffer->pos_y[i];
+    buffer->prev_rot[i] = buffer->rot[i];
+  }
+
+  buffer->held = TRUE;
 }
 
 bool is_zombie_remaining_to_spawn(WaveDesc *desc)
@@ -1755,6 +2628,17 @@ void weapon_cancel_reload(void)
 
 void push_event(EventType type, EventDesc desc)
 {
+  if (game.deferring_commands)
+  {
+    defer_command((GameCommand) {
+      .kind = GameCommandKind_PushEvent, 
+      .event_type = type, 
+      .event_desc = desc
+    });
+
+    return;
+  }
+
   EventQueue *queue = &game.event_queue;
 
   Event *new_event = arena_push(&game.frame_arena, Event, 1);
@@ -1797,12 +2681,155 @@ Event *peek_event(void)
   return game.event_queue.front;
 }
 
+thread_local u32 _command_order;
+
+void init_command_buffers(void)
+{
+  for (u32 i = 0; i < JOB_MAX_THREADS; i++)
+  {
+    game.command_buffers[i].arena = create_arena(MiB(64), FALSE);
+  }
+}
+
+// Everything called to change shared state from here on is recorded instead.
+void begin_deferred_commands(void)
+{
+  // NOTE(dg): Without workers a pass runs its items in order on this thread, so the
+  // commands can be carried out as they come.
+  game.deferring_commands = job_worker_count() != 0;
+}
+
+// Carries out the recorded commands in item order. order_count is how many items the
+// pass had. Commands from the same item stay in the order they were recorded, since an
+// item only ever runs on one thread.
+void end_deferred_commands(u32 order_count)
+{
+  game.deferring_commands = FALSE;
+
+  u32 command_count = 0;
+  for (u32 i = 0; i < JOB_MAX_THREADS; i++)
+  {
+    command_count += game.command_buffers[i].count;
+  }
+
+  if (command_count == 0) return;
+
+  Arena scratch = get_scratch_arena(NULL);
+  u32 *offsets = arena_push(&scratch, u32, order_count + 1);
+  GameCommand *sorted = arena_push(&scratch, GameCommand, command_count);
+  for (u32 i = 0; i <= order_count; i++)
+  {
+    offsets[i] = 0;
+  }
+
+  for (u32 i = 0; i < JOB_MAX_THREADS; i++)
+  {
+    GameCommandBuffer *buffer = &game.command_buffers[i];
+    for (u32 j = 0; j < buffer->count; j++)
+    {
+      offsets[buffer->data[j].order + 1] += 1;
+    }
+  }
+
+  for (u32 i = 0; i < order_count; i++)
+  {
+    offsets[i+1] += offsets[i];
+  }
+
+  for (u32 i = 0; i < JOB_MAX_THREADS; i++)
+  {
+    GameCommandBuffer *buffer = &game.command_buffers[i];
+    for (u32 j = 0; j < buffer->count; j++)
+    {
+      sorted[offsets[buffer->data[j].order]++] = buffer->data[j];
+    }
+
+    arena_clear(&buffer->arena);
+    buffer->data = NULL;
+    buffer->count = 0;
+  }
+
+  for (u32 i = 0; i < command_count; i++)
+  {
+    GameCommand *command = &sorted[i];
+    switch (command->kind)
+    {
+      case GameCommandKind_SpawnParticles:
+        spawn_particles(command->particle_kind, command->pos);
+        break;
+      case GameCommandKind_KillEntity:
+        kill_entity(command->en, command->slain);
+        break;
+      case GameCommandKind_PushEvent:
+        push_event(command->event_type, command->event_desc);
+        break;
+      case GameCommandKind_SyncPropGroups:
+        entity_sync_prop_groups(command->en);
+        break;
+    }
+  }
+}
+
+// Tags the commands a job records from here on with the item it is working on.
+inline
+void set_command_order(u32 order)
+{
+  _command_order = order;
+}
+
+// Records command into the calling thread's buffer. Callers check
+// game.deferring_commands first and carry the command out themselves when it is unset.
+void defer_command(GameCommand command)
+{
+  u32 thread_idx = job_thread_index();
+  assert(thread_idx < JOB_MAX_THREADS);
+
+  GameCommandBuffer *buffer = &game.command_buffers[thread_idx];
+  GameCommand *slot = arena_push(&buffer->arena, GameCommand, 1);
+  if (buffer->count == 0)
+  {
+    buffer->data = slot;
+  }
+
+  *slot = command;
+  slot->order = _command_order;
+  buffer->count += 1;
+}
+
 inline
 bool game_should_quit(void)
 {
   return game.should_quit || is_key_pressed(Key_Escape);
 }
 
+// Adds a frame's time to the accumulator and returns how many ticks to run for it.
+// NOTE(dg): Catching up on a long stall makes the next frame longer still, so time past
+// max_accumulator and ticks past max_steps are dropped instead. The frame counts as
+// behind once it needs more than half of max_steps.
+u32 advance_frame(f64 frame_time)
+{
+  global.frame.accumulator += frame_time;
+
+  if (global.frame.accumulator > global.frame.max_accumulator)
+  {
+    f64 excess = global.frame.accumulator - global.frame.max_accumulator;
+    global.frame.dropped_ticks += (u64) (excess / TIME_STEP);
+    global.frame.accumulator = global.frame.max_accumulator;
+  }
+
+  u32 step_count = (u32) (global.frame.accumulator / TIME_STEP);
+  if (step_count > global.frame.max_steps)
+  {
+    global.frame.dropped_ticks += step_count - global.frame.max_steps;
+    global.frame.accumulator -= (step_count - global.frame.max_steps) * (f64) TIME_STEP;
+    step_count = global.frame.max_steps;
+  }
+
+  global.frame.behind = step_count > global.frame.max_steps / 2;
+
+  return step_count;
+}
+
 inline
 Vec2F screen_to_world(Vec2F pos)
 {
@@ -12,11 +12,16 @@
   #define ANIM_TICK 2
 #endif
 
+// Most frame time and ticks a single frame will catch up on
+#define MAX_FRAME_TIME 0.25
+#define MAX_FRAME_STEPS 8
+
 #define WIDTH 960.0f
 #define HEIGHT 540.0f
 #define SPRITE_SCALE 5
 #define GROUND_Y (30 * SPRITE_SCALE)
 #define GRAVITY 3600.0f
+#define COLLISION_CELL_SIZE 64.0f
 
 // @Event ////////////////////////////////////////////////////////////////////////////////
 
@@ -56,6 +61,49 @@ void push_event(EventType type, EventDesc desc);
 void pop_event(void);
 Event *peek_event(void);
 
+// @Command //////////////////////////////////////////////////////////////////////////////
+
+// NOTE(dg): Passes that run on the job system can't touch shared state. While
+// deferring_commands is set, spawn_particles, kill_entity, push_event and
+// entity_sync_prop_groups are recorded into the calling thread's buffer instead.
+// Every command carries the index of the item that issued it, and at the sync point
+// they are carried out in item order, so the result is the same as running the pass on
+// one thread. A deferred spawn_particles returns the nil entity.
+typedef enum GameCommandKind
+{
+  GameCommandKind_SpawnParticles,
+  GameCommandKind_KillEntity,
+  GameCommandKind_PushEvent,
+  GameCommandKind_SyncPropGroups,
+} GameCommandKind;
+
+typedef struct GameCommand GameCommand;
+struct GameCommand
+{
+  GameCommandKind kind;
+  u32 order;
+  Entity *en;
+  bool slain;
+  ParticleKind particle_kind;
+  Vec2F pos;
+  EventType event_type;
+  EventDesc event_desc;
+};
+
+typedef struct GameCommandBuffer GameCommandBuffer;
+struct GameCommandBuffer
+{
+  Arena arena;
+  GameCommand *data;
+  u32 count;
+};
+
+void init_command_buffers(void);
+void begin_deferred_commands(void);
+void end_deferred_commands(u32 order_count);
+void set_command_order(u32 order);
+void defer_command(GameCommand command);
+
 // @Globals //////////////////////////////////////////////////////////////////////////////
 
 typedef struct Globals Globals;
@@ -75,21 +123,85 @@ struct Globals
     f64 current_time;
     f64 elapsed_time;
     f64 accumulator;
+    f64 max_accumulator;
+    u32 max_steps;
+
+    // Set while catching up, so ticks can cut back on work that can afford it
+    bool behind;
+    u64 dropped_ticks;
+    u64 degraded_ticks;
   } frame;
 };
 
 // @Game /////////////////////////////////////////////////////////////////////////////////
 
-#define MAX_PARTICLES 1024
+#define MAX_PARTICLES 16384
+#define PARTICLE_LANES 4
+
+// NOTE(dg): Particles are stored one array per field so they can be simulated four at
+// a time. Each emitter owns a contiguous span that starts on a lane boundary and is
+// padded to a whole number of lanes, so its desc only has to be resolved once. Spans
+// are kept packed at the front of the buffer in allocation order; when an emitter
+// dies, the spans after it slide down during the next update.
+typedef struct ParticleSpan ParticleSpan;
+struct ParticleSpan
+{
+  EntityRef owner;
+  u32 first;
+  u32 count;
+};
 
 typedef struct ParticleBuffer ParticleBuffer;
 struct ParticleBuffer
 {
-  Particle data[MAX_PARTICLES];
-  u32 pos;
+  f32 *pos_x;
+  f32 *pos_y;
+  f32 *vel_x;
+  f32 *vel_y;
+  f32 *scale_x;
+  f32 *scale_y;
+  f32 *speed;
+  f32 *rot;
+  f32 *dir_sin;
+  f32 *dir_cos;
+  f32 *color_r;
+  f32 *color_g;
+  f32 *color_b;
+  f32 *color_a;
+  f32 *grounded;
+  u32 count;
+
+  // Where each particle was a tick ago, for blending between ticks
+  f32 *prev_pos_x;
+  f32 *prev_pos_y;
+  f32 *prev_rot;
+  bool held;
+
+  ParticleSpan *spans;
+  u32 span_count;
+
+  // Particles that did not fit when a burst was spawned
+  u64 dropped_count;
 };
 
-Particle *get_next_free_particle(void);
+void init_particle_buffer(Arena *arena);
+u32 alloc_particles(Entity *owner, u32 count);
+void update_particles(f32 dt);
+void hold_particles(void);
+
+// Items per job for the passes that run on the job system
+#define ANIMATION_JOB_GRAIN 128
+#define XFORM_JOB_GRAIN 32
+#define PARTICLE_JOB_GRAIN 8
+
+// The roots of the entity trees, for the xform pass
+typedef struct XformJob XformJob;
+struct XformJob
+{
+  u32 *roots;
+  u32 root_count;
+  u32 volatile visited_count;
+};
 
 #define TOTAL_WAVE_COUNT 5
 
@@ -103,6 +215,136 @@ struct WaveDesc
 bool is_zombie_remaining_to_spawn(WaveDesc *desc);
 void weapon_cancel_reload(void);
 
+// @Snapshot /////////////////////////////////////////////////////////////////////////////
+
+// NOTE(dg): Hands the newest of a stream of values from one writer thread to one reader
+// thread without locks. Each side owns one of three slots and the third is shared. The
+// writer swaps its finished slot into the shared one with the fresh bit set, and the
+// reader swaps the shared slot out only while that bit is set.
+#define TRIPLE_BUFFER_FRESH 4
+
+typedef struct TripleBuffer TripleBuffer;
+struct TripleBuffer
+{
+  u32 volatile shared;
+  u32 write;
+  u32 read;
+};
+
+void init_triple_buffer(TripleBuffer *buffer);
+void triple_buffer_publish(TripleBuffer *buffer);
+bool triple_buffer_acquire(TripleBuffer *buffer);
+
+typedef struct SnapshotSprite SnapshotSprite;
+struct SnapshotSprite
+{
+  Mat3x3F prev_xform;
+  Mat3x3F xform;
+  Vec2F dim;
+  Vec4F tint;
+  Sprite sprite;
+  bool flash;
+};
+
+typedef struct SnapshotRect SnapshotRect;
+struct SnapshotRect
+{
+  Mat3x3F prev_xform;
+  Mat3x3F xform;
+  Vec4F tint;
+};
+
+typedef struct SnapshotParticle SnapshotParticle;
+struct SnapshotParticle
+{
+  Vec2F prev_pos;
+  Vec2F pos;
+  Vec2F scale;
+  f32 prev_rot;
+  f32 rot;
+  Vec4F color;
+};
+
+// Everything render_game needs from one tick, culled and copied out of the simulation
+// so it can be drawn while the next tick runs. Anything that moves carries where it was
+// a tick before too, so a frame can land between the two. Times are stm ticks.
+typedef struct RenderSnapshot RenderSnapshot;
+struct RenderSnapshot
+{
+  Arena arena;
+
+  SnapshotSprite *sprites;
+  u32 sprite_count;
+  SnapshotRect *rects;
+  u32 rect_count;
+  SnapshotParticle *particles;
+  u32 particle_count;
+  UI_Widget *widgets;
+  u32 widget_count;
+
+  u64 input_time;
+  u64 update_start;
+  u64 publish_time;
+};
+
+// Time a frame spent in each stage, from its input being posted to it being drawn.
+typedef struct FrameLatency FrameLatency;
+struct FrameLatency
+{
+  u64 input;
+  u64 update;
+  u64 queue;
+  u64 render;
+};
+
+// What drawing a snapshot reports back to the simulation.
+typedef struct RenderFeedback RenderFeedback;
+struct RenderFeedback
+{
+  R_Stats render_stats;
+  TextStats text_stats;
+  FrameLatency latency;
+};
+
+void init_snapshot(RenderSnapshot *snapshot);
+void snapshot_game(RenderSnapshot *snapshot);
+void draw_snapshot(RenderSnapshot *snapshot, f32 alpha, RenderFeedback *feedback);
+void apply_feedback(RenderFeedback *feedback);
+
+// Ids of the counters the game keeps per tick. Render and arena counters are gauges
+// that carry the last frame drawn, so they repeat on ticks that weren't drawn.
+typedef struct GameCounters GameCounters;
+struct GameCounters
+{
+  u32 entities[EntityType_COUNT];
+
+  u32 pass_gravity;
+  u32 pass_movement;
+  u32 pass_xform;
+  u32 pass_behavior;
+  u32 pass_collision;
+  u32 pass_combat;
+  u32 pass_animation;
+
+  u32 collision_pairs;
+  u32 collision_tests;
+  u32 particles;
+
+  u32 draws;
+  u32 vertices;
+  u32 instances;
+  u32 batches;
+  u32 flushes;
+  u32 shader_switches;
+  u32 texture_switches;
+  u32 upload_bytes;
+
+  u32 frame_arena_bytes;
+  u32 draw_arena_bytes;
+};
+
+void init_game_counters(void);
+
 typedef enum GameState
 {
   GameState_GracePeriod,
@@ -117,8 +359,19 @@ struct Game
   EventQueue event_queue;
   ParticleBuffer particle_buffer;
 
+  P_Grid collision_grid;
+
   u64 update_time;
   u64 render_time;
+  R_Stats render_stats;
+  u32 drawn_count;
+  u32 culled_count;
+  TextStats text_stats;
+  FrameLatency latency;
+  RenderSnapshot snapshot;
+  GameCounters counters;
+  GameCommandBuffer command_buffers[JOB_MAX_THREADS];
+  bool deferring_commands;
   f64 t;
   f64 dt;
   Mat3x3F camera;
@@ -163,12 +416,14 @@ struct Game
   Arena frame_arena;
   Arena draw_arena;
   Arena entity_arena;
+  Arena collision_arena;
 };
 
 void init_game(void);
 void update_game(void);
-void render_game(void);
+void render_game(f32 alpha);
 bool game_should_quit(void);
+u32 advance_frame(f64 frame_time);
 
 Vec2F screen_to_world(Vec2F pos);
 String format_duration(u64 ns, Arena *arena);
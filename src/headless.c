@@ -0,0 +1,1084 @@
+#if defined(_WIN32)
+  #define WIN32_LEAN_AND_MEAN
+  #include <windows.h>
+  #undef near
+  #undef far
+#endif
+
+#if !defined(__APPLE__)
+  #include "glad/glad.c"
+#endif
+
+#include <stdlib.h>
+
+#include "base/base_common.h"
+#include "base/base_os.c"
+#include "base/base_arena.c"
+#include "base/base_string.c"
+#include "base/base_random.c"
+#include "base/base_logger.c"
+#include "base/base_job.c"
+#include "render/render.c"
+#include "render/render_gl.c"
+#include "render/render_record.c"
+#include "render/render_soft.c"
+#include "vecmath/vecmath.c"
+#include "ui/ui.c"
+#include "profile.c"
+#include "counters.c"
+#include "physics/physics.c"
+#include "prefabs.c"
+#include "draw.c"
+#include "input.c"
+#include "entity.c"
+#include "game.c"
+
+#define SOKOL_IMPL
+#include "sokol/sokol_time.h"
+
+#define STB_IMAGE_IMPLEMENTATION
+#define STBI_ONLY_PNG
+#include "stb/stb_image.h"
+
+#define STB_SPRINTF_IMPLEMENTATION
+#include "stb/stb_sprintf.h"
+
+// @NOTE(dg): Headless driver for the simulation. There is no window, GL context or
+// loaded resources, so only update_game is ever called. Game time advances by exactly
+// TIME_STEP per tick instead of following the wall clock. The render, raster, threaded,
+// trace, counters, fill and sprites modes are the exception. They load the resources
+// and render into the record backend or the soft backend, always landing exactly on
+// the last tick. Any mode takes --workers N to fix how many job workers are started.
+
+#define HEADLESS_DEFAULT_TICKS ((u64) (180.0 / TIME_STEP + 0.5))
+#define HEADLESS_WEAPON_SWAP_TIME 20.0f
+#define HEADLESS_PATROL_MARGIN 100.0f
+#define HEADLESS_BENCH_ENTITIES 10000
+#define HEADLESS_BENCH_TICKS 240
+#define HEADLESS_BENCH_BULLET_SPEED 1500.0f
+#define HEADLESS_BENCH_EMITTERS 192
+#define HEADLESS_BENCH_PARTICLE_TICKS 120
+#define HEADLESS_PLAYER_HEALTH 30000
+#define HEADLESS_RENDER_TICKS 600
+#define HEADLESS_GOLDEN_TOLERANCE 2
+#define HEADLESS_SPRITE_BENCH_SAMPLES 9
+#define HEADLESS_SPRITE_BENCH_COUNT 8192
+
+Globals global;
+Prefabs prefab;
+Game game;
+
+static u64 parse_u64(char *cstr, u64 fallback);
+static void drive_input(u64 tick);
+static void bench_entities(u64 entity_count, u64 tick_count, u64 bullet_count);
+static void run_particle_bench(u64 emitter_count, u64 tick_count);
+static void run_render_bench(u64 tick_count);
+static i32 run_raster(u64 tick_count, String golden_path);
+static i32 run_threaded(u64 tick_count, String golden_path);
+static i32 run_trace(u64 tick_count, String trace_path);
+static i32 run_counters(u64 tick_count, String csv_path);
+static i32 compare_golden(R_Framebuffer *fb, String golden_path);
+static void run_fill_bench(u64 emitter_count, u64 tick_count);
+static void run_sprite_bench(u64 sprite_count, u64 tick_count, u64 sample_count);
+static void write_png(String path, R_Framebuffer *fb);
+
+i32 main(i32 argc, char **argv)
+{
+  // NOTE(dg): --workers N can go anywhere and is taken out before the positional
+  // arguments are read. Without it, one worker is started per spare core.
+  u32 worker_count = os_get_processor_count() - 1;
+  for (i32 i = 1; i < argc - 1; i++)
+  {
+    if (!str_equals((String) {argv[i], cstr_len(argv[i]) - 1}, str("--workers"))) continue;
+
+    worker_count = (u32) parse_u64(argv[i+1], worker_count);
+    for (i32 j = i; j < argc - 2; j++)
+    {
+      argv[j] = argv[j+2];
+    }
+
+    argc -= 2;
+    break;
+  }
+
+  String mode = argc > 1 ? (String) {argv[1], cstr_len(argv[1]) - 1} : str("");
+  bool bench = str_equals(mode, str("bench"));
+  bool bench_particles = str_equals(mode, str("particles"));
+  bool bench_render = str_equals(mode, str("render"));
+  bool raster = str_equals(mode, str("raster"));
+  bool threaded = str_equals(mode, str("threaded"));
+  bool trace = str_equals(mode, str("trace"));
+  bool counters = str_equals(mode, str("counters"));
+  bool bench_fill = str_equals(mode, str("fill"));
+  bool bench_sprites = str_equals(mode, str("sprites"));
+  if (bench || bench_particles || bench_render || raster || threaded || trace || counters || bench_fill || bench_sprites)
+  {
+    argv += 1;
+    argc -= 1;
+  }
+
+  u64 tick_count = argc > 1 ? parse_u64(argv[1], HEADLESS_DEFAULT_TICKS) : HEADLESS_DEFAULT_TICKS;
+
+  Arena logger_arena = create_arena(MiB(64), TRUE);
+  init_logger(str(""), &logger_arena);
+
+  init_scratch_arenas();
+
+  global.perm_arena = create_arena(GiB(16), TRUE);
+
+  game.entity_arena = create_arena(GiB(2), FALSE);
+  game.frame_arena = create_arena(GiB(2), TRUE);
+  game.draw_arena = create_arena(MiB(16), FALSE);
+
+  stm_setup();
+  u32 seed = argc > 2 ? (u32) parse_u64(argv[2], 0) : (u32) stm_now();
+  srand(seed);
+
+  job_init(worker_count);
+  logger_debug(str("[headless] workers: %u\n"), min(worker_count, JOB_MAX_WORKERS));
+
+  global.window.width = WIDTH;
+  global.window.height = HEIGHT;
+  global.viewport = v4f(0, 0, WIDTH, HEIGHT);
+
+  init_prefabs();
+
+  game.dt = TIME_STEP;
+  init_game();
+
+  if (bench)
+  {
+    u64 entity_count = argc > 2 ? parse_u64(argv[2], HEADLESS_BENCH_ENTITIES) : HEADLESS_BENCH_ENTITIES;
+    u64 bullet_count = argc > 3 ? parse_u64(argv[3], 0) : 0;
+    bench_entities(entity_count, argc > 1 ? tick_count : HEADLESS_BENCH_TICKS, bullet_count);
+    return 0;
+  }
+
+  if (bench_particles)
+  {
+    u64 emitter_count = argc > 2 ? parse_u64(argv[2], HEADLESS_BENCH_EMITTERS) : HEADLESS_BENCH_EMITTERS;
+    run_particle_bench(emitter_count, argc > 1 ? tick_count : HEADLESS_BENCH_PARTICLE_TICKS);
+    return 0;
+  }
+
+  if (bench_render)
+  {
+    run_render_bench(argc > 1 ? tick_count : HEADLESS_RENDER_TICKS);
+    return 0;
+  }
+
+  if (raster)
+  {
+    String golden_path = argc > 3 ? (String) {argv[3], cstr_len(argv[3]) - 1} : str("");
+    return run_raster(argc > 1 ? tick_count : HEADLESS_RENDER_TICKS, golden_path);
+  }
+
+  if (threaded)
+  {
+    String golden_path = argc > 3 ? (String) {argv[3], cstr_len(argv[3]) - 1} : str("");
+    return run_threaded(argc > 1 ? tick_count : HEADLESS_RENDER_TICKS, golden_path);
+  }
+
+  if (trace)
+  {
+    String trace_path = argc > 3 ? (String) {argv[3], cstr_len(argv[3]) - 1} : str("trace.json");
+    return run_trace(argc > 1 ? tick_count : HEADLESS_RENDER_TICKS, trace_path);
+  }
+
+  if (counters)
+  {
+    String csv_path = argc > 3 ? (String) {argv[3], cstr_len(argv[3]) - 1} : str("counters.csv");
+    return run_counters(argc > 1 ? tick_count : HEADLESS_RENDER_TICKS, csv_path);
+  }
+
+  if (bench_fill)
+  {
+    u64 emitter_count = argc > 2 ? parse_u64(argv[2], HEADLESS_BENCH_EMITTERS) : HEADLESS_BENCH_EMITTERS;
+    run_fill_bench(emitter_count, argc > 1 ? tick_count : HEADLESS_BENCH_PARTICLE_TICKS);
+    return 0;
+  }
+
+  if (bench_sprites)
+  {
+    u64 sprite_count = argc > 2 ? parse_u64(argv[2], HEADLESS_SPRITE_BENCH_COUNT) : HEADLESS_SPRITE_BENCH_COUNT;
+    u64 sample_count = argc > 3 ? parse_u64(argv[3], HEADLESS_SPRITE_BENCH_SAMPLES) : HEADLESS_SPRITE_BENCH_SAMPLES;
+    run_sprite_bench(sprite_count, argc > 1 ? tick_count : HEADLESS_RENDER_TICKS, max(sample_count, 1));
+    return 0;
+  }
+
+  u64 peak_entity_count = 0;
+  u64 peak_particle_count = 0;
+  u64 update_ticks = 0;
+  u64 candidate_pairs = 0;
+
+  // NOTE(dg): The game only counts kills for the wave in progress, so they are added up
+  // here as the waves go by.
+  u64 kill_count = 0;
+  i32 wave_num = game.current_wave.num;
+  u16 wave_kill_count = 0;
+
+  for (u64 tick = 0; tick < tick_count; tick++)
+  {
+    drive_input(tick);
+
+    game.t = tick * (f64) TIME_STEP;
+
+    u64 time_start = stm_now();
+    update_game();
+    update_ticks += stm_since(time_start);
+    candidate_pairs += game.collision_grid.candidate_count;
+
+    if (game.current_wave.num != wave_num)
+    {
+      wave_num = game.current_wave.num;
+      wave_kill_count = 0;
+    }
+
+    kill_count += game.current_wave.zombies_killed - wave_kill_count;
+    wave_kill_count = game.current_wave.zombies_killed;
+
+    remember_last_keys();
+
+    global.frame.elapsed_time += TIME_STEP;
+
+    u64 entity_count = 0;
+    for (u32 type = EntityType_Nil + 1; type < EntityType_COUNT; type++)
+    {
+      entity_count += en_group(type_group(type))->count;
+    }
+
+    peak_entity_count = max(peak_entity_count, entity_count);
+    peak_particle_count = max(peak_particle_count, game.particle_buffer.count);
+  }
+
+  f64 update_sec = stm_sec(update_ticks);
+  f64 ticks_per_sec = update_sec > 0 ? tick_count / update_sec : 0;
+
+  logger_debug(str("[headless] seed: %u\n"), seed);
+  logger_debug(str("[headless] ticks: %llu (%.1f s simulated)\n"),
+               tick_count,
+               tick_count * (f64) TIME_STEP);
+  logger_debug(str("[headless] update: %.3f s total, %.0f ticks/s\n"), update_sec, ticks_per_sec);
+  logger_debug(str("[headless] candidate pairs: %.1f/tick\n"), candidate_pairs / (f64) tick_count);
+  logger_debug(str("[headless] peak entities: %llu (pool: %llu)\n"),
+               peak_entity_count,
+               game.entities.count);
+  logger_debug(str("[headless] peak particles: %llu (dropped: %llu)\n"),
+               peak_particle_count,
+               game.particle_buffer.dropped_count);
+  logger_debug(str("[headless] wave: %i, killed: %i, state: %i\n"),
+               game.current_wave.num + 1,
+               game.current_wave.zombies_killed,
+               game.state);
+  logger_debug(str("[headless] total killed: %llu\n"), kill_count);
+
+  // A full-length soak that never kills anything means the scripted player stopped
+  // fighting, and the combat and collision paths went untested
+  if (tick_count >= HEADLESS_DEFAULT_TICKS && kill_count == 0)
+  {
+    logger_debug(str("[headless] no zombies were killed\n"));
+    return 1;
+  }
+
+  return 0;
+}
+
+// Fills the world with walkers and times update_game alone. There is no scripted input,
+// so the cost is dominated by the per-entity passes rather than combat. Optionally fires
+// a stream of bullets into the crowd every tick to load the collision checks.
+static
+void bench_entities(u64 entity_count, u64 tick_count, u64 bullet_count)
+{
+  for (u64 i = 0; i < entity_count; i++)
+  {
+    f32 x = (f32) random_i32(0, WIDTH);
+    spawn_zombie(ZombieKind_Walker, v2f(x, GROUND_Y + 40));
+  }
+
+  // Let the spawns activate and settle onto the ground
+  for (u64 tick = 0; tick < 8; tick++)
+  {
+    get_entity_by_sp(SPID_Player)->health = HEADLESS_PLAYER_HEALTH;
+    game.t = tick * (f64) TIME_STEP;
+    update_game();
+  }
+
+  u64 update_ticks = 0;
+  u64 candidate_pairs = 0;
+  for (u64 tick = 0; tick < tick_count; tick++)
+  {
+    get_entity_by_sp(SPID_Player)->health = HEADLESS_PLAYER_HEALTH;
+    game.t = (tick + 8) * (f64) TIME_STEP;
+
+    for (u64 i = 0; i < bullet_count; i++)
+    {
+      Entity *ammo = spawn_ammo(AmmoKind_Bullet, v2f(-20, GROUND_Y + 40));
+      ammo->speed = HEADLESS_BENCH_BULLET_SPEED;
+      ammo->damage = 1;
+    }
+
+    u64 time_start = stm_now();
+    update_game();
+    update_ticks += stm_since(time_start);
+    candidate_pairs += game.collision_grid.candidate_count;
+  }
+
+  f64 ns_per_tick = stm_ns(update_ticks) / (f64) tick_count;
+
+  logger_debug(str("[bench] zombies: %llu, slots: %llu, ticks: %llu, bullets/tick: %llu\n"),
+               entity_count,
+               game.entities.count,
+               tick_count,
+               bullet_count);
+  logger_debug(str("[bench] update: %.3f ms/tick, %.1f ns/entity\n"),
+               ns_per_tick / 1000000.0,
+               ns_per_tick / game.entities.count);
+  logger_debug(str("[bench] candidate pairs: %.1f/tick\n"), candidate_pairs / (f64) tick_count);
+}
+
+// Fills the particle buffer with a mix of emitters and times update_particles alone.
+// The debug burst runs every kernel but gravity and the death burst collides with the
+// ground. Neither expires within the default tick count, so the load stays constant.
+static
+void run_particle_bench(u64 emitter_count, u64 tick_count)
+{
+  ParticleKind kinds[] = {ParticleKind_Debug, ParticleKind_Death};
+  for (u64 i = 0; i < emitter_count; i++)
+  {
+    f32 x = (f32) random_i32(0, WIDTH);
+    f32 y = (f32) random_i32(GROUND_Y, HEIGHT);
+    spawn_particles(kinds[i % arr_len(kinds)], v2f(x, y));
+  }
+
+  u64 update_ticks = 0;
+  u64 particle_count = 0;
+  for (u64 tick = 0; tick < tick_count; tick++)
+  {
+    game.t = tick * (f64) TIME_STEP;
+
+    ParticleBuffer *particles = &game.particle_buffer;
+    for (u32 i = 0; i < particles->span_count; i++)
+    {
+      Entity *owner = entity_from_ref(particles->spans[i].owner);
+      particle_count += particle_group_from_entity(owner)->count;
+    }
+
+    u64 time_start = stm_now();
+    update_particles(TIME_STEP);
+    update_ticks += stm_since(time_start);
+  }
+
+  f64 update_ms = stm_ms(update_ticks);
+
+  logger_debug(str("[particles] emitters: %llu, ticks: %llu, particles/tick: %.0f\n"),
+               emitter_count,
+               tick_count,
+               particle_count / (f64) tick_count);
+  logger_debug(str("[particles] update: %.3f ms/tick, %.0f particles/ms\n"),
+               update_ms / tick_count,
+               update_ms > 0 ? particle_count / update_ms : 0);
+  logger_debug(str("[particles] dropped: %llu\n"), game.particle_buffer.dropped_count);
+}
+
+// Plays the scripted game and renders every tick into the record backend. Reports the
+// draw calls and state changes a frame makes, the CPU time render_game takes to build,
+// sort and submit it and how much of that went to laying out text.
+static
+void run_render_bench(u64 tick_count)
+{
+  r_use_backend(&R_RECORD_BACKEND);
+  global.resources = load_resources(&global.perm_arena, str("res"));
+  global.renderer = r_create_renderer(80000, WIDTH, HEIGHT, &global.perm_arena);
+
+  u64 render_ticks = 0;
+  u64 draw_count = 0;
+  u64 state_count = 0;
+  u64 flush_count = 0;
+  u32 peak_draw_count = 0;
+  u32 peak_ui_draw_count = 0;
+  u64 text_ticks = 0;
+  u64 text_layout_count = 0;
+  u64 text_hit_count = 0;
+  u64 quad_count = 0;
+  u64 culled_count = 0;
+
+  for (u64 tick = 0; tick < tick_count; tick++)
+  {
+    drive_input(tick);
+
+    game.t = tick * (f64) TIME_STEP;
+    update_game();
+    remember_last_keys();
+    global.frame.elapsed_time += TIME_STEP;
+
+    r_clear_recording();
+
+    u64 time_start = stm_now();
+    render_game(1.0f);
+    render_ticks += stm_since(time_start);
+
+    text_ticks += game.text_stats.layout_ticks;
+    text_layout_count += game.text_stats.layout_count;
+    text_hit_count += game.text_stats.hit_count;
+    quad_count += game.drawn_count;
+    culled_count += game.culled_count;
+
+    R_Recording *recording = r_get_recording();
+    u32 frame_draw_count = 0;
+    u32 frame_ui_draw_count = 0;
+    for (u32 i = 0; i < recording->count; i++)
+    {
+      R_Call *call = &recording->calls[i];
+      switch (call->type)
+      {
+      case R_CallType_Draw:
+        frame_draw_count++;
+        frame_ui_draw_count += call->layer == LAYER_UI;
+        break;
+      case R_CallType_BindShader:
+      case R_CallType_BindTexture:
+        state_count++;
+        break;
+      case R_CallType_Flush:
+        flush_count++;
+        break;
+      case R_CallType_Clear:
+        break;
+      }
+    }
+
+    draw_count += frame_draw_count;
+    peak_draw_count = max(peak_draw_count, frame_draw_count);
+    peak_ui_draw_count = max(peak_ui_draw_count, frame_ui_draw_count);
+  }
+
+  f64 render_ms = stm_ms(render_ticks);
+
+  logger_debug(str("[render] frames: %llu, flushes/frame: %.1f\n"),
+               tick_count,
+               flush_count / (f64) tick_count);
+  logger_debug(str("[render] draws/frame: %.1f (peak: %u), ui draws peak: %u\n"),
+               draw_count / (f64) tick_count,
+               peak_draw_count,
+               peak_ui_draw_count);
+  logger_debug(str("[render] state changes/frame: %.1f\n"), state_count / (f64) tick_count);
+  logger_debug(str("[render] quads/frame: %.1f drawn, %.1f culled\n"),
+               quad_count / (f64) tick_count,
+               culled_count / (f64) tick_count);
+  logger_debug(str("[render] render: %.3f ms/frame\n"), render_ms / tick_count);
+  logger_debug(str("[render] text: %.4f ms/frame, laid out: %llu, cache hits: %llu\n"),
+               stm_ms(text_ticks) / tick_count,
+               text_layout_count,
+               text_hit_count);
+}
+
+// Plays the scripted game and renders every tick with the soft backend. With a golden
+// path, the last frame is compared against the PNG there, or written to it if there is
+// none yet. Returns non-zero when the frame doesn't match.
+static
+i32 run_raster(u64 tick_count, String golden_path)
+{
+  r_use_backend(&R_SOFT_BACKEND);
+  global.resources = load_resources(&global.perm_arena, str("res"));
+  global.renderer = r_create_renderer(80000, WIDTH, HEIGHT, &global.perm_arena);
+
+  u64 render_ticks = 0;
+  for (u64 tick = 0; tick < tick_count; tick++)
+  {
+    drive_input(tick);
+
+    game.t = tick * (f64) TIME_STEP;
+    update_game();
+    remember_last_keys();
+    global.frame.elapsed_time += TIME_STEP;
+
+    u64 time_start = stm_now();
+    render_game(1.0f);
+    render_ticks += stm_since(time_start);
+  }
+
+  R_Framebuffer *fb = r_get_framebuffer();
+  f64 render_ms = stm_ms(render_ticks);
+
+  logger_debug(str("[raster] frames: %llu, render: %.3f ms/frame\n"),
+               tick_count,
+               render_ms / tick_count);
+  logger_debug(str("[raster] fill: %.0f pixels/frame, %.1f Mpixels/s\n"),
+               fb->fill_count / (f64) tick_count,
+               render_ms > 0 ? fb->fill_count / render_ms / 1000.0 : 0);
+
+  return compare_golden(fb, golden_path);
+}
+
+// Compares a frame against the PNG at golden_path, or writes it there if there is none
+// yet. Returns non-zero when the frame doesn't match.
+static
+i32 compare_golden(R_Framebuffer *fb, String golden_path)
+{
+  i32 width, height;
+  stbi_set_flip_vertically_on_load(TRUE);
+  u8 *golden = stbi_load(golden_path.data, &width, &height, NULL, 3);
+  if (golden == NULL)
+  {
+    write_png(golden_path, fb);
+    logger_debug(str("[raster] golden written: %s\n"), golden_path.data);
+    return 0;
+  }
+
+  if (width != (i32) fb->width || height != (i32) fb->height)
+  {
+    logger_debug(str("[raster] golden is %ix%i, frame is %ux%u\n"),
+                 width, height,
+                 fb->width, fb->height);
+    stbi_image_free(golden);
+    return 1;
+  }
+
+  u64 mismatch_count = 0;
+  i32 max_diff = 0;
+  for (u32 y = 0; y < fb->height; y++)
+  {
+    for (u32 x = 0; x < fb->width; x++)
+    {
+      u32 pixel = fb->pixels[y * fb->stride + x];
+      u8 *expected = &golden[(y * fb->width + x) * 3];
+
+      i32 diff = 0;
+      for (u32 c = 0; c < 3; c++)
+      {
+        i32 channel = (pixel >> (c * 8)) & 0xFF;
+        diff = max(diff, absv(channel - expected[c]));
+      }
+
+      max_diff = max(max_diff, diff);
+      mismatch_count += diff > HEADLESS_GOLDEN_TOLERANCE;
+    }
+  }
+
+  stbi_image_free(golden);
+
+  logger_debug(str("[raster] golden: %llu pixels differ (max diff: %i)\n"),
+               mismatch_count,
+               max_diff);
+
+  return mismatch_count > 0;
+}
+typedef struct HeadlessSim HeadlessSim;
+struct HeadlessSim
+{
+  u64 tick_count;
+  u32 volatile done;
+  TripleBuffer snapshots;
+  RenderSnapshot slots[3];
+};
+
+// Plays the scripted game on this thread and publishes a snapshot after every tick.
+static
+void headless_sim_thread(void *arg)
+{
+  HeadlessSim *sim = arg;
+  init_scratch_arenas();
+
+  for (u64 tick = 0; tick < sim->tick_count; tick++)
+  {
+    u64 input_time = stm_now();
+    drive_input(tick);
+
+    u64 update_start = stm_now();
+    game.t = tick * (f64) TIME_STEP;
+    update_game();
+    remember_last_keys();
+    global.frame.elapsed_time += TIME_STEP;
+
+    RenderSnapshot *snapshot = &sim->slots[sim->snapshots.write];
+    snapshot_game(snapshot);
+    snapshot->input_time = input_time;
+    snapshot->update_start = update_start;
+    snapshot->publish_time = stm_now();
+    triple_buffer_publish(&sim->snapshots);
+  }
+
+  os_atomic_store_u32(&sim->done, TRUE);
+}
+
+// Runs the simulation on its own thread while this one draws the newest snapshot with
+// the soft backend, skipping any it was too slow to see. The last snapshot is always
+// drawn, so the final frame matches what the raster mode produces.
+static
+i32 run_threaded(u64 tick_count, String golden_path)
+{
+  r_use_backend(&R_SOFT_BACKEND);
+  global.resources = load_resources(&global.perm_arena, str("res"));
+  global.renderer = r_create_renderer(80000, WIDTH, HEIGHT, &global.perm_arena);
+
+  static HeadlessSim sim;
+  sim.tick_count = tick_count;
+  init_triple_buffer(&sim.snapshots);
+  for (u32 i = 0; i < 3; i++)
+  {
+    init_snapshot(&sim.slots[i]);
+  }
+
+  OS_Thread thread;
+  os_start_thread(&thread, headless_sim_thread, &sim);
+
+  u64 frame_count = 0;
+  FrameLatency latency = {0};
+  u64 time_start = stm_now();
+  for (;;)
+  {
+    // NOTE(dg): Done is read first. Every publish happened before it was set, so when
+    // there is nothing new after that, the last snapshot has been drawn.
+    bool done = os_atomic_load_u32(&sim.done);
+    if (triple_buffer_acquire(&sim.snapshots))
+    {
+      RenderFeedback feedback = {0};
+      draw_snapshot(&sim.slots[sim.snapshots.read], 1.0f, &feedback);
+      latency.input += feedback.latency.input;
+      latency.update += feedback.latency.update;
+      latency.queue += feedback.latency.queue;
+      latency.render += feedback.latency.render;
+      frame_count++;
+    }
+    else if (done)
+    {
+      break;
+    }
+  }
+
+  os_join_thread(&thread);
+  f64 total_ms = stm_ms(stm_since(time_start));
+
+  logger_debug(str("[threaded] ticks: %llu, frames: %llu, %.3f ms total\n"),
+               tick_count,
+               frame_count,
+               total_ms);
+  if (frame_count > 0)
+  {
+    logger_debug(str("[threaded] latency: %.3f in, %.3f sim, %.3f queue, %.3f draw ms/frame\n"),
+                 latency.input / 1000000.0 / frame_count,
+                 latency.update / 1000000.0 / frame_count,
+                 latency.queue / 1000000.0 / frame_count,
+                 latency.render / 1000000.0 / frame_count);
+  }
+
+  logger_debug(str("[threaded] wave: %i, killed: %i, state: %i\n"),
+               game.current_wave.num + 1,
+               game.current_wave.zombies_killed,
+               game.state);
+
+  if (golden_path.len == 0) return 0;
+
+  return compare_golden(r_get_framebuffer(), golden_path);
+}
+
+// Plays the scripted game and renders every tick with the soft backend, with each tick
+// closing a profiler frame. The zones still in the ring are written to trace_path as a
+// Chrome trace.
+static
+i32 run_trace(u64 tick_count, String trace_path)
+{
+  if (!PROFILE)
+  {
+    logger_debug(str("[trace] built without PROFILE\n"));
+    return 1;
+  }
+
+  r_use_backend(&R_SOFT_BACKEND);
+  global.resources = load_resources(&global.perm_arena, str("res"));
+  global.renderer = r_create_renderer(80000, WIDTH, HEIGHT, &global.perm_arena);
+
+  for (u64 tick = 0; tick < tick_count; tick++)
+  {
+    prof_frame();
+    drive_input(tick);
+
+    game.t = tick * (f64) TIME_STEP;
+    update_game();
+    remember_last_keys();
+    global.frame.elapsed_time += TIME_STEP;
+
+    render_game(1.0f);
+  }
+
+  if (!profile_write_trace(trace_path))
+  {
+    logger_debug(str("[trace] could not write %s\n"), trace_path.data);
+    return 1;
+  }
+
+  logger_debug(str("[trace] ticks: %llu, written: %s\n"), tick_count, trace_path.data);
+
+  return 0;
+}
+
+// Plays the scripted game and renders every tick with the soft backend, streaming a row
+// of counters per tick to csv_path.
+static
+i32 run_counters(u64 tick_count, String csv_path)
+{
+  r_use_backend(&R_SOFT_BACKEND);
+  global.resources = load_resources(&global.perm_arena, str("res"));
+  global.renderer = r_create_renderer(80000, WIDTH, HEIGHT, &global.perm_arena);
+
+  if (!counters_open_csv(csv_path))
+  {
+    logger_debug(str("[counters] could not write %s\n"), csv_path.data);
+    return 1;
+  }
+
+  for (u64 tick = 0; tick < tick_count; tick++)
+  {
+    drive_input(tick);
+
+    game.t = tick * (f64) TIME_STEP;
+    update_game();
+    remember_last_keys();
+    global.frame.elapsed_time += TIME_STEP;
+
+    render_game(1.0f);
+  }
+
+  counters_close_csv();
+  logger_debug(str("[counters] ticks: %llu, written: %s\n"), tick_count, csv_path.data);
+
+  return 0;
+}
+
+// Fills the screen with particle emitters and renders them with the soft backend. Every
+// particle is a blended rect, so the frame time is dominated by fill.
+static
+void run_fill_bench(u64 emitter_count, u64 tick_count)
+{
+  r_use_backend(&R_SOFT_BACKEND);
+  global.resources = load_resources(&global.perm_arena, str("res"));
+  global.renderer = r_create_renderer(80000, WIDTH, HEIGHT, &global.perm_arena);
+
+  ParticleKind kinds[] = {ParticleKind_Debug, ParticleKind_Death};
+  for (u64 i = 0; i < emitter_count; i++)
+  {
+    f32 x = (f32) random_i32(0, WIDTH);
+    f32 y = (f32) random_i32(GROUND_Y, HEIGHT);
+    spawn_particles(kinds[i % arr_len(kinds)], v2f(x, y));
+  }
+
+  u64 render_ticks = 0;
+  u64 quad_count = 0;
+  for (u64 tick = 0; tick < tick_count; tick++)
+  {
+    game.t = tick * (f64) TIME_STEP;
+    update_particles(TIME_STEP);
+
+    u64 time_start = stm_now();
+    render_game(1.0f);
+    render_ticks += stm_since(time_start);
+    quad_count += game.render_stats.draw_count;
+  }
+
+  R_Framebuffer *fb = r_get_framebuffer();
+  f64 render_ms = stm_ms(render_ticks);
+
+  logger_debug(str("[fill] emitters: %llu, frames: %llu, quads/frame: %.0f\n"),
+               emitter_count,
+               tick_count,
+               quad_count / (f64) tick_count);
+  logger_debug(str("[fill] render: %.3f ms/frame, %.0f pixels/frame, %.1f Mpixels/s\n"),
+               render_ms / tick_count,
+               fb->fill_count / (f64) tick_count,
+               render_ms > 0 ? fb->fill_count / render_ms / 1000.0 : 0);
+}
+
+static
+void png_put_u32(u8 *dst, u32 val)
+{
+  dst[0] = (u8) (val >> 24);
+  dst[1] = (u8) (val >> 16);
+  dst[2] = (u8) (val >> 8);
+  dst[3] = (u8) val;
+}
+
+static
+u32 png_crc(u8 *data, u64 len)
+{
+  static u32 table[256];
+  if (table[1] == 0)
+  {
+    for (u32 i = 0; i < 256; i++)
+    {
+      u32 c = i;
+      for (u32 k = 0; k < 8; k++)
+      {
+        c = (c & 1) ? 0xEDB88320 ^ (c >> 1) : c >> 1;
+      }
+
+      table[i] = c;
+    }
+  }
+
+  u32 crc = 0xFFFFFFFF;
+  for (u64 i = 0; i < len; i++)
+  {
+    crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+  }
+
+  return crc ^ 0xFFFFFFFF;
+}
+
+// Writes the chunk's length, type and CRC around the len bytes already at chunk + 8.
+static
+u8 *png_finish_chunk(u8 *chunk, char *type, u32 len)
+{
+  png_put_u32(chunk, len);
+  for (u32 i = 0; i < 4; i++) chunk[4+i] = (u8) type[i];
+  png_put_u32(chunk + 8 + len, png_crc(chunk + 4, len + 4));
+  return chunk + 12 + len;
+}
+
+// Writes the framebuffer as an RGB PNG, top row first. The image data is stored with
+// no compression, which keeps the writer small.
+static
+void write_png(String path, R_Framebuffer *fb)
+{
+  u32 row_size = 1 + fb->width * 3;
+  u32 raw_size = row_size * fb->height;
+  u32 block_count = (raw_size + 65534) / 65535;
+  u32 idat_size = 2 + block_count * 5 + raw_size + 4;
+
+  Arena scratch = get_scratch_arena(NULL);
+  u8 *png = arena_push(&scratch, u8, 8 + 25 + 12 + idat_size + 12);
+
+  static u8 signature[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+  for (u32 i = 0; i < 8; i++) png[i] = signature[i];
+  u8 *at = png + 8;
+
+  // - Header ---
+  u8 *header = at + 8;
+  png_put_u32(header, fb->width);
+  png_put_u32(header + 4, fb->height);
+  header[8] = 8;  // bit depth
+  header[9] = 2;  // RGB
+  header[10] = 0;
+  header[11] = 0;
+  header[12] = 0;
+  at = png_finish_chunk(at, "IHDR", 13);
+
+  // - Rows, flipped and each with no filter ---
+  u8 *raw = arena_push(&scratch, u8, raw_size);
+  for (u32 y = 0; y < fb->height; y++)
+  {
+    u8 *row = &raw[y * row_size];
+    u32 *src = &fb->pixels[(fb->height - 1 - y) * fb->stride];
+    row[0] = 0;
+    for (u32 x = 0; x < fb->width; x++)
+    {
+      row[1 + x*3 + 0] = (u8) src[x];
+      row[1 + x*3 + 1] = (u8) (src[x] >> 8);
+      row[1 + x*3 + 2] = (u8) (src[x] >> 16);
+    }
+  }
+
+  // - Zlib stream of stored blocks ---
+  u8 *data = at + 8;
+  u8 *out = data;
+  *out++ = 0x78;
+  *out++ = 0x01;
+
+  u32 a = 1;
+  u32 b = 0;
+  for (u32 offset = 0; offset < raw_size; offset += 65535)
+  {
+    u32 len = min(raw_size - offset, 65535);
+    *out++ = offset + len == raw_size;
+    *out++ = (u8) len;
+    *out++ = (u8) (len >> 8);
+    *out++ = (u8) ~len;
+    *out++ = (u8) (~len >> 8);
+
+    for (u32 i = 0; i < len; i++)
+    {
+      u8 val = raw[offset + i];
+      *out++ = val;
+      a = (a + val) % 65521;
+      b = (b + a) % 65521;
+    }
+  }
+
+  png_put_u32(out, (b << 16) | a);
+  at = png_finish_chunk(at, "IDAT", idat_size);
+  at = png_finish_chunk(at, "IEND", 0);
+
+  OS_Handle file = os_open_file(path, OS_FILE_WRITE | OS_FILE_CREATE);
+  os_write_file(file, (String) {(char *) png, (u64) (at - png)});
+  os_close_file(file);
+
+  arena_clear(&scratch);
+}
+
+static
+u64 parse_u64(char *cstr, u64 fallback)
+{
+  u64 result = 0;
+
+  if (cstr == NULL || *cstr == '\0') return fallback;
+
+  for (char *c = cstr; *c != '\0'; c++)
+  {
+    if (*c < '0' || *c > '9') return fallback;
+    result = result * 10 + (*c - '0');
+  }
+
+  return result;
+}
+
+// Scripted player so the combat and collision paths get exercised. The player holds the
+// trigger, leads the nearest zombie and cycles through every weapon.
+static
+void drive_input(u64 tick)
+{
+  Input *input = &global.input;
+  for (i32 i = 0; i < Key_COUNT; i++)
+  {
+    input->keys[i] = FALSE;
+  }
+
+  Entity *player = get_entity_by_sp(SPID_Player);
+  if (!entity_is_valid(player)) return;
+
+  // - Unlock and cycle weapons ---
+  // NOTE(dg): The progression is unlocked on tick 0, so the first weapon goes in on
+  // tick 1 and the player is never unarmed. Each one is held long enough to get through
+  // its reload and keep firing.
+  u64 swap_ticks = (u64) (HEADLESS_WEAPON_SWAP_TIME / TIME_STEP);
+  if (tick == 0)
+  {
+    input->keys[Key_P] = TRUE;
+  }
+  else if (tick == 1 || tick % swap_ticks == 0)
+  {
+    u64 weapon_idx = (tick / swap_ticks) % (WeaponKind_COUNT - 1);
+    input->keys[Key_1 + weapon_idx] = TRUE;
+  }
+
+  // - Lead the nearest zombie ---
+  // NOTE(dg): Positions and velocities are per tick, so the lead is how many ticks a
+  // round takes to cover the distance times how far the zombie moves in one.
+  Entity *gun = get_entity_child_by_spid(player, SPID_Gun);
+  Vec2F gun_pos = pos_from_entity(gun);
+  f32 round_speed = max(gun->speed * TIME_STEP, 1.0f);
+  Vec2F target_pos = add_2f(gun_pos, v2f(100, 0));
+  f32 nearest_dist = 99999.0f;
+
+  EntityGroup *zombies = en_group(type_group(EntityType_Zombie));
+  for (u32 i = 0; i < zombies->count; i++)
+  {
+    Entity *en = &game.entities.data[zombies->slots[i]];
+    if (!en_is_active(en)) continue;
+
+    Vec2F zombie_pos = pos_from_entity(en);
+    f32 dist = distance_2f(gun_pos, zombie_pos);
+    if (dist < nearest_dist)
+    {
+      nearest_dist = dist;
+      target_pos = add_2f(zombie_pos, scale_2f(en_vel(en), dist / round_speed));
+    }
+  }
+
+  // - Keep the trigger held ---
+  input->mouse_pos = v2f(target_pos.x, HEIGHT - target_pos.y);
+  input->keys[Key_Mouse1] = TRUE;
+
+  // - Patrol across the screen so zombies never pin the player ---
+  Vec2F player_pos = pos_from_entity(player);
+  static bool going_left = FALSE;
+  if (player_pos.x < HEADLESS_PATROL_MARGIN) going_left = FALSE;
+  if (player_pos.x > WIDTH - HEADLESS_PATROL_MARGIN) going_left = TRUE;
+  input->keys[going_left ? Key_A : Key_D] = TRUE;
+
+  // - Reload when empty ---
+  if (game.weapon.ammo_loaded[game.weapon.kind] == 0)
+  {
+    input->keys[Key_R] = !global.input.keys_last[Key_R];
+  }
+
+  // - Keep the player alive and stocked for soak runs ---
+  player->health = HEADLESS_PLAYER_HEALTH;
+  game.weapon.ammo_reserved = 999;
+}
+
+// Times draw_sprite_x alone, on both the instanced and the quad path, over every prefab
+// sprite. Commands go to the record backend and are flushed outside the timed loop. The
+// two paths take turns for sample_count samples of tick_count frames each, so drift on
+// the machine lands on both, and the spread of the samples is reported with the mean.
+static
+void run_sprite_bench(u64 sprite_count, u64 tick_count, u64 sample_count)
+{
+  r_use_backend(&R_RECORD_BACKEND);
+  global.resources = load_resources(&global.perm_arena, str("res"));
+  global.renderer = r_create_renderer(80000, WIDTH, HEIGHT, &global.perm_arena);
+
+  R_Renderer *renderer = &global.renderer;
+  sprite_count = min(sprite_count, R_MAX_COMMANDS - 1);
+
+  Sprite *sprites = (Sprite *) &prefab.sprite;
+  u32 sprite_kind_count = sizeof (prefab.sprite) / sizeof (Sprite);
+
+  Mat3x3F *xforms = arena_push(&global.perm_arena, Mat3x3F, sprite_count);
+  for (u64 i = 0; i < sprite_count; i++)
+  {
+    xforms[i] = mul_3x3f(translate_3x3f((f32) random_i32(0, WIDTH), 
+                                        (f32) random_i32(0, HEIGHT)), 
+                         rotate_3x3f((f32) random_i32(0, 360) * RADIANS));
+  }
+
+  // Sprites/ms of each sample, per path
+  f64 rate_sum[2] = {0};
+  f64 rate_min[2] = {0};
+  f64 rate_max[2] = {0};
+
+  for (u64 sample = 0; sample < sample_count; sample++)
+  {
+    for (u32 instancing = 0; instancing < 2; instancing++)
+    {
+      renderer->instancing = instancing;
+      r_use_layer(renderer, LAYER_SPRITE);
+
+      u64 draw_ticks = 0;
+      for (u64 tick = 0; tick < tick_count; tick++)
+      {
+        u64 time_start = stm_now();
+        for (u64 i = 0; i < sprite_count; i++)
+        {
+          draw_sprite_x(xforms[i], 
+                        v2f(16 * SPRITE_SCALE, 16 * SPRITE_SCALE), 
+                        v4f(1, 1, 1, 1), 
+                        sprites[i % sprite_kind_count], 
+                        i & 1);
+        }
+        draw_ticks += stm_since(time_start);
+
+        r_flush(renderer);
+        r_clear_recording();
+      }
+
+      f64 rate = (sprite_count * tick_count) / stm_ms(draw_ticks);
+      rate_sum[instancing] += rate;
+      rate_min[instancing] = sample > 0 ? min(rate_min[instancing], rate) : rate;
+      rate_max[instancing] = max(rate_max[instancing], rate);
+    }
+  }
+
+  for (u32 instancing = 0; instancing < 2; instancing++)
+  {
+    f64 rate_mean = rate_sum[instancing] / sample_count;
+    logger_debug(str("[sprites] %s: %.0f sprites/ms, samples %.0f-%.0f (+/-%.1f%%) "
+                     "(%llu sprites x %llu frames x %llu samples)\n"),
+                 instancing ? "instanced" : "quads",
+                 rate_mean,
+                 rate_min[instancing],
+                 rate_max[instancing],
+                 (rate_max[instancing] - rate_min[instancing]) / 2.0 / rate_mean * 100.0,
+                 sprite_count,
+                 tick_count,
+                 sample_count);
+  }
+}
@@ -41,9 +41,10 @@ void remember_last_keys(void)
   }
 }
 
-void handle_input_event(const struct sapp_event *event)
+// NOTE(dg): Events land in whichever Input the caller owns. The simulation thread keeps
+// its own, so the main thread fills a copy it hands over once per frame.
+void handle_input_event(const struct sapp_event *event, Input *input)
 {
-  Input *input = &global.input;
   input->mouse_pos = v2f(event->mouse_x, event->mouse_y);
 
   switch (event->type)
@@ -46,4 +46,4 @@ bool is_key_just_pressed(KeyKind key);
 bool is_key_released(KeyKind key);
 Vec2F get_mouse_pos(void);
 void remember_last_keys(void);
-void handle_input_event(const sapp_event *event);
+void handle_input_event(const sapp_event *event, Input *input);
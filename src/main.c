@@ -17,9 +17,13 @@
 #include "base/base_string.c"
 #include "base/base_random.c"
 #include "base/base_logger.c"
+#include "base/base_job.c"
 #include "render/render.c"
+#include "render/render_gl.c"
 #include "vecmath/vecmath.c"
 #include "ui/ui.c"
+#include "profile.c"
+#include "counters.c"
 #include "physics/physics.c"
 #include "prefabs.c"
 #include "draw.c"
@@ -48,9 +52,55 @@ Globals global;
 Prefabs prefab;
 Game game;
 
+// NOTE(dg): Build with -DSIM_THREAD to run the simulation on a thread of its own. GL is
+// bound to the main thread, so that is where snapshots get drawn. Input is handed to the
+// simulation, and snapshots and draw stats are handed back, each through a triple buffer.
+#ifdef SIM_THREAD
+  #define SIM_THREADED TRUE
+#else
+  #define SIM_THREADED FALSE
+#endif
+
+typedef struct SimInput SimInput;
+struct SimInput
+{
+  Input input;
+  Vec2F window;
+  Vec4F viewport;
+  u64 time;
+};
+
+typedef struct SimThread SimThread;
+struct SimThread
+{
+  OS_Thread thread;
+  u32 volatile stop;
+  u32 volatile quit;
+
+  TripleBuffer inputs;
+  TripleBuffer snapshots;
+  TripleBuffer feedbacks;
+  SimInput input_slots[3];
+  RenderSnapshot snapshot_slots[3];
+  RenderFeedback feedback_slots[3];
+
+  // - Main thread ---
+  Input input;
+  Vec2F window;
+  Vec4F viewport;
+  bool fullscreen_held;
+};
+
+static SimThread sim;
+
 void init(void);
 void event(const sapp_event *);
 void frame(void);
+void cleanup(void);
+void update_viewport(Vec2F *window, Vec4F *viewport);
+void start_sim_thread(void);
+void sim_thread_main(void *arg);
+void frame_sim_thread(void);
 
 #if defined(_WIN32) && !defined(DEBUG)
 i32 WINAPI WinMain(HINSTANCE _a, HINSTANCE _b, LPSTR _c, i32 _d)
@@ -69,6 +119,7 @@ i32 main(void)
     .init_cb = init,
     .event_cb = event,
     .frame_cb = frame,
+    .cleanup_cb = cleanup,
     #ifdef DEBUG
     .logger = {
       .func = slog_func
@@ -92,6 +143,7 @@ void init(void)
   stm_setup();
   srand((u32) stm_now());
   get_scratch_arena(NULL);
+  job_init(os_get_processor_count() - 1);
 
 #if defined(PLATFORM_LINUX) || defined(PLATFORM_WINDOWS)
   gladLoadGL();
@@ -110,53 +162,47 @@ void init(void)
 
   global.frame.current_time = stm_sec(stm_since(0));
   global.frame.accumulator = TIME_STEP;
+  global.frame.max_accumulator = MAX_FRAME_TIME;
+  global.frame.max_steps = MAX_FRAME_STEPS;
 
   global.resources = load_resources(&global.perm_arena, res_path);
-  global.renderer = r_create_renderer(40000, WIDTH, HEIGHT, &global.perm_arena);
+  global.renderer = r_create_renderer(80000, WIDTH, HEIGHT, &global.perm_arena);
 
   init_prefabs();
 
   game.dt = TIME_STEP;
   init_game();
+
+  if (SIM_THREADED)
+  {
+    start_sim_thread();
+  }
 }
 
 void event(const sapp_event *event)
 {
-  handle_input_event(event);
+  handle_input_event(event, SIM_THREADED ? &sim.input : &global.input);
 }
 
 void frame(void)
 {
-  // Update viewport ----------------
-  if (global.window.width != sapp_width() || global.window.height != sapp_height())
-  {
-    Vec4F viewport;
-    f32 ratio = sapp_widthf() / sapp_heightf();
-    if (ratio >= WIDTH / HEIGHT)
-    {
-      f32 img_width = sapp_width() / (ratio / (WIDTH / HEIGHT));
-      viewport = v4f((sapp_width() - img_width) / 2.0f, 0.0f, img_width, sapp_height());
-    }
-    else
-    {
-      f32 img_height = sapp_height() * (ratio / (WIDTH / HEIGHT));
-      viewport = v4f(0.0f, (sapp_height() - img_height) / 2.0f, sapp_width(), img_height);
-    }
+  prof_frame();
 
-    r_set_viewport(viewport.x, viewport.y, viewport.z, viewport.w);
-    global.viewport = viewport;
+  if (SIM_THREADED)
+  {
+    frame_sim_thread();
+    return;
   }
-  
-  global.window.width = sapp_width();
-  global.window.height = sapp_height();
+
+  update_viewport(&global.window, &global.viewport);
   
   f64 new_time = stm_sec(stm_since(0));
   f64 frame_time = new_time - global.frame.current_time;
   global.frame.current_time = new_time;
-  global.frame.accumulator += frame_time;
+  u32 step_count = advance_frame(frame_time);
 
   // Simulation loop ----------------
-  while (global.frame.accumulator >= TIME_STEP)
+  for (u32 step = 0; step < step_count; step++)
   {
     if (is_key_released(Key_Enter))
     {
@@ -181,7 +227,7 @@ void frame(void)
   }
 
   u64 time_start = stm_ns(stm_since(0));
-  render_game();
+  render_game(clamp(global.frame.accumulator / TIME_STEP, 0.0f, 1.0f));
   u64 time_end = stm_ns(stm_since(0));
 
   String duration_str = format_duration(time_end - time_start, &game.frame_arena);
@@ -195,3 +241,168 @@ void frame(void)
     sapp_quit();
   }
 }
+
+void cleanup(void)
+{
+  if (SIM_THREADED)
+  {
+    os_atomic_store_u32(&sim.stop, TRUE);
+    os_join_thread(&sim.thread);
+  }
+
+  job_shutdown();
+  counters_close_csv();
+}
+
+void update_viewport(Vec2F *window, Vec4F *viewport)
+{
+  if (window->width != sapp_width() || window->height != sapp_height())
+  {
+    f32 ratio = sapp_widthf() / sapp_heightf();
+    if (ratio >= WIDTH / HEIGHT)
+    {
+      f32 img_width = sapp_width() / (ratio / (WIDTH / HEIGHT));
+      *viewport = v4f((sapp_width() - img_width) / 2.0f, 0.0f, img_width, sapp_height());
+    }
+    else
+    {
+      f32 img_height = sapp_height() * (ratio / (WIDTH / HEIGHT));
+      *viewport = v4f(0.0f, (sapp_height() - img_height) / 2.0f, sapp_width(), img_height);
+    }
+
+    r_set_viewport(viewport->x, viewport->y, viewport->z, viewport->w);
+  }
+  
+  window->width = sapp_width();
+  window->height = sapp_height();
+}
+
+// @SimThread ////////////////////////////////////////////////////////////////////////////
+
+void start_sim_thread(void)
+{
+  init_triple_buffer(&sim.inputs);
+  init_triple_buffer(&sim.snapshots);
+  init_triple_buffer(&sim.feedbacks);
+
+  for (u32 i = 0; i < 3; i++)
+  {
+    init_snapshot(&sim.snapshot_slots[i]);
+  }
+
+  sim.window = global.window;
+  sim.viewport = global.viewport;
+
+  os_start_thread(&sim.thread, sim_thread_main, NULL);
+}
+
+// NOTE(dg): From here on the simulation thread owns the game and the globals it touches.
+// The main thread only reads the snapshots it is handed and writes to the renderer.
+void sim_thread_main(void *arg)
+{
+  init_scratch_arenas();
+
+  global.frame.current_time = stm_sec(stm_now());
+  global.frame.accumulator = TIME_STEP;
+  u64 input_time = stm_now();
+
+  while (!os_atomic_load_u32(&sim.stop))
+  {
+    f64 new_time = stm_sec(stm_now());
+    u32 step_count = advance_frame(new_time - global.frame.current_time);
+    global.frame.current_time = new_time;
+
+    if (step_count == 0)
+    {
+      os_sleep_ms(1);
+      continue;
+    }
+
+    prof_frame();
+
+    u64 update_start = 0;
+    for (u32 step = 0; step < step_count; step++)
+    {
+      // - Latch input ---
+      if (triple_buffer_acquire(&sim.inputs))
+      {
+        SimInput *posted = &sim.input_slots[sim.inputs.read];
+        for (i32 i = 0; i < Key_COUNT; i++)
+        {
+          global.input.keys[i] = posted->input.keys[i];
+        }
+
+        global.input.mouse_pos = posted->input.mouse_pos;
+        global.window = posted->window;
+        global.viewport = posted->viewport;
+        input_time = posted->time;
+      }
+
+      if (triple_buffer_acquire(&sim.feedbacks))
+      {
+        apply_feedback(&sim.feedback_slots[sim.feedbacks.read]);
+        game.render_time = game.latency.render;
+      }
+
+      update_start = stm_now();
+      game.t = stm_sec(update_start);
+      update_game();
+      game.update_time = stm_ns(stm_since(update_start));
+
+      remember_last_keys();
+
+      global.frame.elapsed_time += TIME_STEP;
+      global.frame.accumulator -= TIME_STEP;
+    }
+
+    // - Publish snapshot ---
+    RenderSnapshot *snapshot = &sim.snapshot_slots[sim.snapshots.write];
+    snapshot_game(snapshot);
+    snapshot->input_time = input_time;
+    snapshot->update_start = update_start;
+    snapshot->publish_time = stm_now();
+    triple_buffer_publish(&sim.snapshots);
+
+    if (game_should_quit())
+    {
+      os_atomic_store_u32(&sim.quit, TRUE);
+      break;
+    }
+  }
+}
+
+void frame_sim_thread(void)
+{
+  update_viewport(&sim.window, &sim.viewport);
+
+  // - Hand over input ---
+  SimInput *posted = &sim.input_slots[sim.inputs.write];
+  posted->input = sim.input;
+  posted->window = sim.window;
+  posted->viewport = sim.viewport;
+  posted->time = stm_now();
+  triple_buffer_publish(&sim.inputs);
+
+  bool fullscreen_held = sim.input.keys[Key_Enter];
+  if (sim.fullscreen_held && !fullscreen_held)
+  {
+    sapp_toggle_fullscreen();
+  }
+
+  sim.fullscreen_held = fullscreen_held;
+
+  // - Draw latest snapshot ---
+  // NOTE(dg): With nothing new, the last snapshot is drawn again so the frame still
+  // gets presented. The blend follows how long ago it was published, which stands in
+  // for the accumulator the simulation thread keeps to itself.
+  triple_buffer_acquire(&sim.snapshots);
+  RenderSnapshot *snapshot = &sim.snapshot_slots[sim.snapshots.read];
+  f32 alpha = min(stm_sec(stm_since(snapshot->publish_time)) / TIME_STEP, 1.0f);
+  draw_snapshot(snapshot, alpha, &sim.feedback_slots[sim.feedbacks.write]);
+  triple_buffer_publish(&sim.feedbacks);
+
+  if (os_atomic_load_u32(&sim.quit))
+  {
+    sapp_quit();
+  }
+}
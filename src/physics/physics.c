@@ -78,3 +78,189 @@ bool p_rect_rect_intersect(P_CollisionParams a, P_CollisionParams b)
 
   return x_range && y_range;
 }
+
+// @Grid /////////////////////////////////////////////////////////////////////////////////
+
+static
+void p_bounds_from_params(P_CollisionParams params, Vec2F *bl, Vec2F *tr)
+{
+  if (params.type == P_ColliderType_Circle)
+  {
+    *bl = v2f(params.pos.x - params.radius, params.pos.y - params.radius);
+    *tr = v2f(params.pos.x + params.radius, params.pos.y + params.radius);
+  }
+  else
+  {
+    *bl = params.pos;
+    *tr = add_2f(params.pos, params.dim);
+  }
+
+  // Narrow phase tests at pos + vel, so cover the whole step
+  bl->x += min(params.vel.x, 0.0f);
+  bl->y += min(params.vel.y, 0.0f);
+  tr->x += max(params.vel.x, 0.0f);
+  tr->y += max(params.vel.y, 0.0f);
+}
+
+// NOTE(dg): Truncating toward zero is fine here since anything below the origin gets
+// clamped into cell 0 regardless.
+static inline
+i32 p_grid_cell_x(P_Grid *grid, f32 x)
+{
+  i32 result = (i32) ((x - grid->origin.x) / grid->cell_size);
+  return clamp(result, 0, grid->cols - 1);
+}
+
+static inline
+i32 p_grid_cell_y(P_Grid *grid, f32 y)
+{
+  i32 result = (i32) ((y - grid->origin.y) / grid->cell_size);
+  return clamp(result, 0, grid->rows - 1);
+}
+
+void p_grid_begin(P_Grid *grid, Vec2F origin, Vec2F size, f32 cell_size, u32 entry_cap, Arena *arena)
+{
+  grid->origin = origin;
+  grid->cell_size = cell_size;
+  grid->cols = max((i32) (size.width / cell_size) + 1, 1);
+  grid->rows = max((i32) (size.height / cell_size) + 1, 1);
+  grid->entry_count = 0;
+  grid->candidate_count = 0;
+
+  if (entry_cap > grid->entry_cap)
+  {
+    grid->entry_cap = max(entry_cap, grid->entry_cap * 2);
+    grid->entries = arena_push(arena, P_GridEntry, grid->entry_cap);
+    grid->query = arena_push(arena, u32, grid->entry_cap);
+  }
+
+  u32 cell_count = grid->cols * grid->rows;
+  if (cell_count > grid->cell_cap)
+  {
+    grid->cell_cap = cell_count;
+    grid->cell_start = arena_push(arena, u32, cell_count + 1);
+    grid->cell_cursor = arena_push(arena, u32, cell_count);
+  }
+}
+
+void p_grid_push(P_Grid *grid, P_CollisionParams params, u32 id, u32 mask)
+{
+  assert(grid->entry_count < grid->entry_cap);
+
+  P_GridEntry *entry = &grid->entries[grid->entry_count++];
+  entry->params = params;
+  entry->id = id;
+  entry->mask = mask;
+  entry->stamp = 0;
+  p_bounds_from_params(params, &entry->bl, &entry->tr);
+}
+
+void p_grid_build(P_Grid *grid, Arena *arena)
+{
+  u32 cell_count = grid->cols * grid->rows;
+  for (u32 i = 0; i <= cell_count; i++)
+  {
+    grid->cell_start[i] = 0;
+  }
+
+  // - Count entries per cell ---
+  for (u32 i = 0; i < grid->entry_count; i++)
+  {
+    P_GridEntry *entry = &grid->entries[i];
+    i32 x0 = p_grid_cell_x(grid, entry->bl.x);
+    i32 x1 = p_grid_cell_x(grid, entry->tr.x);
+    i32 y0 = p_grid_cell_y(grid, entry->bl.y);
+    i32 y1 = p_grid_cell_y(grid, entry->tr.y);
+
+    for (i32 y = y0; y <= y1; y++)
+    {
+      for (i32 x = x0; x <= x1; x++)
+      {
+        grid->cell_start[y * grid->cols + x + 1] += 1;
+      }
+    }
+  }
+
+  // - Prefix sum into cell offsets ---
+  for (u32 i = 0; i < cell_count; i++)
+  {
+    grid->cell_start[i + 1] += grid->cell_start[i];
+  }
+
+  // - Scatter entries into their cells ---
+  u32 cell_entry_count = grid->cell_start[cell_count];
+  if (cell_entry_count > grid->cell_entry_cap)
+  {
+    grid->cell_entry_cap = max(cell_entry_count, grid->cell_entry_cap * 2);
+    grid->cell_entries = arena_push(arena, u32, grid->cell_entry_cap);
+  }
+
+  u32 *cursor = grid->cell_cursor;
+  for (u32 i = 0; i < cell_count; i++)
+  {
+    cursor[i] = grid->cell_start[i];
+  }
+
+  for (u32 i = 0; i < grid->entry_count; i++)
+  {
+    P_GridEntry *entry = &grid->entries[i];
+    i32 x0 = p_grid_cell_x(grid, entry->bl.x);
+    i32 x1 = p_grid_cell_x(grid, entry->tr.x);
+    i32 y0 = p_grid_cell_y(grid, entry->bl.y);
+    i32 y1 = p_grid_cell_y(grid, entry->tr.y);
+
+    for (i32 y = y0; y <= y1; y++)
+    {
+      for (i32 x = x0; x <= x1; x++)
+      {
+        grid->cell_entries[cursor[y * grid->cols + x]++] = i;
+      }
+    }
+  }
+}
+
+// Returns indices into grid->entries whose mask overlaps the given one and whose bounds
+// overlap the params' bounds. Each entry is returned at most once per query. The result
+// lives in the grid and is only valid until the next query.
+P_GridQuery p_grid_query(P_Grid *grid, P_CollisionParams params, u32 mask)
+{
+  P_GridQuery result = {0};
+  if (grid->entry_count == 0) return result;
+
+  Vec2F bl, tr;
+  p_bounds_from_params(params, &bl, &tr);
+
+  i32 x0 = p_grid_cell_x(grid, bl.x);
+  i32 x1 = p_grid_cell_x(grid, tr.x);
+  i32 y0 = p_grid_cell_y(grid, bl.y);
+  i32 y1 = p_grid_cell_y(grid, tr.y);
+
+  result.data = grid->query;
+  grid->stamp += 1;
+  if (grid->stamp == 0) grid->stamp = 1;
+
+  for (i32 y = y0; y <= y1; y++)
+  {
+    for (i32 x = x0; x <= x1; x++)
+    {
+      u32 cell = y * grid->cols + x;
+      for (u32 i = grid->cell_start[cell]; i < grid->cell_start[cell + 1]; i++)
+      {
+        u32 entry_idx = grid->cell_entries[i];
+        P_GridEntry *entry = &grid->entries[entry_idx];
+        if (entry->stamp == grid->stamp || !(entry->mask & mask)) continue;
+
+        entry->stamp = grid->stamp;
+
+        if (entry->tr.x < bl.x || entry->bl.x > tr.x ||
+            entry->tr.y < bl.y || entry->bl.y > tr.y) continue;
+
+        result.data[result.count++] = entry_idx;
+      }
+    }
+  }
+
+  grid->candidate_count += result.count;
+
+  return result;
+}
@@ -23,3 +23,57 @@ bool p_rect_x_range_intersect(P_CollisionParams a, Vec2F range, f32 x);
 bool p_rect_y_range_intersect(P_CollisionParams a, Vec2F range, f32 y);
 bool p_rect_rect_intersect(P_CollisionParams a, P_CollisionParams b);
 bool p_rect_circle_intersect(P_CollisionParams a, P_CollisionParams b);
+
+// @Grid /////////////////////////////////////////////////////////////////////////////////
+
+// Uniform grid broad phase. Colliders are pushed once per tick, bucketed into cells with
+// a counting sort, then queried by bounds to find the candidates worth a narrow-phase
+// test. Anything outside the grid is clamped into the border cells. Buffers are kept
+// between ticks and only grow, so a steady state rebuild does no allocation.
+
+typedef struct P_GridEntry P_GridEntry;
+struct P_GridEntry
+{
+  P_CollisionParams params;
+  Vec2F bl;
+  Vec2F tr;
+  u32 id;
+  u32 mask;
+  u32 stamp;
+};
+
+typedef struct P_GridQuery P_GridQuery;
+struct P_GridQuery
+{
+  u32 *data;
+  u32 count;
+};
+
+typedef struct P_Grid P_Grid;
+struct P_Grid
+{
+  Vec2F origin;
+  f32 cell_size;
+  i32 cols;
+  i32 rows;
+  u32 stamp;
+  u64 candidate_count;
+
+  P_GridEntry *entries;
+  u32 entry_count;
+  u32 entry_cap;
+
+  u32 *cell_start;
+  u32 *cell_cursor;
+  u32 cell_cap;
+
+  u32 *cell_entries;
+  u32 cell_entry_cap;
+
+  u32 *query;
+};
+
+void p_grid_begin(P_Grid *grid, Vec2F origin, Vec2F size, f32 cell_size, u32 entry_cap, Arena *arena);
+void p_grid_push(P_Grid *grid, P_CollisionParams params, u32 id, u32 mask);
+void p_grid_build(P_Grid *grid, Arena *arena);
+P_GridQuery p_grid_query(P_Grid *grid, P_CollisionParams params, u32 mask);
@@ -69,6 +69,8 @@ void init_prefabs(void)
     prefab.sprite.ui_slot_coin_ammo     = (Sprite) {v2i(1, 10), v2i(1, 1)};
     prefab.sprite.ui_slot_soul_empty    = (Sprite) {v2i(2, 10), v2i(1, 1)};
     prefab.sprite.ui_slot_soul_heal     = (Sprite) {v2i(3, 10), v2i(1, 1)};
+
+    bake_sprites((Sprite *) &prefab.sprite, sizeof (prefab.sprite) / sizeof (Sprite));
   }
 
   // - :animations ---
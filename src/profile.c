@@ -0,0 +1,185 @@
+#include "sokol/sokol_time.h"
+#include "stb/stb_sprintf.h"
+
+#include "base/base.h"
+#include "vecmath/vecmath.h"
+#include "ui/ui.h"
+#include "profile.h"
+
+#if PROFILE
+
+static ProfileThread _profile_threads[PROFILE_MAX_THREADS];
+static u32 volatile _profile_thread_count;
+thread_local ProfileThread *_profile_thread;
+
+// Gives the calling thread its ring the first time it opens a zone. Threads past
+// PROFILE_MAX_THREADS get none and their zones are not recorded.
+static
+ProfileThread *get_profile_thread(void)
+{
+  if (_profile_thread == NULL)
+  {
+    u32 id = os_atomic_add_u32(&_profile_thread_count, 1);
+    if (id >= PROFILE_MAX_THREADS) return NULL;
+
+    ProfileThread *thread = &_profile_threads[id];
+    thread->id = id;
+    thread->arena = create_arena(MiB(1), FALSE);
+    thread->events = arena_push(&thread->arena, ProfileEvent, PROFILE_EVENT_COUNT);
+    thread->frame_start = stm_now();
+    _profile_thread = thread;
+  }
+
+  return _profile_thread;
+}
+
+void profile_begin(char const *name)
+{
+  ProfileThread *thread = get_profile_thread();
+  if (thread == NULL) return;
+
+  assert(thread->depth < PROFILE_MAX_DEPTH);
+  thread->open_names[thread->depth] = name;
+  thread->open_starts[thread->depth] = stm_now();
+  thread->depth += 1;
+}
+
+void profile_end(void)
+{
+  ProfileThread *thread = _profile_thread;
+  if (thread == NULL) return;
+
+  assert(thread->depth > 0);
+  thread->depth -= 1;
+
+  thread->events[thread->event_count % PROFILE_EVENT_COUNT] = (ProfileEvent) {
+    .name = thread->open_names[thread->depth],
+    .start = thread->open_starts[thread->depth],
+    .end = stm_now(),
+    .depth = thread->depth,
+  };
+
+  thread->event_count += 1;
+}
+
+// Closes the calling thread's frame, so the overlay has a whole one to show.
+void profile_mark_frame(void)
+{
+  ProfileThread *thread = get_profile_thread();
+  if (thread == NULL) return;
+
+  u64 now = stm_now();
+  thread->last_frame_first = thread->frame_first;
+  thread->last_frame_end = thread->event_count;
+  thread->last_frame_start = thread->frame_start;
+  thread->last_frame_end_time = now;
+  thread->frame_first = thread->event_count;
+  thread->frame_start = now;
+}
+
+// Draws the calling thread's last frame as a flame chart, one row per depth with the
+// outermost zones on top. The frame spans the whole width.
+void profile_draw_overlay(Vec2F pos, Vec2F dim)
+{
+  ProfileThread *thread = get_profile_thread();
+  if (thread == NULL || thread->last_frame_end_time == thread->last_frame_start) return;
+
+  Vec4F palette[] = {
+    v4f(0.90f, 0.45f, 0.30f, 0.85f),
+    v4f(0.95f, 0.70f, 0.30f, 0.85f),
+    v4f(0.55f, 0.75f, 0.35f, 0.85f),
+    v4f(0.35f, 0.65f, 0.80f, 0.85f),
+    v4f(0.65f, 0.50f, 0.85f, 0.85f),
+    v4f(0.85f, 0.45f, 0.65f, 0.85f),
+  };
+
+  f32 row_height = 12.0f;
+  f64 frame_ticks = (f64) (thread->last_frame_end_time - thread->last_frame_start);
+  ui_rect(v2f(pos.x, pos.y - dim.y), dim, v4f(0, 0, 0, 0.5f));
+  ui_text(str("frame: %.3f ms"), v2f(pos.x, pos.y + 15), 10, 999, stm_ms((u64) frame_ticks));
+
+  u64 first = thread->last_frame_first;
+  if (thread->event_count - first > PROFILE_EVENT_COUNT)
+  {
+    first = thread->event_count - PROFILE_EVENT_COUNT;
+  }
+
+  for (u64 i = first; i < thread->last_frame_end; i++)
+  {
+    ProfileEvent *event = &thread->events[i % PROFILE_EVENT_COUNT];
+    f32 y = pos.y - (event->depth + 1) * row_height;
+    if (y < pos.y - dim.y) continue;
+
+    f32 x0 = (f32) ((event->start - thread->last_frame_start) / frame_ticks) * dim.width;
+    f32 x1 = (f32) ((event->end - thread->last_frame_start) / frame_ticks) * dim.width;
+    x0 = clamp(x0, 0.0f, dim.width);
+    x1 = clamp(x1, 0.0f, dim.width);
+    if (x1 - x0 < 1.0f) continue;
+
+    u64 color_idx = ((u64) event->name >> 3) % arr_len(palette);
+    ui_rect(v2f(pos.x + x0, y), v2f(x1 - x0 - 1.0f, row_height - 1.0f), palette[color_idx]);
+
+    if (x1 - x0 > 60.0f)
+    {
+      ui_text(str("%s"), v2f(pos.x + x0 + 2.0f, y + 1.0f), 10, 999, event->name);
+    }
+  }
+}
+
+// Writes every recorded zone as Chrome trace_event JSON, for chrome://tracing or
+// Perfetto. Returns false if the file couldn't be opened.
+// NOTE(dg): This reads every thread's ring, so the threads have to be done or joined.
+bool profile_write_trace(String path)
+{
+  OS_Handle file = os_open_file(path, OS_FILE_WRITE | OS_FILE_CREATE);
+  if (!os_is_handle_valid(file)) return FALSE;
+
+  Arena scratch = get_scratch_arena(NULL);
+  u32 thread_count = min(os_atomic_load_u32(&_profile_thread_count), PROFILE_MAX_THREADS);
+
+  u64 event_count = 0;
+  for (u32 i = 0; i < thread_count; i++)
+  {
+    event_count += min(_profile_threads[i].event_count, PROFILE_EVENT_COUNT);
+  }
+
+  u64 line_size = 160;
+  char *buf = arena_push(&scratch, char, (event_count + 2) * line_size);
+  u64 len = stbsp_sprintf(buf, "{\"traceEvents\":[\n");
+
+  bool first_event = TRUE;
+  for (u32 i = 0; i < thread_count; i++)
+  {
+    ProfileThread *thread = &_profile_threads[i];
+    u64 first = thread->event_count - min(thread->event_count, PROFILE_EVENT_COUNT);
+    for (u64 j = first; j < thread->event_count; j++)
+    {
+      ProfileEvent *event = &thread->events[j % PROFILE_EVENT_COUNT];
+      len += stbsp_snprintf(buf + len, line_size,
+                            "%s{\"name\":\"%s\",\"ph\":\"X\",\"pid\":0,\"tid\":%u,"
+                            "\"ts\":%.3f,\"dur\":%.3f}\n",
+                            first_event ? "" : ",",
+                            event->name,
+                            thread->id,
+                            stm_us(event->start),
+                            stm_us(event->end - event->start));
+      first_event = FALSE;
+    }
+  }
+
+  len += stbsp_sprintf(buf + len, "]}\n");
+  os_write_file(file, (String) {buf, len});
+  os_close_file(file);
+
+  return TRUE;
+}
+
+#else
+
+void profile_begin(char const *name) {}
+void profile_end(void) {}
+void profile_mark_frame(void) {}
+void profile_draw_overlay(Vec2F pos, Vec2F dim) {}
+bool profile_write_trace(String path) { return FALSE; }
+
+#endif
@@ -0,0 +1,67 @@
+#pragma once
+
+#include "base/base.h"
+
+// NOTE(dg): Zones are compiled in when PROFILE is 1, which debug builds default to.
+// Otherwise the macros expand to nothing, so a release build pays for none of it.
+#ifndef PROFILE
+  #ifdef DEBUG
+    #define PROFILE 1
+  #else
+    #define PROFILE 0
+  #endif
+#endif
+
+#define PROFILE_EVENT_COUNT 16384
+#define PROFILE_MAX_DEPTH 32
+#define PROFILE_MAX_THREADS 16
+
+#if PROFILE
+  #define prof_begin(name) profile_begin(name)
+  #define prof_end() profile_end()
+  #define prof_frame() profile_mark_frame()
+#else
+  #define prof_begin(name)
+  #define prof_end()
+  #define prof_frame()
+#endif
+
+// A closed zone. Times are stm ticks and depth is how many zones it sits inside of.
+typedef struct ProfileEvent ProfileEvent;
+struct ProfileEvent
+{
+  char const *name;
+  u64 start;
+  u64 end;
+  u32 depth;
+};
+
+// NOTE(dg): Every thread records into a ring of its own, so zones never contend. A ring
+// is only read by its own thread while that thread runs. Anyone may read it once the
+// thread has been joined.
+typedef struct ProfileThread ProfileThread;
+struct ProfileThread
+{
+  u32 id;
+  Arena arena;
+  ProfileEvent *events;
+  u64 event_count;
+
+  char const *open_names[PROFILE_MAX_DEPTH];
+  u64 open_starts[PROFILE_MAX_DEPTH];
+  u32 depth;
+
+  // Events are indexed by event_count, so these stay valid as the ring wraps
+  u64 frame_first;
+  u64 frame_start;
+  u64 last_frame_first;
+  u64 last_frame_end;
+  u64 last_frame_start;
+  u64 last_frame_end_time;
+};
+
+void profile_begin(char const *name);
+void profile_end(void);
+void profile_mark_frame(void);
+void profile_draw_overlay(Vec2F pos, Vec2F dim);
+bool profile_write_trace(String path);
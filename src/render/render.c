@@ -1,10 +1,3 @@
-#if defined(__APPLE__)
-#define GL_SILENCE_DEPRECATION
-#include <OpenGL/gl3.h>
-#elif defined(_WIN32) || defined(__linux__)
-#include "glad/glad.h"
-#endif
-
 #include "../base/base.h"
 #undef abs
 #undef round 
@@ -15,338 +8,437 @@
 #include "../vecmath/vecmath.h"
 #include "render.h"
 
-#ifdef DEBUG
-static void verify_shader(u32 id, u32 type);
-#endif
-
-inline
-void r_set_viewport(i32 x, i32 y, i32 w, i32 h)
-{
-  glViewport(x, y, w, h);
-}
-
-// @Buffer ///////////////////////////////////////////////////////////////////////////////
-
-u32 r_create_vertex_buffer(void *data, u32 size, bool dynamic)
-{
-  u32 id;
-  glGenBuffers(1, &id);
-  glBindBuffer(GL_ARRAY_BUFFER, id);
-  GLenum draw_type = dynamic ? GL_DYNAMIC_DRAW : GL_STATIC_DRAW;
-  glBufferData(GL_ARRAY_BUFFER, size, data, draw_type);
-
-  return id;
-}
+R_Backend *r_backend = &R_GL_BACKEND;
 
-void r_update_vertex_buffer(void *data, u32 size, u32 offset)
+// Switches every r_* call over to backend. Resources and renderers belong to the
+// backend that created them, so this comes before either.
+void r_use_backend(R_Backend *backend)
 {
-  glBufferSubData(GL_ARRAY_BUFFER, offset, size, data);
+  r_backend = backend;
 }
 
-u32 r_create_index_buffer(void *data, u32 size, bool dynamic)
+inline
+void r_set_viewport(i32 x, i32 y, i32 w, i32 h)
 {
-  u32 id;
-  glGenBuffers(1, &id);
-  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, id);
-  GLenum draw_type = dynamic ? GL_DYNAMIC_DRAW : GL_STATIC_DRAW;
-  glBufferData(GL_ELEMENT_ARRAY_BUFFER, size, data, draw_type);
-
-  return id;
+  r_backend->set_viewport(x, y, w, h);
 }
 
-void r_update_index_buffer(void *data, u32 size, u32 offset)
+inline
+void r_clear(Vec4F color)
 {
-  glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, offset, size, data);
+  r_backend->clear(color);
 }
 
-// @RAO //////////////////////////////////////////////////////////////////////////////////
+// @Shader ///////////////////////////////////////////////////////////////////////////////
 
-R_VAO r_create_vertex_array(u8 stride)
+R_Shader r_create_shader(const char *vert_src, const char *frag_src)
 {
-  u32 id;
-  glGenVertexArrays(1, &id);
-  glBindVertexArray(id);
-
-  return (R_VAO) 
-  {
-    .id = id, 
-    .stride = stride, 
-    .attrib_index = 0,
-  };
+  return r_backend->create_shader(vert_src, frag_src);
 }
 
-void r_push_vertex_attribute(R_VAO *vao, u32 count)
-{
-  glVertexAttribPointer(vao->attrib_index,
-                        count,
-                        GL_FLOAT,
-                        FALSE,
-                        sizeof (f32) * vao->stride,
-                        (void *) (sizeof (f32) * vao->offset));
-
-  glEnableVertexAttribArray(vao->attrib_index);
-
-  vao->offset += count;
-  vao->attrib_index++;
-}
+// @Texture //////////////////////////////////////////////////////////////////////////////
 
-// @Shader ///////////////////////////////////////////////////////////////////////////////
+static u8 r_tex_slot = 0;
 
-R_Shader r_create_shader(const char *vert_src, const char *frag_src)
+R_Texture r_create_texture(String path)
 {
-  u32 vert = glCreateShader(GL_VERTEX_SHADER);
-  glShaderSource(vert, 1, &vert_src, NULL);
-  glCompileShader(vert);
-
-  u32 frag = glCreateShader(GL_FRAGMENT_SHADER);
-  glShaderSource(frag, 1, &frag_src, NULL);
-  glCompileShader(frag);
-
-  #ifdef DEBUG
-  verify_shader(vert, GL_COMPILE_STATUS);
-  verify_shader(frag, GL_COMPILE_STATUS);
-  #endif
-
-  u32 program = glCreateProgram();
-  glAttachShader(program, frag);
-  glAttachShader(program, vert);
-  glLinkProgram(program);
-
-  #ifdef DEBUG
-  verify_shader(program, GL_LINK_STATUS);
-  #endif
-
-  glDeleteShader(vert);
-  glDeleteShader(frag);
-
-  i16 u_xform = glGetUniformLocation(program, "u_projection");
-  i16 u_tex = glGetUniformLocation(program, "u_tex");
-
-  return (R_Shader) {
-    .id = program,
-    .u_xform = u_xform,
-    .u_tex = u_tex,
-  };
-}
+  R_Texture tex = {0};
+  tex.slot = r_tex_slot++;
 
-inline
-void r_set_uniform_1u(R_Shader *shader, i32 loc, u32 val)
-{
-  glUniform1ui(loc, val);
-}
+  stbi_set_flip_vertically_on_load(TRUE);
+  u8 *data = stbi_load(path.data, &tex.width, &tex.height, NULL, 4);
+  r_backend->create_texture(&tex, data);
+  stbi_image_free(data);
 
-inline
-void r_set_uniform_1i(R_Shader *shader, i32 loc, i32 val)
-{
-  glUniform1i(loc, val);
+  return tex;
 }
 
-inline
-void r_set_uniform_1f(R_Shader *shader, i32 loc, f32 val)
+// Loads every image in paths and packs them into one texture, so that anything drawn
+// from them can share a binding. The texel rect each image landed in is written to
+// regions, in the order of paths.
+R_Texture r_create_texture_atlas(String *paths, u32 count, R_TextureRegion *regions, Arena *arena)
 {
-  glUniform1f(loc, val);
-}
+  R_Texture tex = {0};
+  tex.slot = r_tex_slot++;
 
-inline
-void r_set_uniform_2f(R_Shader *shader, i32 loc, Vec2F val)
-{
-  glUniform2f(loc, val.x, val.y);
-}
+  Arena scratch = get_scratch_arena(arena);
+  u8 **images = arena_push(&scratch, u8 *, count);
 
-inline
-void r_set_uniform_3f(R_Shader *shader, i32 loc, Vec3F val)
-{
-  glUniform3f(loc, val.x, val.y, val.z);
-}
+  stbi_set_flip_vertically_on_load(TRUE);
+  for (u32 i = 0; i < count; i++)
+  {
+    images[i] = stbi_load(paths[i].data, &regions[i].dim.x, &regions[i].dim.y, NULL, 4);
+    if (images[i] == NULL)
+    {
+      regions[i].dim = v2i(0, 0);
+    }
 
-inline
-void r_set_uniform_4f(R_Shader *shader, i32 loc, Vec4F val)
-{
-  glUniform4f(loc, val.x, val.y, val.z, val.w);
-}
+    tex.width = max(tex.width, regions[i].dim.x);
+  }
 
-inline
-void r_set_uniform_3x3f(R_Shader *shader, i32 loc, Mat3x3F val)
-{
-  glUniformMatrix3fv(loc, 1, FALSE, &val.e[0][0]);
-}
+  // NOTE(dg): Images are placed left to right on shelves as wide as the widest image,
+  // starting a new shelf on top when the next one doesn't fit.
+  i32 shelf_x = 0;
+  i32 shelf_y = 0;
+  i32 shelf_height = 0;
+  for (u32 i = 0; i < count; i++)
+  {
+    if (shelf_x + regions[i].dim.x > tex.width)
+    {
+      shelf_x = 0;
+      shelf_y += shelf_height;
+      shelf_height = 0;
+    }
 
-// @Texture //////////////////////////////////////////////////////////////////////////////
+    regions[i].pos = v2i(shelf_x, shelf_y);
+    shelf_x += regions[i].dim.x;
+    shelf_height = max(shelf_height, regions[i].dim.y);
+  }
 
-R_Texture r_create_texture(String path)
-{
-  static u8 tex_slot = 0;
-  R_Texture tex = {0};
-  tex.slot = tex_slot++;
+  tex.height = shelf_y + shelf_height;
 
-  stbi_set_flip_vertically_on_load(TRUE);
-  u8 *data = stbi_load(path.data, &tex.width, &tex.height, NULL, 4);
+  u32 *pixels = arena_push(&scratch, u32, tex.width * tex.height);
+  for (i32 i = 0; i < tex.width * tex.height; i++)
+  {
+    pixels[i] = 0;
+  }
 
-  glGenTextures(1, &tex.id);
-  glBindTexture(GL_TEXTURE_2D, tex.id);
+  for (u32 i = 0; i < count; i++)
+  {
+    if (images[i] == NULL) continue;
 
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    R_TextureRegion *region = &regions[i];
+    u32 *src = (u32 *) images[i];
+    for (i32 y = 0; y < region->dim.y; y++)
+    {
+      u32 *dst = &pixels[(region->pos.y + y) * tex.width + region->pos.x];
+      for (i32 x = 0; x < region->dim.x; x++)
+      {
+        dst[x] = src[y * region->dim.x + x];
+      }
+    }
 
-  glTexImage2D(GL_TEXTURE_2D, 
-               0, 
-               GL_RGBA8, 
-               tex.width, 
-               tex.height, 
-               0, 
-               GL_RGBA, 
-               GL_UNSIGNED_BYTE, 
-               data);
+    stbi_image_free(images[i]);
+  }
 
-  stbi_image_free(data);
+  r_backend->create_texture(&tex, tex.width > 0 ? (u8 *) pixels : NULL);
+  arena_clear(&scratch);
 
   return tex;
 }
 
 // @Rendering ////////////////////////////////////////////////////////////////////////////
 
+static void r_sort_keys(u64 *keys, u64 *temp, u32 count);
+static void r_draw_batch(R_Renderer *renderer);
+
 R_Renderer r_create_renderer(u32 vertex_capacity, u16 w, u16 h, Arena *arena)
 {
-  u64 vbo_size = sizeof (R_Vertex) * vertex_capacity;
-  R_Vertex *vertices = (R_Vertex *) _arena_push(arena, vbo_size, align_of(R_Vertex));
-  u64 ibo_size = (u64) (sizeof (u32) * vertex_capacity * 1.5f) + 1;
-  u32 *indices = (u32 *) _arena_push(arena, ibo_size, align_of(R_Vertex));
-
-  glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-  glEnable(GL_BLEND);
-
-  R_VAO vao = r_create_vertex_array(sizeof (R_Vertex) / sizeof (f32));
-  u32 vbo = r_create_vertex_buffer(NULL, vbo_size, TRUE);
-  u32 ibo = r_create_index_buffer(NULL, ibo_size, TRUE);
-  r_push_vertex_attribute(&vao, 3); // position
-  r_push_vertex_attribute(&vao, 4); // tint
-  r_push_vertex_attribute(&vao, 2); // uv
-  r_push_vertex_attribute(&vao, 1); // flash
+  R_CommandList commands = {
+    .data = arena_push(arena, R_Command, R_MAX_COMMANDS),
+    .keys = arena_push(arena, u64, R_MAX_COMMANDS),
+    .keys_temp = arena_push(arena, u64, R_MAX_COMMANDS),
+    .count = 0,
+    .capacity = R_MAX_COMMANDS,
+    .vertices = arena_push(arena, R_Vertex, R_MAX_COMMANDS * 4),
+    .vertex_count = 0,
+    .instances = arena_push(arena, R_Instance, R_MAX_COMMANDS),
+    .instance_count = 0,
+  };
 
   Mat3x3F projection = orthographic_3x3f(0.0f, w, h, 0.0f);
 
-  return (R_Renderer) {
-    .vertices = vertices,
+  R_Renderer renderer = {
+    .vertices = NULL,
     .vertex_count = 0,
+    .vertex_limit = 0,
     .vertex_capacity = vertex_capacity,
-    .indices = indices,
-    .index_count = 0,
-    .vao = vao,
-    .vbo = vbo,
-    .ibo = ibo,
+    .instancing = TRUE,
+    .instances = NULL,
+    .instance_count = 0,
+    .instance_limit = 0,
+    .instance_capacity = vertex_capacity / 4,
+    .commands = commands,
+    .layer = 0,
     .shader = R_NIL_SHADER,
     .texture = R_NIL_TEXTURE,
+    .bound_shader = R_NIL_SHADER,
+    .bound_texture = R_NIL_TEXTURE,
+    .width = w,
+    .height = h,
     .projection = projection,
   };
+
+  r_backend->init(&renderer, arena);
+
+  return renderer;
 }
 
-void r_push_vertex(R_Renderer *renderer, Vec3F pos, Vec4F tint, Vec4F color, Vec2F uv)
+static inline
+void r_pack_rgba8(u8 *result, Vec4F color)
 {
-  if (renderer->vertex_count == renderer->vertex_capacity)
+  for (u32 i = 0; i < 4; i++)
   {
-    r_flush(renderer);
+    result[i] = (u8) (clamp(color.e[i], 0.0f, 1.0f) * 255.0f + 0.5f);
   }
+}
 
-  renderer->vertices[renderer->vertex_count++] = (R_Vertex) {
-    .pos = pos,
-    .tint = tint,
-    .uv = uv,
-    .flash = color.r,
-  };
+void r_push_vertex(R_Renderer *renderer, Vec3F pos, Vec4F tint, Vec4F color, Vec2F uv)
+{
+  R_CommandList *commands = &renderer->commands;
+  R_Vertex *vertex = &commands->vertices[commands->vertex_count++];
+
+  vertex->pos = v2f(pos.x, pos.y);
+  r_pack_rgba8(vertex->tint, tint);
+  vertex->uv[0] = (u16) (clamp(uv.x, 0.0f, 1.0f) * 65535.0f + 0.5f);
+  vertex->uv[1] = (u16) (clamp(uv.y, 0.0f, 1.0f) * 65535.0f + 0.5f);
+  vertex->flags = color.r > 0.0f ? R_VertexFlag_Flash : 0;
 }
 
-void r_push_quad_indices(R_Renderer *renderer)
+static
+void r_push_command(R_Renderer *renderer, u32 offset, bool instanced)
 {
-  static u32 layout[6] = {
-    0, 1, 3,
-    1, 2, 3,
+  R_CommandList *commands = &renderer->commands;
+  u32 idx = commands->count++;
+
+  commands->data[idx] = (R_Command) {
+    .shader = renderer->shader,
+    .texture = renderer->texture,
+    .offset = offset,
+    .instanced = instanced,
   };
 
-  u32 offset = renderer->vertex_count - 4;
-  u32 index_count = renderer->index_count += 6;
-  renderer->indices[index_count - 6] = layout[0] + offset;
-  renderer->indices[index_count - 5] = layout[1] + offset;
-  renderer->indices[index_count - 4] = layout[2] + offset;
-  renderer->indices[index_count - 3] = layout[3] + offset;
-  renderer->indices[index_count - 2] = layout[4] + offset;
-  renderer->indices[index_count - 1] = layout[5] + offset;
-}
+  commands->keys[idx] = ((u64) renderer->layer << 56) | 
+                        ((u64) (renderer->shader->id & 0xFF) << 48) | 
+                        ((u64) renderer->texture->slot << 40) | 
+                        idx;
 
-void r_use_shader(R_Renderer *renderer, R_Shader *shader)
-{
-  if (renderer->shader->id != shader->id)
+  renderer->stats.draw_count++;
+
+  // NOTE(dg): A full list is submitted early. Order between the commands on either side
+  // of the early flush is then submission order, regardless of their keys.
+  if (commands->count == commands->capacity)
   {
     r_flush(renderer);
-
-    renderer->shader = shader;
-    glUseProgram(shader->id);
   }
 }
 
-void r_use_texture(R_Renderer *renderer, R_Texture *texture)
+// Records the last four vertices pushed as one quad command, keyed by the current
+// layer, shader and texture.
+void r_push_quad(R_Renderer *renderer)
 {
-  if (renderer->texture->id != texture->id)
-  {
-    r_flush(renderer);
+  r_push_command(renderer, renderer->commands.vertex_count - 4, FALSE);
+}
+
+// Records one instance of the unit quad. xform places the quad, which spans -0.5 to
+// 0.5 on both axes, and the cell is the texel rect it samples.
+void r_push_instance(R_Renderer *renderer, 
+                     Mat3x3F xform, 
+                     Vec4F tint, 
+                     Vec2I cell_pos, 
+                     Vec2I cell_dim, 
+                     f32 flash)
+{
+  R_CommandList *commands = &renderer->commands;
+  u32 offset = commands->instance_count++;
 
-    renderer->texture = texture;
-    glActiveTexture(GL_TEXTURE0 + texture->slot);
-    glBindTexture(GL_TEXTURE_2D, texture->id);
+  R_Instance *instance = &commands->instances[offset];
+  for (u32 r = 0; r < 2; r++)
+  {
+    for (u32 c = 0; c < 3; c++)
+    {
+      instance->xform[r][c] = xform.e[r][c];
+    }
   }
+
+  instance->cell[0] = (u16) cell_pos.x;
+  instance->cell[1] = (u16) cell_pos.y;
+  instance->cell[2] = (u16) cell_dim.x;
+  instance->cell[3] = (u16) cell_dim.y;
+
+  r_pack_rgba8(instance->tint, tint);
+
+  instance->flash = flash;
+
+  r_push_command(renderer, offset, TRUE);
+}
+
+inline
+void r_use_layer(R_Renderer *renderer, u8 layer)
+{
+  renderer->layer = layer;
+}
+
+inline
+void r_use_shader(R_Renderer *renderer, R_Shader *shader)
+{
+  renderer->shader = shader;
 }
 
+inline
+void r_use_texture(R_Renderer *renderer, R_Texture *texture)
+{
+  renderer->texture = texture;
+}
+
+// Sorts the recorded commands and submits them, breaking the batch only when the
+// shader or texture changes or the vertex buffer is full.
 void r_flush(R_Renderer *renderer)
 {
-  if (renderer->vertex_count == 0) return;
+  R_CommandList *commands = &renderer->commands;
+  if (commands->count == 0) return;
 
-  R_Shader *shader = renderer->shader;
-  r_set_uniform_3x3f(shader, shader->u_xform, renderer->projection);
-  r_set_uniform_1i(shader, shader->u_tex, renderer->texture->slot);
-  
-  glBindBuffer(GL_ARRAY_BUFFER, renderer->vbo);
-  r_update_vertex_buffer(renderer->vertices, sizeof (R_Vertex) * renderer->vertex_count, 0);
+  r_sort_keys(commands->keys, commands->keys_temp, commands->count);
+  renderer->stats.submit_count++;
 
-  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, renderer->ibo);
-  r_update_index_buffer(renderer->indices, sizeof (u32) * renderer->index_count, 0);
+  for (u32 i = 0; i < commands->count; i++)
+  {
+    R_Command *command = &commands->data[(u32) commands->keys[i]];
 
-  glBindVertexArray(renderer->vao.id);
-  glDrawElements(GL_TRIANGLES, renderer->index_count, GL_UNSIGNED_INT, NULL);
+    if (command->shader->id != renderer->bound_shader->id)
+    {
+      r_draw_batch(renderer);
+      renderer->bound_shader = command->shader;
+      r_backend->bind_shader(renderer, command->shader);
+      renderer->stats.shader_switch_count++;
+    }
 
-  renderer->vertex_count = 0;
-  renderer->index_count = 0;
-}
+    // NOTE(dg): Primitives carry the nil texture. Whatever is bound is left alone for
+    // them, so they never split a run of sprites.
+    if (command->texture->id != 0 && command->texture->id != renderer->bound_texture->id)
+    {
+      r_draw_batch(renderer);
+      renderer->bound_texture = command->texture;
+      r_backend->bind_texture(renderer, command->texture);
+      renderer->stats.texture_switch_count++;
+    }
+
+    renderer->batch_layer = (u8) (commands->keys[i] >> 56);
+
+    // NOTE(dg): Batches are written straight into memory mapped by the backend. One is
+    // mapped on its first command and handed over when it is drawn.
+    if (command->instanced)
+    {
+      if (renderer->instance_count == renderer->instance_limit)
+      {
+        r_draw_batch(renderer);
+
+        u32 size;
+        renderer->instances = r_backend->map_batch(renderer, 
+                                                   R_BatchKind_Instances, 
+                                                   sizeof (R_Instance), 
+                                                   &size);
+        renderer->instance_limit = size / sizeof (R_Instance);
+      }
+
+      renderer->instances[renderer->instance_count++] = commands->instances[command->offset];
+      renderer->stats.instance_count++;
+      renderer->stats.upload_bytes += sizeof (R_Instance);
+      continue;
+    }
+
+    if (renderer->vertex_count + 4 > renderer->vertex_limit)
+    {
+      r_draw_batch(renderer);
+
+      u32 size;
+      renderer->vertices = r_backend->map_batch(renderer, 
+                                                R_BatchKind_Quads, 
+                                                sizeof (R_Vertex) * 4, 
+                                                &size);
+      renderer->vertex_limit = size / sizeof (R_Vertex);
+    }
+
+    u32 offset = renderer->vertex_count;
+    for (u32 j = 0; j < 4; j++)
+    {
+      renderer->vertices[offset+j] = commands->vertices[command->offset+j];
+    }
 
-// @Debug ////////////////////////////////////////////////////////////////////////////////
+    renderer->vertex_count += 4;
+    renderer->stats.vertex_count += 4;
+    renderer->stats.upload_bytes += sizeof (R_Vertex) * 4;
+  }
 
-#ifdef DEBUG
+  r_draw_batch(renderer);
+  r_backend->end_flush(renderer);
+
+  commands->count = 0;
+  commands->vertex_count = 0;
+  commands->instance_count = 0;
+}
+
+// Hands the open batches to the backend to draw.
 static
-void verify_shader(u32 id, u32 type)
+void r_draw_batch(R_Renderer *renderer)
 {
-  if (type == GL_LINK_STATUS)
+  if (renderer->vertex_count > 0)
   {
-    glValidateProgram(id);
+    r_backend->draw_batch(renderer, R_BatchKind_Quads, renderer->vertex_count);
+
+    renderer->vertices = NULL;
+    renderer->vertex_count = 0;
+    renderer->vertex_limit = 0;
+    renderer->stats.flush_count++;
   }
 
-  i32 success = TRUE;
-  glGetShaderiv(id, type, &success);
+  if (renderer->instance_count > 0)
+  {
+    r_backend->draw_batch(renderer, R_BatchKind_Instances, renderer->instance_count);
+
+    renderer->instances = NULL;
+    renderer->instance_count = 0;
+    renderer->instance_limit = 0;
+    renderer->stats.flush_count++;
+  }
+}
 
-  if (!success)
+// LSD radix sort a byte at a time. Every digit's histogram is built in one pass and a
+// digit that all keys share is skipped, which for a frame of commands is most of them.
+static
+void r_sort_keys(u64 *keys, u64 *temp, u32 count)
+{
+  u32 counts[8][256] = {0};
+  for (u32 i = 0; i < count; i++)
   {
-    i32 length;
-    glGetShaderiv(id, GL_INFO_LOG_LENGTH, &length);
-    char log[1000];
-    glGetShaderInfoLog(id, length, &length, log);
+    for (u32 digit = 0; digit < 8; digit++)
+    {
+      counts[digit][(keys[i] >> (digit * 8)) & 0xFF]++;
+    }
+  }
+
+  u64 *src = keys;
+  u64 *dst = temp;
+  for (u32 digit = 0; digit < 8; digit++)
+  {
+    u32 shift = digit * 8;
+    u32 *offsets = counts[digit];
+    if (offsets[(src[0] >> shift) & 0xFF] == count) continue;
 
-    if (type == GL_COMPILE_STATUS)
+    u32 offset = 0;
+    for (u32 i = 0; i < 256; i++)
     {
-      logger_error(str("[ERROR]: Failed to compile shader!\n"));
+      u32 bucket_count = offsets[i];
+      offsets[i] = offset;
+      offset += bucket_count;
     }
-    else
+
+    for (u32 i = 0; i < count; i++)
     {
-      logger_error(str("[ERROR]: Failed to link shaders!\n"));
+      u64 key = src[i];
+      dst[offsets[(key >> shift) & 0xFF]++] = key;
     }
 
-    logger_error(str("%s"), log);
+    u64 *swap = src;
+    src = dst;
+    dst = swap;
+  }
+
+  if (src != keys)
+  {
+    for (u32 i = 0; i < count; i++)
+    {
+      keys[i] = src[i];
+    }
   }
 }
-#endif
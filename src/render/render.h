@@ -3,21 +3,49 @@
 #include "../base/base_common.h"
 #include "../base/base_string.h"
 
+typedef enum R_VertexFlag
+{
+  R_VertexFlag_Flash = 1 << 0,
+} R_VertexFlag;
+
+// NOTE(dg): Tint is normalized RGBA8 and uv is normalized u16, so a vertex is 20 bytes.
 typedef struct R_Vertex R_Vertex;
 struct R_Vertex
 {
-  Vec3F pos;
-  Vec4F tint;
-  Vec2F uv;
+  Vec2F pos;
+  u8 tint[4];
+  u16 uv[2];
+  u8 flags;
+};
+
+// NOTE(dg): One record per instanced sprite. The vertex shader expands it into a unit
+// quad centred on the origin, placed by the top two rows of the affine transform.
+// The atlas cell is in texels, so the same record works with any texture.
+typedef struct R_Instance R_Instance;
+struct R_Instance
+{
+  f32 xform[2][3];
+  u16 cell[4];
+  u8 tint[4];
   f32 flash;
 };
 
+typedef enum R_AttribType
+{
+  R_AttribType_F32,
+  R_AttribType_U16,
+  R_AttribType_U16Norm,
+  R_AttribType_U8,
+  R_AttribType_U8Norm,
+} R_AttribType;
+
 typedef struct R_Shader R_Shader;
 struct R_Shader
 {
   u32 id;
   i16 u_xform;
   i16 u_tex;
+  i16 u_tex_size;
 };
 
 typedef struct R_Texture R_Texture;
@@ -29,15 +57,115 @@ struct R_Texture
   i32 height;
 };
 
+// Texel rect of one image packed into an atlas, measured from the atlas' bottom left.
+typedef struct R_TextureRegion R_TextureRegion;
+struct R_TextureRegion
+{
+  Vec2I pos;
+  Vec2I dim;
+};
+
+#define R_MAX_ATTRIBS 8
+
+typedef struct R_Attrib R_Attrib;
+struct R_Attrib
+{
+  u16 offset;
+  u8 count;
+  u8 type;
+  u8 divisor;
+};
+
+// NOTE(dg): The attribute layout is kept so the pointers can be moved to wherever the
+// batch sits in its stream buffer.
 typedef struct R_VAO R_VAO;
 struct R_VAO
 {
   u32 id;
-  u8 offset;
-  u8 stride;
+  u16 offset;
+  u16 stride;
   u8 attrib_index;
+  R_Attrib attribs[R_MAX_ATTRIBS];
+};
+
+#define R_STREAM_REGIONS 3
+
+typedef enum R_StreamMode
+{
+  R_StreamMode_Unsynchronized,
+  R_StreamMode_Orphan,
+} R_StreamMode;
+
+// NOTE(dg): A stream buffer is split into regions that are used round robin, one per
+// flush. Batches are written straight into a mapped range of the current region with
+// no sync, and a fence at the end of the flush guards the region until the GPU is done
+// with it. Without map and fence support each batch orphans the buffer and is
+// uploaded from a staging copy instead.
+typedef struct R_StreamBuffer R_StreamBuffer;
+struct R_StreamBuffer
+{
+  u32 id;
+  R_StreamMode mode;
+  u32 region_size;
+  u32 region;
+  u32 offset;
+  byte *staging;
+  void *fences[R_STREAM_REGIONS];
+};
+
+// NOTE(dg): Every quad or instance is recorded as a command with a 64-bit sort key instead of going
+// straight into the batch. From the top bit down the key holds the layer, shader,
+// texture and depth. Depth is the order the command was pushed in, which also makes it
+// the command's index. At flush the keys are radix sorted and the commands submitted in
+// key order, so the batch only breaks when the shader or texture really changes.
+// Within a layer, commands with the same state keep the order they were pushed in.
+typedef struct R_Command R_Command;
+struct R_Command
+{
+  R_Shader *shader;
+  R_Texture *texture;
+  u32 offset;
+  bool instanced;
+};
+
+typedef struct R_CommandList R_CommandList;
+struct R_CommandList
+{
+  R_Command *data;
+  u64 *keys;
+  u64 *keys_temp;
+  u32 count;
+  u32 capacity;
+
+  R_Vertex *vertices;
+  u32 vertex_count;
+
+  R_Instance *instances;
+  u32 instance_count;
+};
+
+typedef struct R_Stats R_Stats;
+// NOTE(dg): flush_count is batches drawn and submit_count is calls to r_flush that had
+// anything to submit. Vertices and instances are counted as they are copied into the
+// mapped batches, and upload_bytes is what those copies wrote.
+struct R_Stats
+{
+  u32 draw_count;
+  u32 flush_count;
+  u32 submit_count;
+  u32 vertex_count;
+  u32 instance_count;
+  u32 shader_switch_count;
+  u32 texture_switch_count;
+  u64 upload_bytes;
 };
 
+typedef enum R_BatchKind
+{
+  R_BatchKind_Quads,
+  R_BatchKind_Instances,
+} R_BatchKind;
+
 typedef struct R_Renderer R_Renderer;
 struct R_Renderer
 {
@@ -45,28 +173,127 @@ struct R_Renderer
 
   R_Vertex *vertices;
   u32 vertex_count;
+  u32 vertex_limit;
   u32 vertex_capacity;
 
-  u32 *indices;
-  u32 index_count;
+  // NOTE(dg): Every batch is a run of quads, so the index buffer never changes. It is
+  // built once for the whole vertex capacity, with u16 indices when they fit. The
+  // buffers and vertex arrays below belong to the GL backend.
+  u8 index_size;
 
   R_VAO vao;
-  u32 vbo;
+  R_StreamBuffer vertex_stream;
   u32 ibo;
 
+  bool instancing;
+  R_Instance *instances;
+  u32 instance_count;
+  u32 instance_limit;
+  u32 instance_capacity;
+  R_VAO instance_vao;
+  R_StreamBuffer instance_stream;
+
+  R_CommandList commands;
+  u8 layer;
+  u8 batch_layer;
+
   R_Shader *shader;
   R_Texture *texture;
+  R_Shader *bound_shader;
+  R_Texture *bound_texture;
 
+  R_Stats stats;
+
+  u16 width;
+  u16 height;
   Mat3x3F projection;
 };
 
+// NOTE(dg): Everything that reaches the GPU goes through the active backend. The
+// frontend records, sorts and batches the commands, so a backend only ever sees
+// resource creation, state changes, mapped batches and draws. The GL backend is the
+// default. The record backend draws nothing and keeps a log of the calls instead, and
+// the soft backend rasterizes on the CPU.
+typedef struct R_Backend R_Backend;
+struct R_Backend
+{
+  void (*init)(R_Renderer *renderer, Arena *arena);
+  R_Shader (*create_shader)(const char *vert_src, const char *frag_src);
+  void (*create_texture)(R_Texture *texture, u8 *pixels);
+  void (*set_viewport)(i32 x, i32 y, i32 w, i32 h);
+  void (*clear)(Vec4F color);
+  void (*bind_shader)(R_Renderer *renderer, R_Shader *shader);
+  void (*bind_texture)(R_Renderer *renderer, R_Texture *texture);
+  void *(*map_batch)(R_Renderer *renderer, R_BatchKind kind, u32 min_size, u32 *size);
+  void (*draw_batch)(R_Renderer *renderer, R_BatchKind kind, u32 count);
+  void (*end_flush)(R_Renderer *renderer);
+};
+
+typedef enum R_CallType
+{
+  R_CallType_Clear,
+  R_CallType_BindShader,
+  R_CallType_BindTexture,
+  R_CallType_Draw,
+  R_CallType_Flush,
+} R_CallType;
+
+// NOTE(dg): id is the shader or texture bound. Draws also store the layer of the last
+// command in the batch.
+typedef struct R_Call R_Call;
+struct R_Call
+{
+  R_CallType type;
+  R_BatchKind kind;
+  u32 id;
+  u8 layer;
+  u32 vertex_count;
+  u32 index_count;
+  u32 instance_count;
+};
+
+typedef struct R_Recording R_Recording;
+struct R_Recording
+{
+  R_Call *calls;
+  u32 count;
+  u32 capacity;
+  u64 dropped_count;
+
+  R_Vertex *vertices;
+  u32 vertex_capacity;
+  R_Instance *instances;
+  u32 instance_capacity;
+};
+
+// NOTE(dg): The soft backend's target. Pixels are RGBA8 with the bottom row first,
+// the same as a GL framebuffer. fill_count is how many pixels have been shaded.
+typedef struct R_Framebuffer R_Framebuffer;
+struct R_Framebuffer
+{
+  u32 *pixels;
+  u32 width;
+  u32 height;
+  u32 stride;
+  u64 fill_count;
+};
+
+extern R_Backend R_GL_BACKEND;
+extern R_Backend R_RECORD_BACKEND;
+extern R_Backend R_SOFT_BACKEND;
+
 static R_Shader *R_NIL_SHADER = &(R_Shader) {0};
 static R_Texture *R_NIL_TEXTURE = &(R_Texture) {0};
 
 #define R_BLACK ((Vec4F) {0.0f, 0.0f, 0.0f, 1.0f})
 #define R_WHITE ((Vec4F) {1.0f, 1.0f, 1.0f, 1.0f})
 
+#define R_MAX_COMMANDS 65536
+#define R_MAX_RECORDED_CALLS 65536
+
+void r_use_backend(R_Backend *backend);
 void r_set_viewport(i32 x, i32 y, i32 w, i32 h);
+void r_clear(Vec4F color);
 
 // @Buffer ///////////////////////////////////////////////////////////////////////////////
 
@@ -75,10 +302,17 @@ void r_update_vertex_buffer(void *data, u32 size, u32 offset);
 u32 r_create_index_buffer(void *data, u32 size, bool dynamic);
 void r_update_index_buffer(void *data, u32 size, u32 offset);
 
+R_StreamBuffer r_create_stream_buffer(u32 region_size, R_StreamMode mode, Arena *arena);
+void *r_map_stream_buffer(R_StreamBuffer *stream, u32 min_size, u32 *size);
+u32 r_unmap_stream_buffer(R_StreamBuffer *stream, u32 size);
+void r_fence_stream_buffer(R_StreamBuffer *stream);
+
 // @VAO //////////////////////////////////////////////////////////////////////////////////
 
-R_VAO r_create_vertex_array(u8 attrib_count);
-void r_push_vertex_attribute(R_VAO *vao, u32 count);
+R_VAO r_create_vertex_array(u16 stride);
+void r_push_vertex_attribute(R_VAO *vao, u32 count, R_AttribType type);
+void r_push_instance_attribute(R_VAO *vao, u32 count, R_AttribType type);
+void r_bind_vertex_array(R_VAO *vao, u32 buffer, u32 offset);
 
 // @Shader ///////////////////////////////////////////////////////////////////////////////
 
@@ -94,12 +328,24 @@ void r_set_uniform_3x3f(R_Shader *shader, i32 loc, Mat3x3F val);
 // @Texture //////////////////////////////////////////////////////////////////////////////
 
 R_Texture r_create_texture(String path);
+R_Texture r_create_texture_atlas(String *paths, u32 count, R_TextureRegion *regions, Arena *arena);
 
 // @Rendering ////////////////////////////////////////////////////////////////////////////
 
 R_Renderer r_create_renderer(u32 vertex_capacity, u16 w, u16 h, Arena *arena);
 void r_push_vertex(R_Renderer *renderer, Vec3F pos, Vec4F tint, Vec4F color, Vec2F uv);
-void r_push_quad_indices(R_Renderer *renderer);
+void r_push_quad(R_Renderer *renderer);
+void r_push_instance(R_Renderer *renderer, Mat3x3F xform, Vec4F tint, Vec2I cell_pos, Vec2I cell_dim, f32 flash);
+void r_use_layer(R_Renderer *renderer, u8 layer);
 void r_use_shader(R_Renderer *renderer, R_Shader *shader);
 void r_use_texture(R_Renderer *renderer, R_Texture *texture);
 void r_flush(R_Renderer *renderer);
+
+// @Record ///////////////////////////////////////////////////////////////////////////////
+
+R_Recording *r_get_recording(void);
+void r_clear_recording(void);
+
+// @Soft /////////////////////////////////////////////////////////////////////////////////
+
+R_Framebuffer *r_get_framebuffer(void);
@@ -0,0 +1,562 @@
+#if defined(__APPLE__)
+#define GL_SILENCE_DEPRECATION
+#include <OpenGL/gl3.h>
+#elif defined(_WIN32) || defined(__linux__)
+#include "glad/glad.h"
+#endif
+
+#include "../base/base.h"
+#undef abs
+#undef round 
+
+#include "../vecmath/vecmath.h"
+#include "render.h"
+
+#ifdef DEBUG
+static void verify_shader(u32 id, u32 type);
+#endif
+
+static u32 r_create_quad_index_buffer(u32 vertex_capacity);
+
+// @Buffer ///////////////////////////////////////////////////////////////////////////////
+
+u32 r_create_vertex_buffer(void *data, u32 size, bool dynamic)
+{
+  u32 id;
+  glGenBuffers(1, &id);
+  glBindBuffer(GL_ARRAY_BUFFER, id);
+  GLenum draw_type = dynamic ? GL_DYNAMIC_DRAW : GL_STATIC_DRAW;
+  glBufferData(GL_ARRAY_BUFFER, size, data, draw_type);
+
+  return id;
+}
+
+void r_update_vertex_buffer(void *data, u32 size, u32 offset)
+{
+  glBufferSubData(GL_ARRAY_BUFFER, offset, size, data);
+}
+
+u32 r_create_index_buffer(void *data, u32 size, bool dynamic)
+{
+  u32 id;
+  glGenBuffers(1, &id);
+  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, id);
+  GLenum draw_type = dynamic ? GL_DYNAMIC_DRAW : GL_STATIC_DRAW;
+  glBufferData(GL_ELEMENT_ARRAY_BUFFER, size, data, draw_type);
+
+  return id;
+}
+
+void r_update_index_buffer(void *data, u32 size, u32 offset)
+{
+  glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, offset, size, data);
+}
+
+#define R_STREAM_ALIGN 64
+
+R_StreamBuffer r_create_stream_buffer(u32 region_size, R_StreamMode mode, Arena *arena)
+{
+  R_StreamBuffer stream = {0};
+  stream.mode = mode;
+  stream.region_size = region_size;
+
+  u32 size = region_size;
+  if (mode == R_StreamMode_Unsynchronized)
+  {
+    size *= R_STREAM_REGIONS;
+  }
+  else
+  {
+    stream.staging = (byte *) _arena_push(arena, region_size, R_STREAM_ALIGN);
+  }
+
+  glGenBuffers(1, &stream.id);
+  glBindBuffer(GL_ARRAY_BUFFER, stream.id);
+  glBufferData(GL_ARRAY_BUFFER, size, NULL, GL_STREAM_DRAW);
+
+  return stream;
+}
+
+// Returns a pointer to at least min_size writable bytes and stores how many there are.
+// Moves on to the next region if the current one is too full.
+void *r_map_stream_buffer(R_StreamBuffer *stream, u32 min_size, u32 *size)
+{
+  if (stream->mode == R_StreamMode_Orphan)
+  {
+    *size = stream->region_size;
+    return stream->staging;
+  }
+
+  if (stream->region_size - stream->offset < min_size)
+  {
+    r_fence_stream_buffer(stream);
+  }
+
+  *size = stream->region_size - stream->offset;
+
+  GLbitfield access = GL_MAP_WRITE_BIT | 
+                      GL_MAP_UNSYNCHRONIZED_BIT | 
+                      GL_MAP_INVALIDATE_RANGE_BIT | 
+                      GL_MAP_FLUSH_EXPLICIT_BIT;
+
+  glBindBuffer(GL_ARRAY_BUFFER, stream->id);
+  return glMapBufferRange(GL_ARRAY_BUFFER, 
+                          stream->region * stream->region_size + stream->offset, 
+                          *size, 
+                          access);
+}
+
+// Hands the first size bytes written since the map to the GPU and returns their offset
+// in the buffer.
+u32 r_unmap_stream_buffer(R_StreamBuffer *stream, u32 size)
+{
+  glBindBuffer(GL_ARRAY_BUFFER, stream->id);
+
+  if (stream->mode == R_StreamMode_Orphan)
+  {
+    glBufferData(GL_ARRAY_BUFFER, stream->region_size, NULL, GL_STREAM_DRAW);
+    glBufferSubData(GL_ARRAY_BUFFER, 0, size, stream->staging);
+    return 0;
+  }
+
+  u32 result = stream->region * stream->region_size + stream->offset;
+  glFlushMappedBufferRange(GL_ARRAY_BUFFER, 0, size);
+  glUnmapBuffer(GL_ARRAY_BUFFER);
+
+  stream->offset += (size + R_STREAM_ALIGN - 1) & ~(R_STREAM_ALIGN - 1);
+  stream->offset = min(stream->offset, stream->region_size);
+
+  return result;
+}
+
+// Fences the current region and moves to the next, waiting until the GPU has finished
+// reading it.
+void r_fence_stream_buffer(R_StreamBuffer *stream)
+{
+  if (stream->mode == R_StreamMode_Orphan) return;
+  if (stream->offset == 0) return;
+
+  stream->fences[stream->region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+  stream->region = (stream->region + 1) % R_STREAM_REGIONS;
+  stream->offset = 0;
+
+  GLsync fence = stream->fences[stream->region];
+  if (fence != NULL)
+  {
+    glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000);
+    glDeleteSync(fence);
+    stream->fences[stream->region] = NULL;
+  }
+}
+
+// @RAO //////////////////////////////////////////////////////////////////////////////////
+
+R_VAO r_create_vertex_array(u16 stride)
+{
+  u32 id;
+  glGenVertexArrays(1, &id);
+  glBindVertexArray(id);
+
+  return (R_VAO) 
+  {
+    .id = id, 
+    .stride = stride, 
+    .attrib_index = 0,
+  };
+}
+
+// NOTE(dg): R_AttribType_U8 is read as an integer by the shader. Every other type
+// arrives as a float.
+static
+void r_set_attribute_pointer(R_VAO *vao, u32 index, u32 base)
+{
+  R_Attrib attrib = vao->attribs[index];
+  void *offset = (void *) (u64) (base + attrib.offset);
+
+  GLenum gl_type = GL_FLOAT;
+  bool normalized = FALSE;
+  switch ((R_AttribType) attrib.type)
+  {
+  case R_AttribType_F32:
+    break;
+  case R_AttribType_U16:
+  case R_AttribType_U16Norm:
+    gl_type = GL_UNSIGNED_SHORT;
+    normalized = attrib.type == R_AttribType_U16Norm;
+    break;
+  case R_AttribType_U8:
+  case R_AttribType_U8Norm:
+    gl_type = GL_UNSIGNED_BYTE;
+    normalized = attrib.type == R_AttribType_U8Norm;
+    break;
+  }
+
+  if (attrib.type == R_AttribType_U8)
+  {
+    glVertexAttribIPointer(index, attrib.count, gl_type, vao->stride, offset);
+  }
+  else
+  {
+    glVertexAttribPointer(index, attrib.count, gl_type, normalized, vao->stride, offset);
+  }
+}
+
+static
+void r_push_attribute(R_VAO *vao, u32 count, R_AttribType type, u32 divisor)
+{
+  assert(vao->attrib_index < R_MAX_ATTRIBS);
+
+  u16 size = sizeof (f32);
+  switch (type)
+  {
+  case R_AttribType_F32:
+    break;
+  case R_AttribType_U16:
+  case R_AttribType_U16Norm:
+    size = sizeof (u16);
+    break;
+  case R_AttribType_U8:
+  case R_AttribType_U8Norm:
+    size = sizeof (u8);
+    break;
+  }
+
+  vao->attribs[vao->attrib_index] = (R_Attrib) {
+    .offset = vao->offset,
+    .count = count,
+    .type = type,
+    .divisor = divisor,
+  };
+
+  r_set_attribute_pointer(vao, vao->attrib_index, 0);
+  glEnableVertexAttribArray(vao->attrib_index);
+  glVertexAttribDivisor(vao->attrib_index, divisor);
+
+  vao->offset += count * size;
+  vao->attrib_index++;
+}
+
+void r_push_vertex_attribute(R_VAO *vao, u32 count, R_AttribType type)
+{
+  r_push_attribute(vao, count, type, 0);
+}
+
+// Same as r_push_vertex_attribute, but the attribute advances once per instance.
+void r_push_instance_attribute(R_VAO *vao, u32 count, R_AttribType type)
+{
+  r_push_attribute(vao, count, type, 1);
+}
+
+// Binds the vertex array with its attributes reading from buffer, starting offset
+// bytes in.
+void r_bind_vertex_array(R_VAO *vao, u32 buffer, u32 offset)
+{
+  glBindVertexArray(vao->id);
+  glBindBuffer(GL_ARRAY_BUFFER, buffer);
+
+  for (u32 i = 0; i < vao->attrib_index; i++)
+  {
+    r_set_attribute_pointer(vao, i, offset);
+  }
+}
+
+// @Shader ///////////////////////////////////////////////////////////////////////////////
+
+inline
+void r_set_uniform_1u(R_Shader *shader, i32 loc, u32 val)
+{
+  glUniform1ui(loc, val);
+}
+
+inline
+void r_set_uniform_1i(R_Shader *shader, i32 loc, i32 val)
+{
+  glUniform1i(loc, val);
+}
+
+inline
+void r_set_uniform_1f(R_Shader *shader, i32 loc, f32 val)
+{
+  glUniform1f(loc, val);
+}
+
+inline
+void r_set_uniform_2f(R_Shader *shader, i32 loc, Vec2F val)
+{
+  glUniform2f(loc, val.x, val.y);
+}
+
+inline
+void r_set_uniform_3f(R_Shader *shader, i32 loc, Vec3F val)
+{
+  glUniform3f(loc, val.x, val.y, val.z);
+}
+
+inline
+void r_set_uniform_4f(R_Shader *shader, i32 loc, Vec4F val)
+{
+  glUniform4f(loc, val.x, val.y, val.z, val.w);
+}
+
+inline
+void r_set_uniform_3x3f(R_Shader *shader, i32 loc, Mat3x3F val)
+{
+  glUniformMatrix3fv(loc, 1, FALSE, &val.e[0][0]);
+}
+
+// @Backend //////////////////////////////////////////////////////////////////////////////
+
+static
+void r_gl_init(R_Renderer *renderer, Arena *arena)
+{
+  #if defined(__APPLE__)
+  R_StreamMode stream_mode = R_StreamMode_Unsynchronized;
+  #else
+  R_StreamMode stream_mode = GLAD_GL_VERSION_3_2 ? R_StreamMode_Unsynchronized 
+                                                 : R_StreamMode_Orphan;
+  #endif
+
+  glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+  glEnable(GL_BLEND);
+
+  u32 vertex_capacity = renderer->vertex_capacity;
+  renderer->vao = r_create_vertex_array(sizeof (R_Vertex));
+  renderer->vertex_stream = r_create_stream_buffer(sizeof (R_Vertex) * vertex_capacity, 
+                                                   stream_mode, 
+                                                   arena);
+  renderer->ibo = r_create_quad_index_buffer(vertex_capacity);
+  renderer->index_size = vertex_capacity <= 65536 ? sizeof (u16) : sizeof (u32);
+  r_push_vertex_attribute(&renderer->vao, 2, R_AttribType_F32);     // position
+  r_push_vertex_attribute(&renderer->vao, 4, R_AttribType_U8Norm);  // tint
+  r_push_vertex_attribute(&renderer->vao, 2, R_AttribType_U16Norm); // uv
+  r_push_vertex_attribute(&renderer->vao, 1, R_AttribType_U8);      // flags
+
+  u32 instance_capacity = renderer->instance_capacity;
+  renderer->instance_vao = r_create_vertex_array(sizeof (R_Instance));
+  renderer->instance_stream = r_create_stream_buffer(sizeof (R_Instance) * instance_capacity, 
+                                                     stream_mode, 
+                                                     arena);
+  r_push_instance_attribute(&renderer->instance_vao, 3, R_AttribType_F32);    // xform x
+  r_push_instance_attribute(&renderer->instance_vao, 3, R_AttribType_F32);    // xform y
+  r_push_instance_attribute(&renderer->instance_vao, 4, R_AttribType_U16);    // cell
+  r_push_instance_attribute(&renderer->instance_vao, 4, R_AttribType_U8Norm); // tint
+  r_push_instance_attribute(&renderer->instance_vao, 1, R_AttribType_F32);    // flash
+}
+
+static
+R_Shader r_gl_create_shader(const char *vert_src, const char *frag_src)
+{
+  u32 vert = glCreateShader(GL_VERTEX_SHADER);
+  glShaderSource(vert, 1, &vert_src, NULL);
+  glCompileShader(vert);
+
+  u32 frag = glCreateShader(GL_FRAGMENT_SHADER);
+  glShaderSource(frag, 1, &frag_src, NULL);
+  glCompileShader(frag);
+
+  #ifdef DEBUG
+  verify_shader(vert, GL_COMPILE_STATUS);
+  verify_shader(frag, GL_COMPILE_STATUS);
+  #endif
+
+  u32 program = glCreateProgram();
+  glAttachShader(program, frag);
+  glAttachShader(program, vert);
+  glLinkProgram(program);
+
+  #ifdef DEBUG
+  verify_shader(program, GL_LINK_STATUS);
+  #endif
+
+  glDeleteShader(vert);
+  glDeleteShader(frag);
+
+  i16 u_xform = glGetUniformLocation(program, "u_projection");
+  i16 u_tex = glGetUniformLocation(program, "u_tex");
+  i16 u_tex_size = glGetUniformLocation(program, "u_tex_size");
+
+  return (R_Shader) {
+    .id = program,
+    .u_xform = u_xform,
+    .u_tex = u_tex,
+    .u_tex_size = u_tex_size,
+  };
+}
+
+static
+void r_gl_create_texture(R_Texture *texture, u8 *pixels)
+{
+  glGenTextures(1, &texture->id);
+  glBindTexture(GL_TEXTURE_2D, texture->id);
+
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+  glTexImage2D(GL_TEXTURE_2D, 
+               0, 
+               GL_RGBA8, 
+               texture->width, 
+               texture->height, 
+               0, 
+               GL_RGBA, 
+               GL_UNSIGNED_BYTE, 
+               pixels);
+}
+
+static
+void r_gl_set_viewport(i32 x, i32 y, i32 w, i32 h)
+{
+  glViewport(x, y, w, h);
+}
+
+static
+void r_gl_clear(Vec4F color)
+{
+  glClearColor(color.r, color.g, color.b, color.a);
+  glClear(GL_COLOR_BUFFER_BIT);
+}
+
+static
+void r_gl_bind_shader(R_Renderer *renderer, R_Shader *shader)
+{
+  glUseProgram(shader->id);
+}
+
+static
+void r_gl_bind_texture(R_Renderer *renderer, R_Texture *texture)
+{
+  glActiveTexture(GL_TEXTURE0 + texture->slot);
+  glBindTexture(GL_TEXTURE_2D, texture->id);
+}
+
+static
+void *r_gl_map_batch(R_Renderer *renderer, R_BatchKind kind, u32 min_size, u32 *size)
+{
+  R_StreamBuffer *stream = kind == R_BatchKind_Quads ? &renderer->vertex_stream 
+                                                     : &renderer->instance_stream;
+  return r_map_stream_buffer(stream, min_size, size);
+}
+
+// Hands the batch back to the GL and draws it from where it landed in its stream
+// buffer.
+static
+void r_gl_draw_batch(R_Renderer *renderer, R_BatchKind kind, u32 count)
+{
+  R_Shader *shader = renderer->bound_shader;
+  R_Texture *texture = renderer->bound_texture;
+  r_set_uniform_3x3f(shader, shader->u_xform, renderer->projection);
+  r_set_uniform_1i(shader, shader->u_tex, texture->slot);
+  r_set_uniform_2f(shader, shader->u_tex_size, v2f(texture->width, texture->height));
+
+  if (kind == R_BatchKind_Quads)
+  {
+    u32 offset = r_unmap_stream_buffer(&renderer->vertex_stream, sizeof (R_Vertex) * count);
+    r_bind_vertex_array(&renderer->vao, renderer->vertex_stream.id, offset);
+
+    GLenum index_type = renderer->index_size == sizeof (u16) ? GL_UNSIGNED_SHORT 
+                                                             : GL_UNSIGNED_INT;
+    glDrawElements(GL_TRIANGLES, count / 4 * 6, index_type, NULL);
+  }
+  else
+  {
+    u32 offset = r_unmap_stream_buffer(&renderer->instance_stream, sizeof (R_Instance) * count);
+    r_bind_vertex_array(&renderer->instance_vao, renderer->instance_stream.id, offset);
+
+    glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, count);
+  }
+}
+
+static
+void r_gl_end_flush(R_Renderer *renderer)
+{
+  r_fence_stream_buffer(&renderer->vertex_stream);
+  r_fence_stream_buffer(&renderer->instance_stream);
+}
+
+R_Backend R_GL_BACKEND = {
+  .init = r_gl_init,
+  .create_shader = r_gl_create_shader,
+  .create_texture = r_gl_create_texture,
+  .set_viewport = r_gl_set_viewport,
+  .clear = r_gl_clear,
+  .bind_shader = r_gl_bind_shader,
+  .bind_texture = r_gl_bind_texture,
+  .map_batch = r_gl_map_batch,
+  .draw_batch = r_gl_draw_batch,
+  .end_flush = r_gl_end_flush,
+};
+
+// Builds the indices for vertex_capacity/4 quads, each drawn as 0,1,3 and 1,2,3, and
+// uploads them once. The buffer is left bound to the quad VAO.
+static
+u32 r_create_quad_index_buffer(u32 vertex_capacity)
+{
+  static u32 layout[6] = {
+    0, 1, 3,
+    1, 2, 3,
+  };
+
+  u32 quad_count = vertex_capacity / 4;
+  bool use_u16 = vertex_capacity <= 65536;
+  u64 size = (u64) quad_count * 6 * (use_u16 ? sizeof (u16) : sizeof (u32));
+
+  Arena scratch = get_scratch_arena(NULL);
+  u16 *indices_u16 = (u16 *) _arena_push(&scratch, size, align_of(u32));
+  u32 *indices_u32 = (u32 *) indices_u16;
+
+  for (u32 quad = 0; quad < quad_count; quad++)
+  {
+    for (u32 i = 0; i < 6; i++)
+    {
+      u32 index = quad * 4 + layout[i];
+      if (use_u16)
+      {
+        indices_u16[quad * 6 + i] = (u16) index;
+      }
+      else
+      {
+        indices_u32[quad * 6 + i] = index;
+      }
+    }
+  }
+
+  u32 ibo = r_create_index_buffer(indices_u16, size, FALSE);
+  arena_clear(&scratch);
+
+  return ibo;
+}
+
+// @Debug ////////////////////////////////////////////////////////////////////////////////
+
+#ifdef DEBUG
+static
+void verify_shader(u32 id, u32 type)
+{
+  if (type == GL_LINK_STATUS)
+  {
+    glValidateProgram(id);
+  }
+
+  i32 success = TRUE;
+  glGetShaderiv(id, type, &success);
+
+  if (!success)
+  {
+    i32 length;
+    glGetShaderiv(id, GL_INFO_LOG_LENGTH, &length);
+    char log[1000];
+    glGetShaderInfoLog(id, length, &length, log);
+
+    if (type == GL_COMPILE_STATUS)
+    {
+      logger_error(str("[ERROR]: Failed to compile shader!\n"));
+    }
+    else
+    {
+      logger_error(str("[ERROR]: Failed to link shaders!\n"));
+    }
+
+    logger_error(str("%s"), log);
+  }
+}
+#endif
@@ -0,0 +1,153 @@
+#include "../base/base.h"
+#undef abs
+#undef round 
+
+#include "../vecmath/vecmath.h"
+#include "render.h"
+
+// NOTE(dg): The record backend never touches a GPU. Batches are written to CPU memory
+// and every call the frontend makes is appended to the recording, so the whole
+// frontend runs as it would on the GL. The headless build uses it to check the draw
+// calls a frame makes and to time the CPU side of rendering. Calls past the capacity
+// are counted but not kept.
+
+static R_Recording r_recording;
+
+static
+void r_record_call(R_Call call)
+{
+  if (r_recording.count == r_recording.capacity)
+  {
+    r_recording.dropped_count++;
+    return;
+  }
+
+  r_recording.calls[r_recording.count++] = call;
+}
+
+static
+void r_record_init(R_Renderer *renderer, Arena *arena)
+{
+  r_recording = (R_Recording) {
+    .calls = arena_push(arena, R_Call, R_MAX_RECORDED_CALLS),
+    .count = 0,
+    .capacity = R_MAX_RECORDED_CALLS,
+    .vertices = arena_push(arena, R_Vertex, renderer->vertex_capacity),
+    .vertex_capacity = renderer->vertex_capacity,
+    .instances = arena_push(arena, R_Instance, renderer->instance_capacity),
+    .instance_capacity = renderer->instance_capacity,
+  };
+}
+
+// NOTE(dg): Ids only have to be unique and non-zero. Zero is the nil shader and
+// texture.
+static u32 r_record_next_id = 1;
+
+static
+R_Shader r_record_create_shader(const char *vert_src, const char *frag_src)
+{
+  return (R_Shader) {
+    .id = r_record_next_id++,
+    .u_xform = -1,
+    .u_tex = -1,
+    .u_tex_size = -1,
+  };
+}
+
+static
+void r_record_create_texture(R_Texture *texture, u8 *pixels)
+{
+  texture->id = r_record_next_id++;
+}
+
+static
+void r_record_set_viewport(i32 x, i32 y, i32 w, i32 h) {}
+
+static
+void r_record_clear(Vec4F color)
+{
+  r_record_call((R_Call) {.type = R_CallType_Clear});
+}
+
+static
+void r_record_bind_shader(R_Renderer *renderer, R_Shader *shader)
+{
+  r_record_call((R_Call) {.type = R_CallType_BindShader, .id = shader->id});
+}
+
+static
+void r_record_bind_texture(R_Renderer *renderer, R_Texture *texture)
+{
+  r_record_call((R_Call) {.type = R_CallType_BindTexture, .id = texture->id});
+}
+
+static
+void *r_record_map_batch(R_Renderer *renderer, R_BatchKind kind, u32 min_size, u32 *size)
+{
+  if (kind == R_BatchKind_Quads)
+  {
+    *size = sizeof (R_Vertex) * r_recording.vertex_capacity;
+    return r_recording.vertices;
+  }
+
+  *size = sizeof (R_Instance) * r_recording.instance_capacity;
+  return r_recording.instances;
+}
+
+static
+void r_record_draw_batch(R_Renderer *renderer, R_BatchKind kind, u32 count)
+{
+  R_Call call = {
+    .type = R_CallType_Draw,
+    .kind = kind,
+    .id = renderer->bound_shader->id,
+    .layer = renderer->batch_layer,
+  };
+
+  if (kind == R_BatchKind_Quads)
+  {
+    call.vertex_count = count;
+    call.index_count = count / 4 * 6;
+  }
+  else
+  {
+    call.vertex_count = 4;
+    call.instance_count = count;
+  }
+
+  r_record_call(call);
+}
+
+static
+void r_record_end_flush(R_Renderer *renderer)
+{
+  r_record_call((R_Call) {.type = R_CallType_Flush});
+}
+
+R_Backend R_RECORD_BACKEND = {
+  .init = r_record_init,
+  .create_shader = r_record_create_shader,
+  .create_texture = r_record_create_texture,
+  .set_viewport = r_record_set_viewport,
+  .clear = r_record_clear,
+  .bind_shader = r_record_bind_shader,
+  .bind_texture = r_record_bind_texture,
+  .map_batch = r_record_map_batch,
+  .draw_batch = r_record_draw_batch,
+  .end_flush = r_record_end_flush,
+};
+
+// @Record ///////////////////////////////////////////////////////////////////////////////
+
+inline
+R_Recording *r_get_recording(void)
+{
+  return &r_recording;
+}
+
+// Empties the recording, usually once per frame.
+void r_clear_recording(void)
+{
+  r_recording.count = 0;
+  r_recording.dropped_count = 0;
+}
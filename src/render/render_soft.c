@@ -0,0 +1,728 @@
+#include "../base/base.h"
+#undef abs
+#undef round
+
+#include "../vecmath/vecmath.h"
+#include "render.h"
+
+// NOTE(dg): The soft backend rasterizes on the CPU into an RGBA8 framebuffer, so frames
+// can be rendered and compared on machines with no GPU. It matches the sprite and
+// primitive shaders: nearest sampling, tex * tint + flash, and src alpha blending.
+//
+// Every quad in a flush is set up once into four edge functions and a plane per
+// attribute. At the end of the flush the quads are binned into tiles, and the tiles
+// are shared out over the job system. A tile draws its quads in submission order, so
+// the result does not depend on the thread count. Pixels are shaded four at a time.
+//
+// Pixel centres on an edge are covered, so quads that share an edge exactly both draw
+// the pixels on it.
+
+#define R_SOFT_TILE_SIZE 64
+#define R_SOFT_MAX_TEXTURES 16
+#define R_SOFT_MAX_TILE_REFS (R_MAX_COMMANDS * 4)
+
+typedef enum R_SoftPlane
+{
+  R_SoftPlane_U,
+  R_SoftPlane_V,
+  R_SoftPlane_R,
+  R_SoftPlane_G,
+  R_SoftPlane_B,
+  R_SoftPlane_A,
+  R_SoftPlane_Flash,
+
+  R_SoftPlane_COUNT,
+} R_SoftPlane;
+
+typedef struct R_SoftTexture R_SoftTexture;
+struct R_SoftTexture
+{
+  u32 *pixels;
+  i32 width;
+  i32 height;
+};
+
+// NOTE(dg): A pixel centre is covered when all four edges are >= 0 there. Edges and
+// planes are both a*x + b*y + c in pixels. The uv planes are in texels and the colour
+// planes are in 0 to 255.
+typedef struct R_SoftQuad R_SoftQuad;
+struct R_SoftQuad
+{
+  f32 edges[4][3];
+  f32 planes[R_SoftPlane_COUNT][3];
+  R_SoftTexture *texture;
+  i32 x0;
+  i32 y0;
+  i32 x1;
+  i32 y1;
+};
+
+typedef struct R_SoftState R_SoftState;
+struct R_SoftState
+{
+  Arena arena;
+  R_Framebuffer framebuffer;
+  Mat3x3F projection;
+
+  R_SoftTexture textures[R_SOFT_MAX_TEXTURES];
+  u32 texture_count;
+  u32 shader_count;
+
+  R_Vertex *vertices;
+  u32 vertex_capacity;
+  R_Instance *instances;
+  u32 instance_capacity;
+
+  R_SoftQuad *quads;
+  u32 quad_count;
+
+  u32 tiles_x;
+  u32 tiles_y;
+  u32 *tile_offsets;
+  u32 *tile_cursors;
+  u32 *tile_refs;
+
+  // Pixels filled by each job thread, with a last slot for threads without one
+  u64 fill_counts[JOB_MAX_THREADS + 1];
+};
+
+static R_SoftState r_soft;
+
+static void r_soft_raster(u32 first, u32 last);
+
+// NOTE(dg): Textures are created before the renderer, so the arena is made on first use.
+static
+Arena *r_soft_arena(void)
+{
+  if (r_soft.arena.memory == NULL)
+  {
+    r_soft.arena = create_arena(GiB(4), FALSE);
+  }
+
+  return &r_soft.arena;
+}
+
+static
+void r_soft_init(R_Renderer *renderer, Arena *arena)
+{
+  Arena *soft_arena = r_soft_arena();
+
+  R_Framebuffer *fb = &r_soft.framebuffer;
+  fb->width = renderer->width;
+  fb->height = renderer->height;
+  fb->stride = (fb->width + 3) & ~3;
+  fb->pixels = (u32 *) _arena_push(soft_arena, sizeof (u32) * fb->stride * fb->height, 16);
+  fb->fill_count = 0;
+
+  r_soft.projection = renderer->projection;
+
+  r_soft.vertex_capacity = renderer->vertex_capacity;
+  r_soft.vertices = arena_push(soft_arena, R_Vertex, r_soft.vertex_capacity);
+  r_soft.instance_capacity = renderer->instance_capacity;
+  r_soft.instances = arena_push(soft_arena, R_Instance, r_soft.instance_capacity);
+
+  r_soft.quads = arena_push(soft_arena, R_SoftQuad, R_MAX_COMMANDS);
+  r_soft.quad_count = 0;
+
+  r_soft.tiles_x = (fb->width + R_SOFT_TILE_SIZE - 1) / R_SOFT_TILE_SIZE;
+  r_soft.tiles_y = (fb->height + R_SOFT_TILE_SIZE - 1) / R_SOFT_TILE_SIZE;
+  u32 tile_count = r_soft.tiles_x * r_soft.tiles_y;
+  r_soft.tile_offsets = arena_push(soft_arena, u32, tile_count + 1);
+  r_soft.tile_cursors = arena_push(soft_arena, u32, tile_count);
+  r_soft.tile_refs = arena_push(soft_arena, u32, R_SOFT_MAX_TILE_REFS);
+}
+
+// NOTE(dg): Shaders are told apart by whether they sample a texture. u_tex is -1 for
+// the ones that don't, the same as an unknown uniform on the GL.
+static
+R_Shader r_soft_create_shader(const char *vert_src, const char *frag_src)
+{
+  String frag = {(char *) frag_src, cstr_len((char *) frag_src) - 1};
+  bool textured = str_find(frag, str("sampler2D"), 0, frag.len) != -1;
+
+  return (R_Shader) {
+    .id = ++r_soft.shader_count,
+    .u_xform = 0,
+    .u_tex = textured ? 0 : -1,
+    .u_tex_size = -1,
+  };
+}
+
+static
+void r_soft_create_texture(R_Texture *texture, u8 *pixels)
+{
+  assert(r_soft.texture_count < R_SOFT_MAX_TEXTURES);
+
+  R_SoftTexture *soft_texture = &r_soft.textures[r_soft.texture_count++];
+  if (pixels != NULL)
+  {
+    u32 size = texture->width * texture->height;
+    soft_texture->width = texture->width;
+    soft_texture->height = texture->height;
+    soft_texture->pixels = arena_push(r_soft_arena(), u32, size);
+
+    u32 *src = (u32 *) pixels;
+    for (u32 i = 0; i < size; i++)
+    {
+      soft_texture->pixels[i] = src[i];
+    }
+  }
+
+  texture->id = r_soft.texture_count;
+}
+
+static
+void r_soft_set_viewport(i32 x, i32 y, i32 w, i32 h) {}
+
+static
+void r_soft_clear(Vec4F color)
+{
+  u32 pixel = 0;
+  for (u32 i = 0; i < 4; i++)
+  {
+    pixel |= (u32) (clamp(color.e[i], 0.0f, 1.0f) * 255.0f + 0.5f) << (i * 8);
+  }
+
+  R_Framebuffer *fb = &r_soft.framebuffer;
+  for (u32 i = 0; i < fb->stride * fb->height; i++)
+  {
+    fb->pixels[i] = pixel;
+  }
+}
+
+static
+void r_soft_bind_shader(R_Renderer *renderer, R_Shader *shader) {}
+
+static
+void r_soft_bind_texture(R_Renderer *renderer, R_Texture *texture) {}
+
+static
+void *r_soft_map_batch(R_Renderer *renderer, R_BatchKind kind, u32 min_size, u32 *size)
+{
+  if (kind == R_BatchKind_Quads)
+  {
+    *size = sizeof (R_Vertex) * r_soft.vertex_capacity;
+    return r_soft.vertices;
+  }
+
+  *size = sizeof (R_Instance) * r_soft.instance_capacity;
+  return r_soft.instances;
+}
+
+static inline
+i32 r_soft_floor(f32 x)
+{
+  i32 result = (i32) x;
+  return result - (x < result);
+}
+
+// Sets up a quad from its corners in world space, in perimeter order, and appends it
+// to the flush. uv is in texels. Quads with no pixel centres on screen are dropped.
+static
+void r_soft_push_quad(Vec2F *pos, Vec2F *uv, u8 (*tint)[4], f32 *flash, R_SoftTexture *texture)
+{
+  R_Framebuffer *fb = &r_soft.framebuffer;
+
+  Vec2F p[4];
+  for (u32 i = 0; i < 4; i++)
+  {
+    Vec3F ndc = transform_3f(v3f(pos[i].x, pos[i].y, 1.0f), r_soft.projection);
+    p[i] = v2f((ndc.x + 1.0f) * 0.5f * fb->width, (ndc.y + 1.0f) * 0.5f * fb->height);
+  }
+
+  Vec2F p_min = p[0];
+  Vec2F p_max = p[0];
+  for (u32 i = 1; i < 4; i++)
+  {
+    p_min = v2f(min(p_min.x, p[i].x), min(p_min.y, p[i].y));
+    p_max = v2f(max(p_max.x, p[i].x), max(p_max.y, p[i].y));
+  }
+
+  // - Pixels whose centre is inside the bounds ---
+  i32 x0 = -r_soft_floor(-clamp(p_min.x - 0.5f, 0.0f, (f32) fb->width));
+  i32 y0 = -r_soft_floor(-clamp(p_min.y - 0.5f, 0.0f, (f32) fb->height));
+  i32 x1 = r_soft_floor(clamp(p_max.x - 0.5f, -1.0f, (f32) fb->width)) + 1;
+  i32 y1 = r_soft_floor(clamp(p_max.y - 0.5f, -1.0f, (f32) fb->height)) + 1;
+  x1 = min(x1, (i32) fb->width);
+  y1 = min(y1, (i32) fb->height);
+  if (x0 >= x1 || y0 >= y1) return;
+
+  f32 area = 0.0f;
+  for (u32 i = 0; i < 4; i++)
+  {
+    Vec2F a = p[i];
+    Vec2F b = p[(i+1) % 4];
+    area += a.x * b.y - b.x * a.y;
+  }
+
+  if (absv(area) < 0.0001f) return;
+
+  R_SoftQuad *quad = &r_soft.quads[r_soft.quad_count++];
+  quad->texture = texture;
+  quad->x0 = x0;
+  quad->y0 = y0;
+  quad->x1 = x1;
+  quad->y1 = y1;
+
+  // - Edges, positive inside whichever way the quad winds ---
+  f32 sign = area > 0.0f ? 1.0f : -1.0f;
+  for (u32 i = 0; i < 4; i++)
+  {
+    Vec2F a = p[i];
+    Vec2F b = p[(i+1) % 4];
+    quad->edges[i][0] = -(b.y - a.y) * sign;
+    quad->edges[i][1] = (b.x - a.x) * sign;
+    quad->edges[i][2] = ((b.y - a.y) * a.x - (b.x - a.x) * a.y) * sign;
+  }
+
+  // - Attribute planes through corners 0, 1 and 3 ---
+  f32 attribs[R_SoftPlane_COUNT][4];
+  for (u32 i = 0; i < 4; i++)
+  {
+    attribs[R_SoftPlane_U][i] = uv[i].x;
+    attribs[R_SoftPlane_V][i] = uv[i].y;
+    attribs[R_SoftPlane_R][i] = tint[i][0];
+    attribs[R_SoftPlane_G][i] = tint[i][1];
+    attribs[R_SoftPlane_B][i] = tint[i][2];
+    attribs[R_SoftPlane_A][i] = tint[i][3];
+    attribs[R_SoftPlane_Flash][i] = flash[i] * 255.0f;
+  }
+
+  Vec2F d1 = sub_2f(p[1], p[0]);
+  Vec2F d3 = sub_2f(p[3], p[0]);
+  f32 det = d1.x * d3.y - d1.y * d3.x;
+  f32 inv_det = absv(det) > 0.0001f ? 1.0f / det : 0.0f;
+
+  for (u32 plane = 0; plane < R_SoftPlane_COUNT; plane++)
+  {
+    f32 f0 = attribs[plane][0];
+    f32 f1 = attribs[plane][1] - f0;
+    f32 f3 = attribs[plane][3] - f0;
+    f32 a = (f1 * d3.y - f3 * d1.y) * inv_det;
+    f32 b = (f3 * d1.x - f1 * d3.x) * inv_det;
+    quad->planes[plane][0] = a;
+    quad->planes[plane][1] = b;
+    quad->planes[plane][2] = f0 - a * p[0].x - b * p[0].y;
+  }
+}
+
+static
+void r_soft_draw_batch(R_Renderer *renderer, R_BatchKind kind, u32 count)
+{
+  // NOTE(dg): A texture that failed to load has no pixels. It is drawn as untextured.
+  R_SoftTexture *texture = NULL;
+  if (renderer->bound_shader->u_tex >= 0 && renderer->bound_texture->id != 0)
+  {
+    texture = &r_soft.textures[renderer->bound_texture->id - 1];
+    if (texture->width == 0 || texture->height == 0) texture = NULL;
+  }
+
+  Vec2F tex_size = texture ? v2f(texture->width, texture->height) : V2F_ZERO;
+
+  Vec2F pos[4];
+  Vec2F uv[4];
+  u8 tint[4][4];
+  f32 flash[4];
+
+  if (kind == R_BatchKind_Quads)
+  {
+    for (u32 i = 0; i < count; i += 4)
+    {
+      for (u32 j = 0; j < 4; j++)
+      {
+        R_Vertex *vertex = &r_soft.vertices[i+j];
+        pos[j] = vertex->pos;
+        uv[j] = v2f(vertex->uv[0] / 65535.0f * tex_size.x, vertex->uv[1] / 65535.0f * tex_size.y);
+        for (u32 c = 0; c < 4; c++) tint[j][c] = vertex->tint[c];
+        flash[j] = (f32) (vertex->flags & R_VertexFlag_Flash);
+      }
+
+      r_soft_push_quad(pos, uv, tint, flash, texture);
+    }
+
+    return;
+  }
+
+  // NOTE(dg): The corners of the unit quad in perimeter order, as the instanced vertex
+  // shader places them.
+  static const Vec2F corners[4] = {{0, 0}, {1, 0}, {1, 1}, {0, 1}};
+
+  for (u32 i = 0; i < count; i++)
+  {
+    R_Instance *instance = &r_soft.instances[i];
+    for (u32 j = 0; j < 4; j++)
+    {
+      Vec2F local = v2f(corners[j].x - 0.5f, corners[j].y - 0.5f);
+      pos[j] = v2f(instance->xform[0][0] * local.x + instance->xform[0][1] * local.y + instance->xform[0][2],
+                   instance->xform[1][0] * local.x + instance->xform[1][1] * local.y + instance->xform[1][2]);
+      uv[j] = v2f(instance->cell[0] + corners[j].x * instance->cell[2],
+                  instance->cell[1] + corners[j].y * instance->cell[3]);
+      for (u32 c = 0; c < 4; c++) tint[j][c] = instance->tint[c];
+      flash[j] = instance->flash;
+    }
+
+    r_soft_push_quad(pos, uv, tint, flash, texture);
+  }
+}
+
+// Bins the flush's quads into tiles and draws them. When the tile refs run out, the
+// quads binned so far are drawn first and binning starts over from there.
+static
+void r_soft_end_flush(R_Renderer *renderer)
+{
+  u32 tile_count = r_soft.tiles_x * r_soft.tiles_y;
+
+  u32 first = 0;
+  while (first < r_soft.quad_count)
+  {
+    for (u32 i = 0; i < tile_count; i++)
+    {
+      r_soft.tile_cursors[i] = 0;
+    }
+
+    // - Count ---
+    u32 ref_count = 0;
+    u32 last = first;
+    for (; last < r_soft.quad_count; last++)
+    {
+      R_SoftQuad *quad = &r_soft.quads[last];
+      u32 tx0 = quad->x0 / R_SOFT_TILE_SIZE;
+      u32 ty0 = quad->y0 / R_SOFT_TILE_SIZE;
+      u32 tx1 = (quad->x1 - 1) / R_SOFT_TILE_SIZE;
+      u32 ty1 = (quad->y1 - 1) / R_SOFT_TILE_SIZE;
+
+      u32 quad_ref_count = (tx1 - tx0 + 1) * (ty1 - ty0 + 1);
+      if (ref_count + quad_ref_count > R_SOFT_MAX_TILE_REFS) break;
+      ref_count += quad_ref_count;
+
+      for (u32 ty = ty0; ty <= ty1; ty++)
+      {
+        for (u32 tx = tx0; tx <= tx1; tx++)
+        {
+          r_soft.tile_cursors[ty * r_soft.tiles_x + tx]++;
+        }
+      }
+    }
+
+    u32 offset = 0;
+    for (u32 i = 0; i < tile_count; i++)
+    {
+      r_soft.tile_offsets[i] = offset;
+      offset += r_soft.tile_cursors[i];
+      r_soft.tile_cursors[i] = r_soft.tile_offsets[i];
+    }
+
+    r_soft.tile_offsets[tile_count] = offset;
+
+    // - Fill ---
+    for (u32 i = first; i < last; i++)
+    {
+      R_SoftQuad *quad = &r_soft.quads[i];
+      u32 tx0 = quad->x0 / R_SOFT_TILE_SIZE;
+      u32 ty0 = quad->y0 / R_SOFT_TILE_SIZE;
+      u32 tx1 = (quad->x1 - 1) / R_SOFT_TILE_SIZE;
+      u32 ty1 = (quad->y1 - 1) / R_SOFT_TILE_SIZE;
+
+      for (u32 ty = ty0; ty <= ty1; ty++)
+      {
+        for (u32 tx = tx0; tx <= tx1; tx++)
+        {
+          r_soft.tile_refs[r_soft.tile_cursors[ty * r_soft.tiles_x + tx]++] = i;
+        }
+      }
+    }
+
+    r_soft_raster(first, last);
+    first = last;
+  }
+
+  r_soft.quad_count = 0;
+}
+
+R_Backend R_SOFT_BACKEND = {
+  .init = r_soft_init,
+  .create_shader = r_soft_create_shader,
+  .create_texture = r_soft_create_texture,
+  .set_viewport = r_soft_set_viewport,
+  .clear = r_soft_clear,
+  .bind_shader = r_soft_bind_shader,
+  .bind_texture = r_soft_bind_texture,
+  .map_batch = r_soft_map_batch,
+  .draw_batch = r_soft_draw_batch,
+  .end_flush = r_soft_end_flush,
+};
+
+// @Raster ///////////////////////////////////////////////////////////////////////////////
+
+// Splits four RGBA8 pixels into a vector per channel, in 0 to 255.
+static inline
+void r_soft_unpack(u32 *src, F32x4 *rgba)
+{
+  #if defined(__SSE2__)
+  __m128i pixels = _mm_loadu_si128((__m128i *) src);
+  __m128i low = _mm_set1_epi32(0xFF);
+  rgba[0] = _mm_cvtepi32_ps(_mm_and_si128(pixels, low));
+  rgba[1] = _mm_cvtepi32_ps(_mm_and_si128(_mm_srli_epi32(pixels, 8), low));
+  rgba[2] = _mm_cvtepi32_ps(_mm_and_si128(_mm_srli_epi32(pixels, 16), low));
+  rgba[3] = _mm_cvtepi32_ps(_mm_srli_epi32(pixels, 24));
+  #else
+  f32 channels[4][4];
+  for (u32 i = 0; i < 4; i++)
+  {
+    for (u32 c = 0; c < 4; c++)
+    {
+      channels[c][i] = (f32) ((src[i] >> (c * 8)) & 0xFF);
+    }
+  }
+
+  for (u32 c = 0; c < 4; c++)
+  {
+    rgba[c] = load_f32x4(channels[c]);
+  }
+  #endif
+}
+
+// Packs channels in 0 to 255 back into RGBA8 and writes the pixels whose lane is set in
+// mask. The others are left as they were.
+static inline
+void r_soft_pack(u32 *dst, F32x4 mask, F32x4 *rgba)
+{
+  #if defined(__SSE2__)
+  __m128i pixels = _mm_or_si128(_mm_or_si128(_mm_cvtps_epi32(rgba[0]),
+                                             _mm_slli_epi32(_mm_cvtps_epi32(rgba[1]), 8)),
+                                _mm_or_si128(_mm_slli_epi32(_mm_cvtps_epi32(rgba[2]), 16),
+                                             _mm_slli_epi32(_mm_cvtps_epi32(rgba[3]), 24)));
+  __m128i old = _mm_loadu_si128((__m128i *) dst);
+  __m128i keep = _mm_castps_si128(mask);
+  pixels = _mm_or_si128(_mm_and_si128(keep, pixels), _mm_andnot_si128(keep, old));
+  _mm_storeu_si128((__m128i *) dst, pixels);
+  #else
+  f32 channels[4][4];
+  for (u32 c = 0; c < 4; c++)
+  {
+    store_f32x4(channels[c], rgba[c]);
+  }
+
+  u32 bits = mask_bits_f32x4(mask);
+  for (u32 i = 0; i < 4; i++)
+  {
+    if ((bits & (1 << i)) == 0) continue;
+
+    u32 pixel = 0;
+    for (u32 c = 0; c < 4; c++)
+    {
+      pixel |= (u32) (channels[c][i] + 0.5f) << (c * 8);
+    }
+
+    dst[i] = pixel;
+  }
+  #endif
+}
+
+// Finds the texels under u and v, which are in texels and clamped to the texture.
+static inline
+void r_soft_texel_offsets(F32x4 u, F32x4 v, i32 width, u32 *offsets)
+{
+  #if defined(__SSE2__)
+  F32x4 tx = _mm_cvtepi32_ps(_mm_cvttps_epi32(u));
+  F32x4 ty = _mm_cvtepi32_ps(_mm_cvttps_epi32(v));
+  F32x4 offset = add_f32x4(mul_f32x4(ty, f32x4((f32) width)), tx);
+  _mm_storeu_si128((__m128i *) offsets, _mm_cvttps_epi32(offset));
+  #else
+  f32 us[4];
+  f32 vs[4];
+  store_f32x4(us, u);
+  store_f32x4(vs, v);
+  for (u32 i = 0; i < 4; i++)
+  {
+    offsets[i] = (u32) vs[i] * width + (u32) us[i];
+  }
+  #endif
+}
+
+// Draws the part of the quad inside the tile and returns how many pixels it shaded.
+static
+u64 r_soft_raster_quad(R_SoftQuad *quad, i32 tile_x0, i32 tile_y0, i32 tile_x1, i32 tile_y1)
+{
+  R_Framebuffer *fb = &r_soft.framebuffer;
+
+  i32 x_min = max(quad->x0, tile_x0);
+  i32 x_max = min(quad->x1, tile_x1);
+  i32 y_min = max(quad->y0, tile_y0);
+  i32 y_max = min(quad->y1, tile_y1);
+  if (x_min >= x_max || y_min >= y_max) return 0;
+
+  u64 fill_count = 0;
+
+  static f32 lane_offsets[4] = {0.5f, 1.5f, 2.5f, 3.5f};
+  F32x4 lanes = load_f32x4(lane_offsets);
+  F32x4 zero = f32x4(0.0f);
+  F32x4 one = f32x4(1.0f);
+  F32x4 full = f32x4(255.0f);
+  F32x4 inv_full = f32x4(1.0f / 255.0f);
+  F32x4 left = f32x4((f32) x_min);
+  F32x4 right = f32x4((f32) x_max);
+
+  R_SoftTexture *texture = quad->texture;
+  F32x4 tex_max_u = f32x4(texture ? texture->width - 1 : 0);
+  F32x4 tex_max_v = f32x4(texture ? texture->height - 1 : 0);
+
+  // NOTE(dg): The edges and planes are copied out of the quad. Stores to the
+  // framebuffer could alias it otherwise, and every plane would be reloaded per pixel.
+  F32x4 edge_dx[4];
+  for (u32 i = 0; i < 4; i++)
+  {
+    edge_dx[i] = f32x4(quad->edges[i][0]);
+  }
+
+  F32x4 plane_dx[R_SoftPlane_COUNT];
+  for (u32 i = 0; i < R_SoftPlane_COUNT; i++)
+  {
+    plane_dx[i] = f32x4(quad->planes[i][0]);
+  }
+
+  for (i32 y = y_min; y < y_max; y++)
+  {
+    f32 py = y + 0.5f;
+    u32 *row = &fb->pixels[y * fb->stride];
+
+    F32x4 edge_row[4];
+    for (u32 i = 0; i < 4; i++)
+    {
+      edge_row[i] = f32x4(quad->edges[i][1] * py + quad->edges[i][2]);
+    }
+
+    F32x4 plane_row[R_SoftPlane_COUNT];
+    for (u32 i = 0; i < R_SoftPlane_COUNT; i++)
+    {
+      plane_row[i] = f32x4(quad->planes[i][1] * py + quad->planes[i][2]);
+    }
+
+    for (i32 x = x_min & ~3; x < x_max; x += 4)
+    {
+      F32x4 px = add_f32x4(f32x4((f32) x), lanes);
+
+      F32x4 mask = and_f32x4(gt_f32x4(px, left), gt_f32x4(right, px));
+      for (u32 i = 0; i < 4; i++)
+      {
+        F32x4 edge = add_f32x4(mul_f32x4(edge_dx[i], px), edge_row[i]);
+        mask = and_f32x4(mask, ge_f32x4(edge, zero));
+      }
+
+      u32 bits = mask_bits_f32x4(mask);
+      if (bits == 0) continue;
+
+      fill_count += (bits & 1) + ((bits >> 1) & 1) + ((bits >> 2) & 1) + (bits >> 3);
+
+      F32x4 src[4];
+      for (u32 c = 0; c < 4; c++)
+      {
+        u32 plane = R_SoftPlane_R + c;
+        src[c] = add_f32x4(mul_f32x4(plane_dx[plane], px), plane_row[plane]);
+      }
+
+      // - Sample nearest and modulate ---
+      if (texture != NULL)
+      {
+        F32x4 u = add_f32x4(mul_f32x4(plane_dx[R_SoftPlane_U], px), plane_row[R_SoftPlane_U]);
+        F32x4 v = add_f32x4(mul_f32x4(plane_dx[R_SoftPlane_V], px), plane_row[R_SoftPlane_V]);
+        u = min_f32x4(max_f32x4(u, zero), tex_max_u);
+        v = min_f32x4(max_f32x4(v, zero), tex_max_v);
+
+        u32 offsets[4];
+        r_soft_texel_offsets(u, v, texture->width, offsets);
+
+        u32 texels[4];
+        for (u32 i = 0; i < 4; i++)
+        {
+          texels[i] = texture->pixels[offsets[i]];
+        }
+
+        F32x4 tex[4];
+        r_soft_unpack(texels, tex);
+        for (u32 c = 0; c < 4; c++)
+        {
+          src[c] = mul_f32x4(mul_f32x4(src[c], tex[c]), inv_full);
+        }
+
+        F32x4 flash = add_f32x4(mul_f32x4(plane_dx[R_SoftPlane_Flash], px), 
+                                plane_row[R_SoftPlane_Flash]);
+        for (u32 c = 0; c < 3; c++)
+        {
+          src[c] = add_f32x4(src[c], flash);
+        }
+      }
+
+      // - Blend ---
+      F32x4 alpha = min_f32x4(max_f32x4(mul_f32x4(src[3], inv_full), zero), one);
+
+      F32x4 dst[4];
+      r_soft_unpack(&row[x], dst);
+      for (u32 c = 0; c < 4; c++)
+      {
+        F32x4 color = min_f32x4(max_f32x4(src[c], zero), full);
+        dst[c] = add_f32x4(dst[c], mul_f32x4(sub_f32x4(color, dst[c]), alpha));
+      }
+
+      r_soft_pack(&row[x], mask, dst);
+    }
+  }
+
+  return fill_count;
+}
+
+static
+void r_soft_raster_tiles(void *data, u32 first, u32 count)
+{
+  u64 fill_count = 0;
+
+  for (u32 tile = first; tile < first + count; tile++)
+  {
+    i32 x0 = (tile % r_soft.tiles_x) * R_SOFT_TILE_SIZE;
+    i32 y0 = (tile / r_soft.tiles_x) * R_SOFT_TILE_SIZE;
+    i32 x1 = min(x0 + R_SOFT_TILE_SIZE, (i32) r_soft.framebuffer.width);
+    i32 y1 = min(y0 + R_SOFT_TILE_SIZE, (i32) r_soft.framebuffer.height);
+
+    for (u32 i = r_soft.tile_offsets[tile]; i < r_soft.tile_offsets[tile+1]; i++)
+    {
+      R_SoftQuad *quad = &r_soft.quads[r_soft.tile_refs[i]];
+      fill_count += r_soft_raster_quad(quad, x0, y0, x1, y1);
+    }
+  }
+
+  r_soft.fill_counts[job_thread_index()] += fill_count;
+}
+
+// Draws the binned quads, a tile per job.
+static
+void r_soft_raster(u32 first, u32 last)
+{
+  u32 tile_count = r_soft.tiles_x * r_soft.tiles_y;
+
+  // NOTE(dg): Jobs aren't worth pushing for a handful of quads.
+  u32 grain = 1;
+  if (last - first < R_SOFT_TILE_SIZE)
+  {
+    grain = tile_count;
+  }
+
+  for (u32 i = 0; i < arr_len(r_soft.fill_counts); i++)
+  {
+    r_soft.fill_counts[i] = 0;
+  }
+
+  job_parallel_for(tile_count, grain, r_soft_raster_tiles, NULL);
+
+  for (u32 i = 0; i < arr_len(r_soft.fill_counts); i++)
+  {
+    r_soft.framebuffer.fill_count += r_soft.fill_counts[i];
+  }
+}
+
+// @Soft /////////////////////////////////////////////////////////////////////////////////
+
+inline
+R_Framebuffer *r_get_framebuffer(void)
+{
+  return &r_soft.framebuffer;
+}
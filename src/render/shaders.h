@@ -1,6 +1,8 @@
 #pragma once
 
-const char *PRIMITIVE_VERT_SRC = "#version 410 core \n layout (location = 0) in vec3 a_pos; layout (location = 1) in vec4 a_tint; out vec4 color; uniform mat3 u_projection; void main() {   gl_Position = vec4(a_pos * u_projection, 1.0);   color = a_tint; } ";
+const char *PRIMITIVE_VERT_SRC = "#version 410 core \n layout (location = 0) in vec2 a_pos; layout (location = 1) in vec4 a_tint; out vec4 color; uniform mat3 u_projection; void main() {   gl_Position = vec4(vec3(a_pos, 1.0) * u_projection, 1.0);   color = a_tint; } ";
 const char *PRIMITIVE_FRAG_SRC = "#version 410 core \n in vec4 color; layout (location = 0) out vec4 frag_color; void main() {   frag_color = color; } ";
-const char *SPRITE_VERT_SRC = "#version 410 core \n layout (location = 0) in vec3 a_pos; layout (location = 1) in vec4 a_tint; layout (location = 2) in vec2 a_tex_coord; layout (location = 3) in float a_flash; out vec4 tint; out float flash; out vec2 tex_coord; uniform mat3 u_projection; void main() {   gl_Position = vec4(a_pos * u_projection, 1.0);   tint = a_tint;   flash = a_flash;   tex_coord = a_tex_coord; } ";
+const char *SPRITE_VERT_SRC = "#version 410 core \n layout (location = 0) in vec2 a_pos; layout (location = 1) in vec4 a_tint; layout (location = 2) in vec2 a_tex_coord; layout (location = 3) in uint a_flags; out vec4 tint; out float flash; out vec2 tex_coord; uniform mat3 u_projection; void main() {   gl_Position = vec4(vec3(a_pos, 1.0) * u_projection, 1.0);   tint = a_tint;   flash = float(a_flags & 1u);   tex_coord = a_tex_coord; } ";
 const char *SPRITE_FRAG_SRC = "#version 410 core \n in vec4 tint; in float flash; in vec2 tex_coord; layout (location = 0) out vec4 frag_color; uniform sampler2D u_tex; void main() {   vec4 tex_color = texture(u_tex, tex_coord);   frag_color = (tex_color * tint) + vec4(flash, flash, flash, 0); } ";
+const char *SPRITE_INSTANCED_VERT_SRC = "#version 410 core \n layout (location = 0) in vec3 a_xform_x; layout (location = 1) in vec3 a_xform_y; layout (location = 2) in vec4 a_cell; layout (location = 3) in vec4 a_tint; layout (location = 4) in float a_flash; out vec4 tint; out float flash; out vec2 tex_coord; uniform mat3 u_projection; uniform vec2 u_tex_size; void main() {   vec2 corner = vec2(gl_VertexID & 1, gl_VertexID >> 1);   vec3 local = vec3(corner - 0.5, 1.0);   vec3 pos = vec3(dot(a_xform_x, local), dot(a_xform_y, local), 1.0);   gl_Position = vec4(pos * u_projection, 1.0);   tint = a_tint;   flash = a_flash;   tex_coord = (a_cell.xy + corner * a_cell.zw) / u_tex_size; } ";
+const char *SPRITE_INSTANCED_FRAG_SRC = "#version 410 core \n in vec4 tint; in float flash; in vec2 tex_coord; layout (location = 0) out vec4 frag_color; uniform sampler2D u_tex; void main() {   vec4 tex_color = texture(u_tex, tex_coord);   frag_color = (tex_color * tint) + vec4(flash, flash, flash, 0); } ";
@@ -1,7 +1,7 @@
 // @Vertex ///////////////////////////////////////////////////////////////////////////////
 #version 410 core \n
 
-layout (location = 0) in vec3 a_pos;
+layout (location = 0) in vec2 a_pos;
 layout (location = 1) in vec4 a_tint;
 
 out vec4 color;
@@ -10,7 +10,7 @@ uniform mat3 u_projection;
 
 void main()
 {
-  gl_Position = vec4(a_pos * u_projection, 1.0);
+  gl_Position = vec4(vec3(a_pos, 1.0) * u_projection, 1.0);
   color = a_tint;
 }
 
@@ -1,10 +1,10 @@
 // @Vertex ///////////////////////////////////////////////////////////////////////////////
 #version 410 core \n
 
-layout (location = 0) in vec3 a_pos;
+layout (location = 0) in vec2 a_pos;
 layout (location = 1) in vec4 a_tint;
 layout (location = 2) in vec2 a_tex_coord;
-layout (location = 3) in float a_flash;
+layout (location = 3) in uint a_flags;
 
 out vec4 tint;
 out float flash;
@@ -14,9 +14,9 @@ uniform mat3 u_projection;
 
 void main()
 {
-  gl_Position = vec4(a_pos * u_projection, 1.0);
+  gl_Position = vec4(vec3(a_pos, 1.0) * u_projection, 1.0);
   tint = a_tint;
-  flash = a_flash;
+  flash = float(a_flags & 1u);
   tex_coord = a_tex_coord;
 }
 
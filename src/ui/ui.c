@@ -68,11 +68,12 @@ void ui_text(String text, Vec2F pos, u32 size, u32 width, ...)
   va_list vargs;
   va_start(vargs, width);
 
-  char *buf = arena_push(&_widget_store.arena, char, BUFFER_SIZE);
-  i32 len = stbsp_vsprintf(buf, text.data, vargs);
+  // NOTE(dg): Formatted on the stack, so only the text itself is kept for the frame.
+  char buf[BUFFER_SIZE];
+  i32 len = stbsp_vsnprintf(buf, BUFFER_SIZE, text.data, vargs);
+  len = min(len, BUFFER_SIZE-1);
 
-  String formatted_text = str_from_cstring(buf, &_widget_store.arena);
-  formatted_text.len = len;
+  String formatted_text = str_copy((String) {buf, len}, &_widget_store.arena);
 
   ui_push_widget(&(UI_Widget) {
     .type = UI_WidgetType_Text,
@@ -8,6 +8,7 @@ struct UI_Sprite
 {
   Vec2I coord;
   Vec2I grid;
+  u32 uv;
 };
 
 typedef struct UI_Glyph UI_Glyph;
@@ -546,6 +546,22 @@ Mat3x3F transpose_3x3f(Mat3x3F m)
   return result;
 }
 
+// NOTE(dg): Blends element by element, which is close enough between two ticks. Written
+// so a rate of 1 gives back target exactly.
+Mat3x3F lerp_3x3f(Mat3x3F curr, Mat3x3F target, f32 rate)
+{
+  Mat3x3F result;
+  for (u32 r = 0; r < 3; r++)
+  {
+    for (u32 c = 0; c < 3; c++)
+    {
+      result.e[r][c] = curr.e[r][c] * (1.0f - rate) + target.e[r][c] * rate;
+    }
+  }
+
+  return result;
+}
+
 // @TODO(dg): Learn how this works
 Mat3x3F invert_3x3f(Mat3x3F m)
 {
@@ -608,3 +624,289 @@ Mat3x3F orthographic_3x3f(f32 left, f32 right, f32 top, f32 bot)
   result.e[2][2] = 1.0f;
   return result;
 }
+
+// F32x4 ////////////////////////////////////////////////////////////////////////////
+
+#if defined(__SSE2__)
+
+inline
+F32x4 f32x4(f32 k)
+{
+  return _mm_set1_ps(k);
+}
+
+inline
+F32x4 load_f32x4(f32 *src)
+{
+  return _mm_loadu_ps(src);
+}
+
+inline
+void store_f32x4(f32 *dst, F32x4 v)
+{
+  _mm_storeu_ps(dst, v);
+}
+
+inline
+F32x4 add_f32x4(F32x4 a, F32x4 b)
+{
+  return _mm_add_ps(a, b);
+}
+
+inline
+F32x4 sub_f32x4(F32x4 a, F32x4 b)
+{
+  return _mm_sub_ps(a, b);
+}
+
+inline
+F32x4 mul_f32x4(F32x4 a, F32x4 b)
+{
+  return _mm_mul_ps(a, b);
+}
+
+inline
+F32x4 max_f32x4(F32x4 a, F32x4 b)
+{
+  return _mm_max_ps(a, b);
+}
+
+inline
+F32x4 min_f32x4(F32x4 a, F32x4 b)
+{
+  return _mm_min_ps(a, b);
+}
+
+inline
+F32x4 le_f32x4(F32x4 a, F32x4 b)
+{
+  return _mm_cmple_ps(a, b);
+}
+
+inline
+F32x4 ge_f32x4(F32x4 a, F32x4 b)
+{
+  return _mm_cmpge_ps(a, b);
+}
+
+inline
+F32x4 gt_f32x4(F32x4 a, F32x4 b)
+{
+  return _mm_cmpgt_ps(a, b);
+}
+
+inline
+F32x4 and_f32x4(F32x4 a, F32x4 b)
+{
+  return _mm_and_ps(a, b);
+}
+
+inline
+F32x4 select_f32x4(F32x4 mask, F32x4 a, F32x4 b)
+{
+  return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+}
+
+// Packs a mask into the low four bits, lane 0 first.
+inline
+u32 mask_bits_f32x4(F32x4 mask)
+{
+  return (u32) _mm_movemask_ps(mask);
+}
+
+#elif defined(__ARM_NEON)
+
+inline
+F32x4 f32x4(f32 k)
+{
+  return vdupq_n_f32(k);
+}
+
+inline
+F32x4 load_f32x4(f32 *src)
+{
+  return vld1q_f32(src);
+}
+
+inline
+void store_f32x4(f32 *dst, F32x4 v)
+{
+  vst1q_f32(dst, v);
+}
+
+inline
+F32x4 add_f32x4(F32x4 a, F32x4 b)
+{
+  return vaddq_f32(a, b);
+}
+
+inline
+F32x4 sub_f32x4(F32x4 a, F32x4 b)
+{
+  return vsubq_f32(a, b);
+}
+
+inline
+F32x4 mul_f32x4(F32x4 a, F32x4 b)
+{
+  return vmulq_f32(a, b);
+}
+
+// NOTE(dg): vmaxq_f32 propagates NaN where SSE returns b, so compare and select instead
+inline
+F32x4 max_f32x4(F32x4 a, F32x4 b)
+{
+  return vbslq_f32(vcgtq_f32(a, b), a, b);
+}
+
+inline
+F32x4 min_f32x4(F32x4 a, F32x4 b)
+{
+  return vbslq_f32(vcltq_f32(a, b), a, b);
+}
+
+inline
+F32x4 le_f32x4(F32x4 a, F32x4 b)
+{
+  return vreinterpretq_f32_u32(vcleq_f32(a, b));
+}
+
+inline
+F32x4 ge_f32x4(F32x4 a, F32x4 b)
+{
+  return vreinterpretq_f32_u32(vcgeq_f32(a, b));
+}
+
+inline
+F32x4 gt_f32x4(F32x4 a, F32x4 b)
+{
+  return vreinterpretq_f32_u32(vcgtq_f32(a, b));
+}
+
+inline
+F32x4 and_f32x4(F32x4 a, F32x4 b)
+{
+  return vreinterpretq_f32_u32(vandq_u32(vreinterpretq_u32_f32(a), 
+                                         vreinterpretq_u32_f32(b)));
+}
+
+inline
+F32x4 select_f32x4(F32x4 mask, F32x4 a, F32x4 b)
+{
+  return vbslq_f32(vreinterpretq_u32_f32(mask), a, b);
+}
+
+inline
+u32 mask_bits_f32x4(F32x4 mask)
+{
+  static const u32 bits[4] = {1, 2, 4, 8};
+  return vaddvq_u32(vandq_u32(vreinterpretq_u32_f32(mask), vld1q_u32(bits)));
+}
+
+#else
+
+inline
+F32x4 f32x4(f32 k)
+{
+  return (F32x4) {{k, k, k, k}};
+}
+
+inline
+F32x4 load_f32x4(f32 *src)
+{
+  return (F32x4) {{src[0], src[1], src[2], src[3]}};
+}
+
+inline
+void store_f32x4(f32 *dst, F32x4 v)
+{
+  for (u32 i = 0; i < 4; i++) dst[i] = v.e[i];
+}
+
+inline
+F32x4 add_f32x4(F32x4 a, F32x4 b)
+{
+  for (u32 i = 0; i < 4; i++) a.e[i] += b.e[i];
+  return a;
+}
+
+inline
+F32x4 sub_f32x4(F32x4 a, F32x4 b)
+{
+  for (u32 i = 0; i < 4; i++) a.e[i] -= b.e[i];
+  return a;
+}
+
+inline
+F32x4 mul_f32x4(F32x4 a, F32x4 b)
+{
+  for (u32 i = 0; i < 4; i++) a.e[i] *= b.e[i];
+  return a;
+}
+
+inline
+F32x4 max_f32x4(F32x4 a, F32x4 b)
+{
+  for (u32 i = 0; i < 4; i++) a.e[i] = max(a.e[i], b.e[i]);
+  return a;
+}
+
+inline
+F32x4 min_f32x4(F32x4 a, F32x4 b)
+{
+  for (u32 i = 0; i < 4; i++) a.e[i] = min(a.e[i], b.e[i]);
+  return a;
+}
+
+static
+F32x4 _mask_f32x4(bool m0, bool m1, bool m2, bool m3)
+{
+  F32x4 result;
+  result.mask[0] = m0 ? UINT32_MAX : 0;
+  result.mask[1] = m1 ? UINT32_MAX : 0;
+  result.mask[2] = m2 ? UINT32_MAX : 0;
+  result.mask[3] = m3 ? UINT32_MAX : 0;
+  return result;
+}
+
+inline
+F32x4 le_f32x4(F32x4 a, F32x4 b)
+{
+  return _mask_f32x4(a.e[0] <= b.e[0], a.e[1] <= b.e[1], a.e[2] <= b.e[2], a.e[3] <= b.e[3]);
+}
+
+inline
+F32x4 ge_f32x4(F32x4 a, F32x4 b)
+{
+  return _mask_f32x4(a.e[0] >= b.e[0], a.e[1] >= b.e[1], a.e[2] >= b.e[2], a.e[3] >= b.e[3]);
+}
+
+inline
+F32x4 gt_f32x4(F32x4 a, F32x4 b)
+{
+  return _mask_f32x4(a.e[0] > b.e[0], a.e[1] > b.e[1], a.e[2] > b.e[2], a.e[3] > b.e[3]);
+}
+
+inline
+F32x4 and_f32x4(F32x4 a, F32x4 b)
+{
+  for (u32 i = 0; i < 4; i++) a.mask[i] &= b.mask[i];
+  return a;
+}
+
+inline
+F32x4 select_f32x4(F32x4 mask, F32x4 a, F32x4 b)
+{
+  for (u32 i = 0; i < 4; i++) a.e[i] = mask.mask[i] ? a.e[i] : b.e[i];
+  return a;
+}
+
+inline
+u32 mask_bits_f32x4(F32x4 mask)
+{
+  u32 result = 0;
+  for (u32 i = 0; i < 4; i++) result |= (mask.mask[i] & 1) << i;
+  return result;
+}
+
+#endif
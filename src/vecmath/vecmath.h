@@ -2,6 +2,12 @@
 
 #include "../base/base_common.h"
 
+#if defined(__SSE2__)
+  #include <emmintrin.h>
+#elif defined(__ARM_NEON)
+  #include <arm_neon.h>
+#endif
+
 // @Scalar =====================================================================================
 
 f32 sin_1f(f32 angle);
@@ -105,6 +111,7 @@ Mat3x3F cols_3x3f(Vec3F v1, Vec3F v2, Vec3F v3);
 Mat3x3F mul_3x3f(Mat3x3F a, Mat3x3F b);
 Mat3x3F transpose_3x3f(Mat3x3F m);
 Mat3x3F invert_3x3f(Mat3x3F m);
+Mat3x3F lerp_3x3f(Mat3x3F curr, Mat3x3F target, f32 rate);
 
 Mat3x3F translate_3x3f(f32 x_shift, f32 y_shift);
 Mat3x3F rotate_3x3f(f32 angle);
@@ -130,6 +137,40 @@ Mat4x4F shear_4x4f(f32 x_shear, f32 y_shear, f32 z_shear);
 
 Mat3x3F orthographic_3x3f(f32 left, f32 right, f32 top, f32 bot);
 
+// @F32x4 =====================================================================================
+
+// NOTE(dg): Four lanes of f32. Masks are lanes with every bit set or clear, as
+// returned by the comparisons.
+#if defined(__SSE2__)
+typedef __m128 F32x4;
+#elif defined(__ARM_NEON)
+typedef float32x4_t F32x4;
+#else
+typedef union F32x4 F32x4;
+union F32x4
+{
+  f32 e[4];
+  u32 mask[4];
+};
+#endif
+
+F32x4 f32x4(f32 k);
+F32x4 load_f32x4(f32 *src);
+void store_f32x4(f32 *dst, F32x4 v);
+
+F32x4 add_f32x4(F32x4 a, F32x4 b);
+F32x4 sub_f32x4(F32x4 a, F32x4 b);
+F32x4 mul_f32x4(F32x4 a, F32x4 b);
+F32x4 max_f32x4(F32x4 a, F32x4 b);
+F32x4 min_f32x4(F32x4 a, F32x4 b);
+
+F32x4 le_f32x4(F32x4 a, F32x4 b);
+F32x4 ge_f32x4(F32x4 a, F32x4 b);
+F32x4 gt_f32x4(F32x4 a, F32x4 b);
+F32x4 and_f32x4(F32x4 a, F32x4 b);
+F32x4 select_f32x4(F32x4 mask, F32x4 a, F32x4 b);
+u32 mask_bits_f32x4(F32x4 mask);
+
 #ifdef __cplusplus
 
 // @Overloading ================================================================================